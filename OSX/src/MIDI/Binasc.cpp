@@ -2,6 +2,8 @@
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Mon Feb 16 12:26:32 PST 2015 Adapted from binasc program.
 // Last Modified: Thu Feb 18 21:03:54 PST 2016 Added quoted string literals.
+// Last Modified: Fri Oct 16 14:12:08 PDT 2026 Assemble from memory buffers.
+// Last Modified: Fri Oct 16 15:40:51 PDT 2026 Disassemble from memory buffers.
 // Filename:      midifile/src-library/Binasc.cpp
 // Syntax:        C++11
 // vim:           ts=3 expandtab
@@ -10,7 +12,11 @@
 //
 
 #include "Binasc.h"
+#include <iterator>
 #include <sstream>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 //////////////////////////////
@@ -253,15 +259,41 @@ int Binasc::writeToBinary(ostream& out, const string& infile) {
 
 
 int Binasc::writeToBinary(ostream& out, istream& input) {
-   char inputLine[1024] = {0};    // current line being processed
-   int  lineNum = 0;              // current line number
-
-   input.getline(inputLine, 1024, '\n');
-   lineNum++;
-   while (!input.eof()) {
-      processLine(out, inputLine, lineNum);
-      input.getline(inputLine, 1024, '\n');
+   string text((istreambuf_iterator<char>(input)), istreambuf_iterator<char>());
+   vector<uchar> bytes;
+   int status = writeToBinary(bytes, (const uchar*)text.data(), text.size());
+   out.write((const char*)bytes.data(), bytes.size());
+   return status;
+}
+
+
+//
+// memory version of writeToBinary().  The text is tokenized in a single
+// pass and the bytes are appended to the output vector, which is what
+// MidiFile::read() uses to load binasc content.  Lines have no length
+// limit, and the last line does not need a newline.
+//
+
+int Binasc::writeToBinary(vector<uchar>& out, const uchar* data,
+      size_t length) {
+   out.clear();
+   // most tokens are two hex digits and a space
+   out.reserve(length / 2 + 16);
+
+   const char* text = (const char*)data;
+   const char* end  = text + length;
+   int lineNum = 0;
+   while (text < end) {
+      const char* eol = (const char*)memchr(text, '\n', end - text);
+      if (eol == NULL) {
+         eol = end;
+      }
       lineNum++;
+      processLine(out, text, (int)(eol - text), lineNum);
+      if (eol == end) {
+         break;
+      }
+      text = eol + 1;
    }
    return 1;
 }
@@ -325,15 +357,26 @@ int Binasc::readFromBinary(ostream& out, const string& infile) {
 
 
 int Binasc::readFromBinary(ostream& out, istream& input) {
+   string bytes((istreambuf_iterator<char>(input)), istreambuf_iterator<char>());
+   return readFromBinary(out, (const uchar*)bytes.data(), bytes.size());
+}
+
+
+//
+// memory version of readFromBinary().  The text is formatted into a char
+// buffer which is written to the output stream in large blocks.
+//
+
+int Binasc::readFromBinary(ostream& out, const uchar* data, size_t length) {
    int status;
    if (midiQ) {
-      status = outputStyleMidi(out, input);
+      status = outputStyleMidi(out, data, length);
    } else if (!bytesQ) {
-      status = outputStyleAscii(out, input);
+      status = outputStyleAscii(out, data, length);
    } else if (bytesQ && commentsQ) {
-      status = outputStyleBoth(out, input);
+      status = outputStyleBoth(out, data, length);
    } else {
-      status = outputStyleBinary(out, input);
+      status = outputStyleBinary(out, data, length);
    }
    return status;
 }
@@ -352,47 +395,50 @@ int Binasc::readFromBinary(ostream& out, istream& input) {
 //    broken unless they are longer than 75 characters.
 //
 
-int Binasc::outputStyleAscii(ostream& out, istream& input) {
-   uchar outputWord[256] = {0};   // storage for current word
+int Binasc::outputStyleAscii(ostream& out, const uchar* data, size_t length) {
+   string buffer;                 // formatted text waiting to be written
+   const uchar* word = data;      // start of current word
    int index     = 0;             // current length of word
    int lineCount = 0;             // current length of line
    int type      = 0;             // 0=space, 1=printable
    int lastType  = 0;             // 0=space, 1=printable
    uchar ch;                      // current input byte
 
-   ch = input.get();
-   while (!input.eof()) {
+   buffer.reserve(BUFFER_SIZE);
+   for (size_t i=0; i<length; i++) {
+      ch = data[i];
       lastType = type;
       type = (isprint(ch) && !isspace(ch)) ? 1 : 0;
 
       if ((type == 1) && (lastType == 0)) {
          // start of a new word.  check where to put old word
          if (index + lineCount >= maxLineLength) {  // put on next line
-            outputWord[index] = '\0';
-            out << '\n' << outputWord;
+            buffer += '\n';
+            buffer.append((const char*)word, index);
             lineCount = index;
             index = 0;
          } else {                                   // put on current line
-            outputWord[index] = '\0';
             if (lineCount != 0) {
-               out << ' ';
+               buffer += ' ';
                lineCount++;
             }
-            out << outputWord;
+            buffer.append((const char*)word, index);
             lineCount += index;
             index = 0;
          }
+         word = data + i;
+         flushBuffer(out, buffer, BUFFER_SIZE);
       }
       if (type == 1) {
-         outputWord[index++] = ch;
+         index++;
       }
-      ch = input.get();
    }
 
    if (index != 0) {
-      out << endl;
+      buffer += '\n';
    }
 
+   flushBuffer(out, buffer, 0);
    return 1;
 }
 
@@ -404,33 +450,34 @@ int Binasc::outputStyleAscii(ostream& out, istream& input) {
 //     in ascii form, hexadecimal numbers only.
 //
 
-int Binasc::outputStyleBinary(ostream& out, istream& input) {
+int Binasc::outputStyleBinary(ostream& out, const uchar* data, size_t length) {
+   string buffer;          // formatted text waiting to be written
    int currentByte = 0;    // current byte output in line
-   uchar ch;               // current input byte
 
-   ch = input.get();
-   if (input.eof()) {
+   if (length == 0) {
       cerr << "End of the file right away!" << endl;
       return 0;
    }
 
-   while (!input.eof()) {
-      if (ch < 0x10) {
-         out << '0';
-      }
-      out << hex << (int)ch << ' ';
+   buffer.reserve(BUFFER_SIZE);
+   for (size_t i=0; i<length; i++) {
+      appendHexByte(buffer, data[i]);
+      buffer += ' ';
       currentByte++;
       if (currentByte >= maxLineBytes) {
-         out << '\n';
+         buffer += '\n';
          currentByte = 0;
+         flushBuffer(out, buffer, BUFFER_SIZE);
       }
-      ch = input.get();
    }
 
    if (currentByte != 0) {
-      out << endl;
+      buffer += '\n';
    }
 
+   flushBuffer(out, buffer, 0);
+   // the stream version left the output in hex mode
+   out << hex;
    return 1;
 }
 
@@ -442,48 +489,50 @@ int Binasc::outputStyleBinary(ostream& out, istream& input) {
 //     form with both hexadecimal numbers and ascii representation
 //
 
-int Binasc::outputStyleBoth(ostream& out, istream& input) {
-   uchar asciiLine[256] = {0};    // storage for output line
+int Binasc::outputStyleBoth(ostream& out, const uchar* data, size_t length) {
+   string buffer;                 // formatted text waiting to be written
+   string asciiLine;              // storage for output line
    int currentByte = 0;           // current byte output in line
-   int index = 0;                 // current character in asciiLine
    uchar ch;                      // current input byte
 
-   ch = input.get();
-   while (!input.eof()) {
-      if (index == 0) {
-         asciiLine[index++] = ';';
-         out << ' ';
-      }
-      if (ch < 0x10) {
-         out << '0';
+   buffer.reserve(BUFFER_SIZE);
+   for (size_t i=0; i<length; i++) {
+      ch = data[i];
+      if (asciiLine.empty()) {
+         asciiLine += ';';
+         buffer += ' ';
       }
-      out << hex << (int)ch << ' ';
+      appendHexByte(buffer, ch);
+      buffer += ' ';
       currentByte++;
 
-      asciiLine[index++] = ' ';
+      asciiLine += ' ';
       if (isprint(ch)) {
-         asciiLine[index++] = ch;
+         asciiLine += (char)ch;
       } else {
-         asciiLine[index++] = ' ';
+         asciiLine += ' ';
       }
-      asciiLine[index++] = ' ';
+      asciiLine += ' ';
 
       if (currentByte >= maxLineBytes) {
-         out << '\n';
-         asciiLine[index] = '\0';
-         out << asciiLine << "\n\n";
+         buffer += '\n';
+         buffer += asciiLine;
+         buffer += "\n\n";
          currentByte = 0;
-         index = 0;
+         asciiLine.clear();
+         flushBuffer(out, buffer, BUFFER_SIZE);
       }
-      ch = input.get();
    }
 
    if (currentByte != 0) {
-      out << '\n';
-      asciiLine[index] = '\0';
-      out << asciiLine << '\n' << endl;
+      buffer += '\n';
+      buffer += asciiLine;
+      buffer += "\n\n";
    }
 
+   flushBuffer(out, buffer, 0);
+   // the stream version left the output in hex mode
+   out << hex;
    return 1;
 }
 
@@ -491,47 +540,63 @@ int Binasc::outputStyleBoth(ostream& out, istream& input) {
 
 ///////////////////////////////
 //
-// processLine -- read a line of input and output any specified bytes
+// processLine -- read a line of input and output any specified bytes.
+//    Words are handed to the word processors as spans of the line.
 //
 
-int Binasc::processLine(ostream& out, const string& input, int lineCount) {
+int Binasc::processLine(vector<uchar>& out, const char* input, int length,
+      int lineNum) {
    int status = 1;
    int i = 0;
-   int length = (int)input.size();
-   string word;
    while (i<length) {
-      if ((input[i] == ';') || (input[i] == '#') || (input[i] == '/')) {
+      char ch = input[i];
+      if ((ch == ';') || (ch == '#') || (ch == '/')) {
          // comment to end of line, so ignore
          return 1;
-      } else if ((input[i] == ' ') || (input[i] == '\n')
-            || (input[i] == '\t')) {
+      } else if ((ch == ' ') || (ch == '\n') || (ch == '\t')) {
          // ignore whitespace
          i++;
          continue;
-      } else if (input[i] == '+') {
-         i = getWord(word, input, " \n\t", i);
-         status = processAsciiWord(out, word, lineCount);
-      } else if (input[i] == '"') {
-         i = getWord(word, input, "\"", i);
-         status = processStringWord(out, word, lineCount);
-      } else if (input[i] == 'v') {
-         i = getWord(word, input, " \n\t", i);
-         status = processVlvWord(out, word, lineCount);
-      } else if (input[i] == 'p') {
-         i = getWord(word, input, " \n\t", i);
-         status = processMidiPitchBendWord(out, word, lineCount);
-      } else if (input[i] == 't') {
-         i = getWord(word, input, " \n\t", i);
-         status = processMidiTempoWord(out, word, lineCount);
-      } else {
-         i = getWord(word, input, " \n\t", i);
-         if (word.find('\'') != string::npos) {
-            status = processDecimalWord(out, word, lineCount);
-         } else if ((word.find(',') != string::npos) || (word.size() > 2)) {
-            status = processBinaryWord(out, word, lineCount);
-         } else {
-            status = processHexWord(out, word, lineCount);
+      } else if (ch == '"') {
+         // quoted string, with \" standing for a literal quote
+         i++;
+         while (i < length) {
+            if ((input[i] == '\\') && (i < length - 1) &&
+                  (input[i+1] == '"')) {
+               out.push_back('"');
+               i += 2;
+            } else if (input[i] == '"') {
+               i++;
+               break;
+            } else {
+               out.push_back((uchar)input[i++]);
+            }
          }
+         continue;
+      }
+
+      int start = i;
+      while ((i < length) && (input[i] != ' ') && (input[i] != '\n')
+            && (input[i] != '\t')) {
+         i++;
+      }
+      const char* word = input + start;
+      int wordLength = i - start;
+
+      if (ch == '+') {
+         status = processAsciiWord(out, word, wordLength, lineNum);
+      } else if (ch == 'v') {
+         status = processVlvWord(out, word, wordLength, lineNum);
+      } else if (ch == 'p') {
+         status = processMidiPitchBendWord(out, word, wordLength, lineNum);
+      } else if (ch == 't') {
+         status = processMidiTempoWord(out, word, wordLength, lineNum);
+      } else if (memchr(word, '\'', wordLength) != NULL) {
+         status = processDecimalWord(out, word, wordLength, lineNum);
+      } else if ((memchr(word, ',', wordLength) != NULL) || (wordLength > 2)) {
+         status = processBinaryWord(out, word, wordLength, lineNum);
+      } else {
+         status = processHexWord(out, word, wordLength, lineNum);
       }
 
       if (status == 0) {
@@ -547,60 +612,88 @@ int Binasc::processLine(ostream& out, const string& input, int lineCount) {
 
 //////////////////////////////
 //
-// Binasc::getWord -- extract a sub string, stopping at any of the given
-//   terminator characters.
+// Binasc::printWordError -- print the start of an error message for the
+//     given word, which is not null terminated.
 //
 
-int Binasc::getWord(string& word, const string& input,
-      const string& terminators, int index) {
-   word.resize(0);
-   int i = index;
-   int escape = 0;
-   int ecount = 0;
-   if (terminators.find('"') != string::npos) {
-      escape = 1;
+void Binasc::printWordError(const char* word, int length, int lineNum) {
+   cerr << "Error on line " << lineNum << " at token: ";
+   cerr.write(word, length);
+   cerr << endl;
+}
+
+
+
+//////////////////////////////
+//
+// Binasc::parseInteger -- same as atoi() but stops at the end of the
+//     word rather than at a null character.
+//
+
+int Binasc::parseInteger(const char* start, const char* end) {
+   int sign = 1;
+   if ((start < end) && ((*start == '-') || (*start == '+'))) {
+      sign = (*start == '-') ? -1 : 1;
+      start++;
    }
-   while (i < (int)input.size()) {
-      if (escape && input[i] == '\"') {
-         ecount++;
-         i++;
-         if (ecount >= 2) {
-            break;
-         }
-      }
-      if (escape && (i<(int)input.size()-1) && (input[i] == '\\')
-            && (input[i+1] == '"')) {
-         word.push_back(input[i+1]);
-         i += 2;
-      } else if (terminators.find(input[i]) == string::npos) {
-         word.push_back(input[i]);
-         i++;
-      } else {
-         i++;
-         return i;
-      }
+   unsigned long long value = 0;
+   while ((start < end) && (*start >= '0') && (*start <= '9')) {
+      value = value * 10 + (*start - '0');
+      start++;
+   }
+   return (int)(sign * (long long)value);
+}
+
+
+
+//////////////////////////////
+//
+// Binasc::parseFloat -- same as atof() but stops at the end of the word.
+//
+
+double Binasc::parseFloat(const char* start, const char* end) {
+   char buffer[64];
+   int length = (int)(end - start);
+   if (length > (int)sizeof(buffer) - 1) {
+      length = (int)sizeof(buffer) - 1;
+   }
+   memcpy(buffer, start, length);
+   buffer[length] = '\0';
+   return atof(buffer);
+}
+
+
+
+//////////////////////////////
+//
+// Binasc::appendBytes -- append the low byteCount bytes of value, most
+//     significant byte first unless littleEndian is set.
+//
+
+void Binasc::appendBytes(vector<uchar>& out, unsigned long long value,
+      int byteCount, int littleEndian) {
+   for (int i=0; i<byteCount; i++) {
+      int shift = littleEndian ? 8 * i : 8 * (byteCount - 1 - i);
+      out.push_back((uchar)((value >> shift) & 0xff));
    }
-   return i;
 }
 
 
 
 ///////////////////////////////
 //
-// Binasc::getVLV -- read a Variable-Length Value from the file
+// Binasc::getVLV -- read a Variable-Length Value from the data.  Reading
+//     stops at the end of the data.
 //
 
-int Binasc::getVLV(istream& infile, int& trackbytes) {
+int Binasc::getVLV(const uchar*& ptr, const uchar* end, int& trackbytes) {
    int output = 0;
    uchar ch;
-   infile.read((char*)&ch, 1);
-   trackbytes++;
-   output = (output << 7) | (0x7f & ch);
-   while (ch >= 0x80) {
-      infile.read((char*)&ch, 1);
+   do {
+      ch = (ptr < end) ? *ptr++ : 0;
       trackbytes++;
       output = (output << 7) | (0x7f & ch);
-   }
+   } while (ch >= 0x80);
    return output;
 }
 
@@ -613,245 +706,166 @@ int Binasc::getVLV(istream& infile, int& trackbytes) {
 //     0 otherwise.
 //
 
-int Binasc::readMidiEvent(ostream& out, istream& infile, int& trackbytes,
-      int& command) {
+int Binasc::readMidiEvent(string& out, const uchar*& ptr, const uchar* end,
+      int& trackbytes, int& command) {
 
    // Read and print Variable Length Value for delta ticks
-   int vlv = getVLV(infile, trackbytes);
-
-   stringstream output;
+   int vlv = getVLV(ptr, end, trackbytes);
 
-   output << "v" << dec << vlv << "\t";
+   size_t start = out.size();
+   out += 'v';
+   appendDecimal(out, vlv);
+   out += '\t';
 
-   string comment;
+   const char* comment = "";
+   string pitchComment;
 
    int status = 1;
    uchar ch;
-   char byte1, byte2;
-   infile.read((char*)&ch, 1);
+   int byte1, byte2;
+   ch = (ptr < end) ? *ptr++ : 0;
    trackbytes++;
    if (ch < 0x80) {
       // running status: command byte is previous one in data stream
-      output << "   ";
+      out += "   ";
    } else {
       // midi command byte
-      output << hex << (int)ch;
+      appendHex(out, ch);
       command = ch;
-      infile.read((char*)&ch, 1);
+      ch = (ptr < end) ? *ptr++ : 0;
       trackbytes++;
    }
-   byte1 = ch;
+   byte1 = (char)ch;
    int i;
    int metatype = 0;
    switch (command & 0xf0) {
       case 0x80:    // note-off: 2 bytes
-         output << " '" << dec << (int)byte1;
-         infile.read((char*)&ch, 1);
-         trackbytes++;
-         byte2 = ch;
-         output << " '" << dec << (int)byte2;
-         if (commentsQ) {
-            comment += "note-off " + keyToPitchName(byte1);
-         }
-         break;
       case 0x90:    // note-on: 2 bytes
-         output << " '" << dec << (int)byte1;
-         infile.read((char*)&ch, 1);
-         trackbytes++;
-         byte2 = ch;
-         output << " '" << dec << (int)byte2;
-         if (commentsQ) {
-            if (byte2 == 0) {
-               comment += "note-off " + keyToPitchName(byte1);
-            } else {
-               comment += "note-on " + keyToPitchName(byte1);
-            }
-         }
-         break;
       case 0xA0:    // aftertouch: 2 bytes
-         output << " '" << dec << (int)byte1;
-         infile.read((char*)&ch, 1);
-         trackbytes++;
-         byte2 = ch;
-         output << " '" << dec << (int)byte2;
-         if (commentsQ) {
-            comment += "after-touch";
-         }
-         break;
       case 0xB0:    // continuous controller: 2 bytes
-         output << " '" << dec << (int)byte1;
-         infile.read((char*)&ch, 1);
-         trackbytes++;
-         byte2 = ch;
-         output << " '" << dec << (int)byte2;
-         if (commentsQ) {
-            comment += "controller";
-         }
-         break;
       case 0xE0:    // pitch-bend: 2 bytes
-         output << " '" << dec << (int)byte1;
-         infile.read((char*)&ch, 1);
+         out += " '";
+         appendDecimal(out, byte1);
+         ch = (ptr < end) ? *ptr++ : 0;
          trackbytes++;
-         byte2 = ch;
-         output << " '" << dec << (int)byte2;
+         byte2 = (char)ch;
+         out += " '";
+         appendDecimal(out, byte2);
          if (commentsQ) {
-            comment += "pitch-bend";
+            switch (command & 0xf0) {
+               case 0x80:
+                  pitchComment = "note-off ";
+                  appendPitchName(pitchComment, byte1);
+                  break;
+               case 0x90:
+                  pitchComment = (byte2 == 0) ? "note-off " : "note-on ";
+                  appendPitchName(pitchComment, byte1);
+                  break;
+               case 0xA0: comment = "after-touch";  break;
+               case 0xB0: comment = "controller";   break;
+               case 0xE0: comment = "pitch-bend";   break;
+            }
          }
          break;
       case 0xC0:    // patch change: 1 bytes
-         output << " '" << dec << (int)byte1;
-         if (commentsQ) {
-            comment += "patch-change";
-         }
+         out += " '";
+         appendDecimal(out, byte1);
+         comment = "patch-change";
          break;
       case 0xD0:    // channel pressure: 1 bytes
-         output << " '" << dec << (int)byte1;
-         if (commentsQ) {
-            comment += "channel pressure";
-         }
+         out += " '";
+         appendDecimal(out, byte1);
+         comment = "channel pressure";
          break;
       case 0xF0:    // various system bytes: variable bytes
          switch (command) {
-            case 0xf0:
-               break;
             case 0xf7:
                // Read the first byte which is either 0xf0 or 0xf7.
                // Then a VLV byte count for the number of bytes
                // that remain in the message will follow.
                // Then read that number of bytes.
                {
-               infile.putback(byte1);
+               ptr--;
                trackbytes--;
-               int length = getVLV(infile, trackbytes);
-               output << " v" << dec << length;
+               int length = getVLV(ptr, end, trackbytes);
+               out += " v";
+               appendDecimal(out, length);
                for (i=0; i<length; i++) {
-                  infile.read((char*)&ch, 1);
+                  ch = (ptr < end) ? *ptr++ : 0;
                   trackbytes++;
-                  if (ch < 0x10) {
-                     output << " 0" << hex << (int)ch;
-                  } else {
-                     output << " " << hex << (int)ch;
-                  }
+                  out += ' ';
+                  appendHexByte(out, ch);
                }
                }
                break;
-            case 0xf1:
-               break;
-            case 0xf2:
-               break;
-            case 0xf3:
-               break;
-            case 0xf4:
-               break;
-            case 0xf5:
-               break;
-            case 0xf6:
-               break;
-            case 0xf8:
-               break;
-            case 0xf9:
-               break;
-            case 0xfa:
-               break;
-            case 0xfb:
-               break;
-            case 0xfc:
-               break;
-            case 0xfd:
-               break;
             case 0xfe:
                cerr << "Error command not yet handled" << endl;
+               out.resize(start);
                return 0;
                break;
             case 0xff:  // meta message
                {
                metatype = ch;
-               output << " " << hex << metatype;
-               int length = getVLV(infile, trackbytes);
-               output << " v" << dec << length;
+               out += ' ';
+               appendHex(out, metatype);
+               int length = getVLV(ptr, end, trackbytes);
+               out += " v";
+               appendDecimal(out, length);
                switch (metatype) {
 
                   case 0x00:  // sequence number
                      // display two-byte big-endian decimal value.
                      {
-                     infile.read((char*)&ch, 1);
-                     trackbytes++;
-                     int number = ch;
-                     infile.read((char*)&ch, 1);
-                     trackbytes++;
-                     number = (number << 8) | ch;
-                     output << " 2'" << number;
+                     int number = 0;
+                     for (i=0; i<2; i++) {
+                        ch = (ptr < end) ? *ptr++ : 0;
+                        trackbytes++;
+                        number = (number << 8) | ch;
+                     }
+                     out += " 2'";
+                     appendDecimal(out, number);
                      }
                      break;
 
                   case 0x20: // MIDI channel prefix
                   case 0x21: // MIDI port
-                     // display single-byte decimal number
-                     infile.read((char*)&ch, 1);
-                     trackbytes++;
-                     output << " '" << (int)ch;
+                  case 0x54: // SMPTE offset
+                  case 0x58: // time signature
+                  case 0x59: // key signature
+                     // display fixed count of single-byte decimal numbers
+                     {
+                     int count = 1;
+                     switch (metatype) {
+                        case 0x54: count = 5; break;
+                        case 0x58: count = 4; break;
+                        case 0x59: count = 2; break;
+                     }
+                     for (i=0; i<count; i++) {
+                        ch = (ptr < end) ? *ptr++ : 0;
+                        trackbytes++;
+                        out += " '";
+                        appendDecimal(out, ch);
+                     }
+                     }
                      break;
 
                   case 0x51: // Tempo
                       // display tempo as "t" word.
                       {
                       int number = 0;
-                      infile.read((char*)&ch, 1);
-                      trackbytes++;
-                      number = (number << 8) | ch;
-                      infile.read((char*)&ch, 1);
-                      trackbytes++;
-                      number = (number << 8) | ch;
-                      infile.read((char*)&ch, 1);
-                      trackbytes++;
-                      number = (number << 8) | ch;
+                      for (i=0; i<3; i++) {
+                         ch = (ptr < end) ? *ptr++ : 0;
+                         trackbytes++;
+                         number = (number << 8) | ch;
+                      }
                       double tempo = 1000000.0 / number * 60.0;
-                      output << " t" << tempo;
+                      char text[32];
+                      snprintf(text, sizeof(text), "%g", tempo);
+                      out += " t";
+                      out += text;
                       }
                       break;
 
-                  case 0x54: // SMPTE offset
-                      infile.read((char*)&ch, 1);
-                      trackbytes++;
-                      output << " '" << (int)ch;  // hour
-                      infile.read((char*)&ch, 1);
-                      trackbytes++;
-                      output << " '" << (int)ch;  // minutes
-                      infile.read((char*)&ch, 1);
-                      trackbytes++;
-                      output << " '" << (int)ch;  // seconds
-                      infile.read((char*)&ch, 1);
-                      trackbytes++;
-                      output << " '" << (int)ch;  // frames
-                      infile.read((char*)&ch, 1);
-                      trackbytes++;
-                      output << " '" << (int)ch;  // subframes
-                      break;
-
-                  case 0x58: // time signature
-                      infile.read((char*)&ch, 1);
-                      trackbytes++;
-                      output << " '" << (int)ch;  // numerator
-                      infile.read((char*)&ch, 1);
-                      trackbytes++;
-                      output << " '" << (int)ch;  // denominator power
-                      infile.read((char*)&ch, 1);
-                      trackbytes++;
-                      output << " '" << (int)ch;  // clocks per beat
-                      infile.read((char*)&ch, 1);
-                      trackbytes++;
-                      output << " '" << (int)ch;  // 32nd notes per beat
-                      break;
-
-                  case 0x59: // key signature
-                      infile.read((char*)&ch, 1);
-                      trackbytes++;
-                      output << " '" << (int)ch;  // accidentals
-                      infile.read((char*)&ch, 1);
-                      trackbytes++;
-                      output << " '" << (int)ch;  // mode
-                      break;
-
                   case 0x01: // text
                   case 0x02: // copyright
                   case 0x03: // track name
@@ -861,60 +875,60 @@ int Binasc::readMidiEvent(ostream& out, istream& infile, int& trackbytes,
                   case 0x07: // cue point
                   case 0x08: // program name
                   case 0x09: // device name
-                     output << " \"";
+                     out += " \"";
                      for (i=0; i<length; i++) {
-                        infile.read((char*)&ch, 1);
+                        ch = (ptr < end) ? *ptr++ : 0;
                         trackbytes++;
-                        output << (char)ch;
+                        out += (char)ch;
                      }
-                     output << "\"";
+                     out += '"';
                      break;
                   default:
                      for (i=0; i<length; i++) {
-                        infile.read((char*)&ch, 1);
+                        ch = (ptr < end) ? *ptr++ : 0;
                         trackbytes++;
-                        output << " ";
-                        if (ch < 0x10) {
-                           output << "0";
-                        }
-                        output << hex << (int)ch;
+                        out += ' ';
+                        appendHexByte(out, ch);
                      }
                }
                switch (metatype) {
-                  case 0x00: comment += "sequence number";     break;
-                  case 0x01: comment += "text";                break;
-                  case 0x02: comment += "copyright notice";    break;
-                  case 0x03: comment += "track name";          break;
-                  case 0x04: comment += "instrument name";     break;
-                  case 0x05: comment += "lyric";               break;
-                  case 0x06: comment += "marker";              break;
-                  case 0x07: comment += "cue point";           break;
-                  case 0x08: comment += "program name";        break;
-                  case 0x09: comment += "device name";         break;
-                  case 0x20: comment += "MIDI channel prefix"; break;
-                  case 0x21: comment += "MIDI port";           break;
-                  case 0x51: comment += "tempo";               break;
-                  case 0x54: comment += "SMPTE offset";        break;
-                  case 0x58: comment += "time signature";      break;
-                  case 0x59: comment += "key signature";       break;
-                  case 0x7f: comment += "system exclusive";    break;
+                  case 0x00: comment = "sequence number";     break;
+                  case 0x01: comment = "text";                break;
+                  case 0x02: comment = "copyright notice";    break;
+                  case 0x03: comment = "track name";          break;
+                  case 0x04: comment = "instrument name";     break;
+                  case 0x05: comment = "lyric";               break;
+                  case 0x06: comment = "marker";              break;
+                  case 0x07: comment = "cue point";           break;
+                  case 0x08: comment = "program name";        break;
+                  case 0x09: comment = "device name";         break;
+                  case 0x20: comment = "MIDI channel prefix"; break;
+                  case 0x21: comment = "MIDI port";           break;
+                  case 0x51: comment = "tempo";               break;
+                  case 0x54: comment = "SMPTE offset";        break;
+                  case 0x58: comment = "time signature";      break;
+                  case 0x59: comment = "key signature";       break;
+                  case 0x7f: comment = "system exclusive";    break;
                   case 0x2f:
                      status = 0;
-                     comment += "end-of-track";
+                     comment = "end-of-track";
                      break;
                   default:
-                     comment += "meta-message";
+                     comment = "meta-message";
                }
                }
                break;
 
+            default:
+               // other system bytes carry no data here
+               break;
          }
          break;
    }
 
-   out << output.str();
    if (commentsQ) {
-      out << "\t; " << comment;
+      out += "\t; ";
+      out += pitchComment.empty() ? comment : pitchComment.c_str();
    }
 
    return status;
@@ -929,25 +943,103 @@ int Binasc::readMidiEvent(ostream& out, istream& infile, int& trackbytes,
 //
 
 string Binasc::keyToPitchName(int key) {
+   string output;
+   appendPitchName(output, key);
+   return output;
+}
+
+
+
+/////////////////////////////
+//
+// Binasc::appendPitchName -- Same as keyToPitchName() but appends the
+//     name to a text buffer.
+//
+
+void Binasc::appendPitchName(string& out, int key) {
+   static const char* names[12] = { "C", "C#", "D", "D#", "E", "F", "F#",
+         "G", "G#", "A", "A#", "B" };
    int pc = key % 12;
    int octave = key / 12 - 1;
-   stringstream output;
-   switch (pc) {
-      case  0: output << "C";  break;
-      case  1: output << "C#"; break;
-      case  2: output << "D";  break;
-      case  3: output << "D#"; break;
-      case  4: output << "E";  break;
-      case  5: output << "F";  break;
-      case  6: output << "F#"; break;
-      case  7: output << "G";  break;
-      case  8: output << "G#"; break;
-      case  9: output << "A";  break;
-      case 10: output << "A#"; break;
-      case 11: output << "B";  break;
+   if (pc >= 0) {
+      out += names[pc];
+   }
+   appendDecimal(out, octave);
+}
+
+
+
+//////////////////////////////
+//
+// Binasc::appendDecimal -- Append an integer in decimal form to a text
+//     buffer, without going through a stream.
+//
+
+void Binasc::appendDecimal(string& out, long value) {
+   char digits[24];
+   int count = 0;
+   unsigned long magnitude = (value < 0) ? 0UL - (unsigned long)value
+         : (unsigned long)value;
+   do {
+      digits[count++] = (char)('0' + magnitude % 10);
+      magnitude /= 10;
+   } while (magnitude != 0);
+   if (value < 0) {
+      out += '-';
+   }
+   while (count > 0) {
+      out += digits[--count];
+   }
+}
+
+
+
+//////////////////////////////
+//
+// Binasc::appendHex -- Append an integer in lowercase hexadecimal form
+//     with no leading zeros, as "out << hex << value" would.
+//
+
+void Binasc::appendHex(string& out, unsigned long value) {
+   static const char* hexdigits = "0123456789abcdef";
+   char digits[24];
+   int count = 0;
+   do {
+      digits[count++] = hexdigits[value & 0xf];
+      value >>= 4;
+   } while (value != 0);
+   while (count > 0) {
+      out += digits[--count];
+   }
+}
+
+
+
+//////////////////////////////
+//
+// Binasc::appendHexByte -- Append a byte as two hexadecimal digits.
+//
+
+void Binasc::appendHexByte(string& out, uchar value) {
+   static const char* hexdigits = "0123456789abcdef";
+   out += hexdigits[value >> 4];
+   out += hexdigits[value & 0xf];
+}
+
+
+
+//////////////////////////////
+//
+// Binasc::flushBuffer -- Write formatted text to the output once it is
+//     at least the given size, then empty the buffer.  A size of zero
+//     writes whatever remains.
+//
+
+void Binasc::flushBuffer(ostream& out, string& buffer, size_t size) {
+   if ((buffer.size() >= size) && !buffer.empty()) {
+      out.write(buffer.data(), buffer.size());
+      buffer.clear();
    }
-   output << octave;
-   return output.str().c_str();
 }
 
 
@@ -955,189 +1047,223 @@ string Binasc::keyToPitchName(int key) {
 //////////////////////////////
 //
 // Binasc::outputStyleMidi -- Read an input file and output bytes parsed
-//     as a MIDI file (return false if not a MIDI file).
+//     as a MIDI file (return false if not a MIDI file).  The text is only
+//     written once the whole file has been parsed, so nothing is output
+//     for a file which turns out not to be a MIDI file.
 //
 
-int Binasc::outputStyleMidi(ostream& out, istream& input) {
-   uchar ch;                      // current input byte
-   stringstream tempout;
-   input.read((char*)&ch, 1);
+int Binasc::outputStyleMidi(ostream& out, const uchar* data, size_t length) {
+   const uchar* ptr = data;
+   const uchar* end = data + length;
+   string tempout;
+   int hexQ = 0;                  // unknown header bytes switch to hex
 
-   if (input.eof()) {
+   if (length == 0) {
       cerr << "End of the file right away!" << endl;
       return 0;
    }
+   tempout.reserve(length * 8);
 
    // Read the MIDI file header:
 
    // The first four bytes must be the characters "MThd"
-   if (ch != 'M') { cerr << "Not a MIDI file M" << endl; return 0; }
-   input.read((char*)&ch, 1);
-   if (ch != 'T') { cerr << "Not a MIDI file T" << endl; return 0; }
-   input.read((char*)&ch, 1);
-   if (ch != 'h') { cerr << "Not a MIDI file h" << endl; return 0; }
-   input.read((char*)&ch, 1);
-   if (ch != 'd') { cerr << "Not a MIDI file d" << endl; return 0; }
-   tempout << "\"MThd\"";
+   if (!matchByte(ptr, end, 'M', "Not a MIDI file M")) { return 0; }
+   if (!matchByte(ptr, end, 'T', "Not a MIDI file T")) { return 0; }
+   if (!matchByte(ptr, end, 'h', "Not a MIDI file h")) { return 0; }
+   if (!matchByte(ptr, end, 'd', "Not a MIDI file d")) { return 0; }
+   tempout += "\"MThd\"";
    if (commentsQ) {
-      tempout << "\t\t\t; MIDI header chunk marker";
+      tempout += "\t\t\t; MIDI header chunk marker";
    }
-   tempout << endl;
+   tempout += '\n';
 
    // The next four bytes are a big-endian byte count for the header
    // which should nearly always be "6".
-   int headersize = 0;
-   input.read((char*)&ch, 1); headersize = (headersize << 8) | ch;
-   input.read((char*)&ch, 1); headersize = (headersize << 8) | ch;
-   input.read((char*)&ch, 1); headersize = (headersize << 8) | ch;
-   input.read((char*)&ch, 1); headersize = (headersize << 8) | ch;
-   tempout << "4'" << headersize;
+   int headersize = (int)readBytes(ptr, end, 4);
+   tempout += "4'";
+   appendDecimal(tempout, headersize);
    if (commentsQ) {
-      tempout << "\t\t\t; bytes to follow in header chunk";
+      tempout += "\t\t\t; bytes to follow in header chunk";
    }
-   tempout << endl;
+   tempout += '\n';
 
    // First number in header is two-byte file type.
-   int filetype = 0;
-   input.read((char*)&ch, 1);
-   filetype = (filetype << 8) | ch;
-   input.read((char*)&ch, 1);
-   filetype = (filetype << 8) | ch;
-   tempout << "2'" << filetype;
+   int filetype = (int)readBytes(ptr, end, 2);
+   tempout += "2'";
+   appendDecimal(tempout, filetype);
    if (commentsQ) {
-      tempout << "\t\t\t; file format: Type-" << filetype << " (";
+      tempout += "\t\t\t; file format: Type-";
+      appendDecimal(tempout, filetype);
+      tempout += " (";
       switch (filetype) {
-         case 0:  tempout << "single track"; break;
-         case 1:  tempout << "multitrack";   break;
-         case 2:  tempout << "multisegment"; break;
-         default: tempout << "unknown";      break;
+         case 0:  tempout += "single track"; break;
+         case 1:  tempout += "multitrack";   break;
+         case 2:  tempout += "multisegment"; break;
+         default: tempout += "unknown";      break;
       }
-      tempout << ")";
+      tempout += ")";
    }
-   tempout << endl;
+   tempout += '\n';
 
    // Second number in header is two-byte trackcount.
-   int trackcount = 0;
-   input.read((char*)&ch, 1);
-   trackcount = (trackcount << 8) | ch;
-   input.read((char*)&ch, 1);
-   trackcount = (trackcount << 8) | ch;
-   tempout << "2'" << trackcount;
+   int trackcount = (int)readBytes(ptr, end, 2);
+   tempout += "2'";
+   appendDecimal(tempout, trackcount);
    if (commentsQ) {
-      tempout << "\t\t\t; number of tracks";
+      tempout += "\t\t\t; number of tracks";
    }
-   tempout << endl;
+   tempout += '\n';
 
    // Third number is divisions.  This can be one of two types:
    // regular: top bit is 0: number of ticks per quarter note
    // SMPTE:   top bit is 1: first byte is negative frames, second is
    //          ticks per frame.
-   uchar byte1;
-   uchar byte2;
-   input.read((char*)&byte1, 1);
-   input.read((char*)&byte2, 1);
+   uchar byte1 = (uchar)readBytes(ptr, end, 1);
+   uchar byte2 = (uchar)readBytes(ptr, end, 1);
    if (byte1 & 0x80) {
       // SMPTE divisions
-      tempout << "1'-" << 0xff - (ulong)byte1 + 1;
+      tempout += "1'-";
+      appendDecimal(tempout, 0xff - (ulong)byte1 + 1);
       if (commentsQ) {
-         tempout << "\t\t\t; SMPTE frames/second";
+         tempout += "\t\t\t; SMPTE frames/second";
       }
-      tempout << endl;
-      tempout << "1'" << dec << (long)byte2;
+      tempout += '\n';
+      tempout += "1'";
+      appendDecimal(tempout, (long)byte2);
       if (commentsQ) {
-         tempout << "\t\t\t; subframes per frame";
+         tempout += "\t\t\t; subframes per frame";
       }
-      tempout << endl;
+      tempout += '\n';
    } else {
       // regular divisions
-      int divisions = 0;
-      divisions = (divisions << 8) | byte1;
-      divisions = (divisions << 8) | byte2;
-      tempout << "2'" << divisions;
+      int divisions = (byte1 << 8) | byte2;
+      tempout += "2'";
+      appendDecimal(tempout, divisions);
       if (commentsQ) {
-         tempout << "\t\t\t; ticks per quarter note";
+         tempout += "\t\t\t; ticks per quarter note";
       }
-      tempout << endl;
+      tempout += '\n';
    }
 
    // Print any strange bytes in header:
    int i;
    for (i=0; i<headersize - 6; i++) {
-      input.read((char*)&ch, 1);
-      if (ch < 0x10) {
-         tempout << '0';
-      }
-      tempout << hex << (int)ch;
+      appendHexByte(tempout, (uchar)readBytes(ptr, end, 1));
+      hexQ = 1;
    }
    if (headersize - 6 > 0) {
-      tempout << "\t\t\t; unknown header bytes";
-      tempout << endl;
+      tempout += "\t\t\t; unknown header bytes";
+      tempout += '\n';
    }
 
    int trackbytes;
    for (i=0; i<trackcount; i++) {
-      tempout << "\n;;; TRACK "
-              << i << " ----------------------------------" << endl;
+      tempout += "\n;;; TRACK ";
+      appendNumber(tempout, i, hexQ);
+      tempout += " ----------------------------------\n";
 
-      input.read((char*)&ch, 1);
       // The first four bytes of a track must be the characters "MTrk"
-      if (ch != 'M') { cerr << "Not a MIDI file M2" << endl; return 0; }
-      input.read((char*)&ch, 1);
-      if (ch != 'T') { cerr << "Not a MIDI file T2" << endl; return 0; }
-      input.read((char*)&ch, 1);
-      if (ch != 'r') { cerr << "Not a MIDI file r" << endl; return 0; }
-      input.read((char*)&ch, 1);
-      if (ch != 'k') { cerr << "Not a MIDI file k" << endl; return 0; }
-      tempout << "\"MTrk\"";
+      if (!matchByte(ptr, end, 'M', "Not a MIDI file M2")) { return 0; }
+      if (!matchByte(ptr, end, 'T', "Not a MIDI file T2")) { return 0; }
+      if (!matchByte(ptr, end, 'r', "Not a MIDI file r")) { return 0; }
+      if (!matchByte(ptr, end, 'k', "Not a MIDI file k")) { return 0; }
+      tempout += "\"MTrk\"";
       if (commentsQ) {
-         tempout << "\t\t\t; MIDI track chunk marker";
+         tempout += "\t\t\t; MIDI track chunk marker";
       }
-      tempout << endl;
+      tempout += '\n';
 
       // The next four bytes are a big-endian byte count for the track
-      int tracksize = 0;
-      input.read((char*)&ch, 1); tracksize = (tracksize << 8) | ch;
-      input.read((char*)&ch, 1); tracksize = (tracksize << 8) | ch;
-      input.read((char*)&ch, 1); tracksize = (tracksize << 8) | ch;
-      input.read((char*)&ch, 1); tracksize = (tracksize << 8) | ch;
-      tempout << "4'" << tracksize;
+      int tracksize = (int)readBytes(ptr, end, 4);
+      tempout += "4'";
+      appendNumber(tempout, tracksize, hexQ);
       if (commentsQ) {
-         tempout << "\t\t\t; bytes to follow in track chunk";
+         tempout += "\t\t\t; bytes to follow in track chunk";
       }
-      tempout << endl;
+      tempout += '\n';
 
       trackbytes = 0;
       int command = 0;
 
       // process MIDI events until the end of the track
-      while (readMidiEvent(tempout, input, trackbytes, command)) {
-         tempout << "\n";
+      while (ptr < end && readMidiEvent(tempout, ptr, end, trackbytes,
+            command)) {
+         tempout += '\n';
       };
-      tempout << "\n";
+      tempout += '\n';
 
       if (trackbytes != tracksize) {
-         tempout << "; TRACK SIZE ERROR, ACTUAL SIZE: " << trackbytes << endl;
+         tempout += "; TRACK SIZE ERROR, ACTUAL SIZE: ";
+         appendNumber(tempout, trackbytes, hexQ);
+         tempout += '\n';
       }
    }
 
-   // print #define definitions if requested.
+   // print main content of MIDI file parsing:
+   flushBuffer(out, tempout, 0);
+   return 1;
+}
 
 
-   // print main content of MIDI file parsing:
-   out << tempout.str();
+
+//////////////////////////////
+//
+// Binasc::matchByte -- Check one byte of a chunk marker, printing the
+//     given message if it does not match.
+//
+
+int Binasc::matchByte(const uchar*& ptr, const uchar* end, uchar value,
+      const char* message) {
+   if ((ptr >= end) || (*ptr != value)) {
+      cerr << message << endl;
+      return 0;
+   }
+   ptr++;
    return 1;
 }
 
 
 
+//////////////////////////////
+//
+// Binasc::readBytes -- Read a big-endian number of the given byte count.
+//     Missing bytes at the end of the data read as zero.
+//
+
+ulong Binasc::readBytes(const uchar*& ptr, const uchar* end, int count) {
+   ulong output = 0;
+   for (int i=0; i<count; i++) {
+      output = (output << 8) | ((ptr < end) ? *ptr++ : 0);
+   }
+   return output;
+}
+
+
+
+//////////////////////////////
+//
+// Binasc::appendNumber -- Append a number in decimal, or in hexadecimal
+//     if the output has been switched to hex.
+//
+
+void Binasc::appendNumber(string& out, long value, int hexQ) {
+   if (hexQ) {
+      appendHex(out, (unsigned long)value);
+   } else {
+      appendDecimal(out, value);
+   }
+}
+
+
+
 //////////////////////////////
 //
 // Binasc::processDecimalWord -- interprets a decimal word into
 //     constituent bytes
 //
 
-int Binasc::processDecimalWord(ostream& out, const string& word, int lineNum) {
-   int length = (int)word.size();        // length of ascii binary number
+int Binasc::processDecimalWord(vector<uchar>& out, const char* word,
+      int length, int lineNum) {
    int byteCount = -1;              // number of bytes to output
    int quoteIndex = -1;             // index of decimal specifier
    int signIndex = -1;              // index of any sign for number
@@ -1150,8 +1276,7 @@ int Binasc::processDecimalWord(ostream& out, const string& word, int lineNum) {
       switch (word[i]) {
          case '\'':
             if (quoteIndex != -1) {
-               cerr << "Error on line " << lineNum << " at token: " << word
-                    << endl;
+               printWordError(word, length, lineNum);
                cerr << "extra quote in decimal number" << endl;
                return 0;
             } else {
@@ -1160,8 +1285,7 @@ int Binasc::processDecimalWord(ostream& out, const string& word, int lineNum) {
             break;
          case '-':
             if (signIndex != -1) {
-               cerr << "Error on line " << lineNum << " at token: " << word
-                    << endl;
+               printWordError(word, length, lineNum);
                cerr << "cannot have more than two minus signs in number"
                     << endl;
                return 0;
@@ -1169,22 +1293,19 @@ int Binasc::processDecimalWord(ostream& out, const string& word, int lineNum) {
                signIndex = i;
             }
             if (i == 0 || word[i-1] != '\'') {
-               cerr << "Error on line " << lineNum << " at token: " << word
-                    << endl;
+               printWordError(word, length, lineNum);
                cerr << "minus sign must immediately follow quote mark" << endl;
                return 0;
             }
             break;
          case '.':
             if (quoteIndex == -1) {
-               cerr << "Error on line " << lineNum << " at token: " << word
-                    << endl;
+               printWordError(word, length, lineNum);
                cerr << "cannot have decimal marker before quote" << endl;
                return 0;
             }
             if (periodIndex != -1) {
-               cerr << "Error on line " << lineNum << " at token: " << word
-                    << endl;
+               printWordError(word, length, lineNum);
                cerr << "extra period in decimal number" << endl;
                return 0;
             } else {
@@ -1194,14 +1315,12 @@ int Binasc::processDecimalWord(ostream& out, const string& word, int lineNum) {
          case 'u':
          case 'U':
             if (quoteIndex != -1) {
-               cerr << "Error on line " << lineNum << " at token: " << word
-                    << endl;
+               printWordError(word, length, lineNum);
                cerr << "cannot have endian specified after quote" << endl;
                return 0;
             }
             if (endianIndex != -1) {
-               cerr << "Error on line " << lineNum << " at token: " << word
-                    << endl;
+               printWordError(word, length, lineNum);
                cerr << "extra \"u\" in decimal number" << endl;
                return 0;
             } else {
@@ -1211,8 +1330,7 @@ int Binasc::processDecimalWord(ostream& out, const string& word, int lineNum) {
          case '8':
          case '1': case '2': case '3': case '4':
             if (quoteIndex == -1 && byteCount != -1) {
-               cerr << "Error on line " << lineNum << " at token: " << word
-                    << endl;
+               printWordError(word, length, lineNum);
                cerr << "invalid byte specificaton before quote in "
                     << "decimal number" << endl;
                return 0;
@@ -1222,16 +1340,14 @@ int Binasc::processDecimalWord(ostream& out, const string& word, int lineNum) {
             break;
          case '0': case '5': case '6': case '7': case '9':
             if (quoteIndex == -1) {
-               cerr << "Error on line " << lineNum << " at token: " << word
-                    << endl;
+               printWordError(word, length, lineNum);
                cerr << "cannot have numbers before quote in decimal number"
                     << endl;
                return 0;
             }
             break;
          default:
-            cerr << "Error on line " << lineNum << " at token: " << word
-                 << endl;
+            printWordError(word, length, lineNum);
             cerr << "Invalid character in decimal number"
                     " (character number " << i <<")" << endl;
             return 0;
@@ -1241,21 +1357,18 @@ int Binasc::processDecimalWord(ostream& out, const string& word, int lineNum) {
    // there must be a quote character to indicate a decimal number
    // and there must be a decimal number after the quote
    if (quoteIndex == -1) {
-      cerr << "Error on line " << lineNum << " at token: " << word
-           << endl;
+      printWordError(word, length, lineNum);
       cerr << "there must be a quote to signify a decimal number" << endl;
       return 0;
    } else if (quoteIndex == length - 1) {
-      cerr << "Error on line " << lineNum << " at token: " << word
-           << endl;
+      printWordError(word, length, lineNum);
       cerr << "there must be a decimal number after the quote" << endl;
       return 0;
    }
 
    // 8 byte decimal output can only occur if reading a double number
    if (periodIndex == -1 && byteCount == 8) {
-      cerr << "Error on line " << lineNum << " at token: " << word
-           << endl;
+      printWordError(word, length, lineNum);
       cerr << "only floating-point numbers can use 8 bytes" << endl;
       return 0;
    }
@@ -1267,30 +1380,33 @@ int Binasc::processDecimalWord(ostream& out, const string& word, int lineNum) {
       }
    }
 
+   const char* number = word + quoteIndex + 1;
+   const char* end    = word + length;
+   int littleEndian   = (endianIndex != -1);
+
    // process any floating point numbers possibilities
    if (periodIndex != -1) {
-      double doubleOutput = atof(&word[quoteIndex+1]);
+      double doubleOutput = parseFloat(number, end);
       float  floatOutput  = (float)doubleOutput;
       switch (byteCount) {
          case 4:
-           if (endianIndex == -1) {
-              writeBigEndianFloat(out, floatOutput);
-           } else {
-              writeLittleEndianFloat(out, floatOutput);
-           }
-           return 1;
-           break;
+            {
+            uint32_t bits;
+            memcpy(&bits, &floatOutput, sizeof(bits));
+            appendBytes(out, bits, 4, littleEndian);
+            }
+            return 1;
+            break;
          case 8:
-           if (endianIndex == -1) {
-              writeBigEndianDouble(out, doubleOutput);
-           } else {
-              writeLittleEndianDouble(out, doubleOutput);
-           }
-           return 1;
-           break;
+            {
+            uint64_t bits;
+            memcpy(&bits, &doubleOutput, sizeof(bits));
+            appendBytes(out, bits, 8, littleEndian);
+            }
+            return 1;
+            break;
          default:
-            cerr << "Error on line " << lineNum << " at token: " << word
-                 << endl;
+            printWordError(word, length, lineNum);
             cerr << "floating-point numbers can be only 4 or 8 bytes" << endl;
             return 0;
       }
@@ -1301,115 +1417,45 @@ int Binasc::processDecimalWord(ostream& out, const string& word, int lineNum) {
    // default integer size is one byte, if size is not specified, then
    // the number must be in the one byte range and cannot overflow
    // the byte if the size of the decimal number is not specified
+   int value = parseInteger(number, end);
    if (byteCount == -1) {
       if (signIndex != -1) {
-         long tempLong = atoi(&word[quoteIndex + 1]);
-         if (tempLong > 127 || tempLong < -128) {
-            cerr << "Error on line " << lineNum << " at token: " << word
-                 << endl;
+         if (value > 127 || value < -128) {
+            printWordError(word, length, lineNum);
             cerr << "Decimal number out of range from -128 to 127" << endl;
             return 0;
          }
-         char charOutput = (char)tempLong;
-         out << charOutput;
-         return 1;
-      } else {
-         ulong tempLong = (ulong)atoi(&word[quoteIndex + 1]);
-         uchar ucharOutput = (uchar)tempLong;
-         if (tempLong > 255) { // || (tempLong < 0)) {
-            cerr << "Error on line " << lineNum << " at token: " << word
-                 << endl;
-            cerr << "Decimal number out of range from 0 to 255" << endl;
-            return 0;
-         }
-         out << ucharOutput;
-         return 1;
+      } else if ((ulong)value > 255) {
+         printWordError(word, length, lineNum);
+         cerr << "Decimal number out of range from 0 to 255" << endl;
+         return 0;
       }
+      out.push_back((uchar)value);
+      return 1;
    }
 
    // left with an integer number with a specified number of bytes
    switch (byteCount) {
       case 1:
-         if (signIndex != -1) {
-            long tempLong = atoi(&word[quoteIndex + 1]);
-            char charOutput = (char)tempLong;
-            out << charOutput;
-            return 1;
-         } else {
-            ulong tempLong = (ulong)atoi(&word[quoteIndex + 1]);
-            uchar ucharOutput = (uchar)tempLong;
-            out << ucharOutput;
-            return 1;
-         }
-         break;
       case 2:
-         if (signIndex != -1) {
-            long tempLong = atoi(&word[quoteIndex + 1]);
-            short shortOutput = (short)tempLong;
-            if (endianIndex == -1) {
-               writeBigEndianShort(out, shortOutput);
-            } else {
-               writeLittleEndianShort(out, shortOutput);
-            }
-            return 1;
-         } else {
-            ulong tempLong = (ulong)atoi(&word[quoteIndex + 1]);
-            ushort ushortOutput = (ushort)tempLong;
-            if (endianIndex == -1) {
-               writeBigEndianUShort(out, ushortOutput);
-            } else {
-               writeLittleEndianUShort(out, ushortOutput);
-            }
-            return 1;
-         }
+      case 4:
+         appendBytes(out, (unsigned long long)(unsigned)value, byteCount,
+               littleEndian);
+         return 1;
          break;
       case 3:
-         {
          if (signIndex != -1) {
-            cerr << "Error on line " << lineNum << " at token: " << word
-                 << endl;
+            printWordError(word, length, lineNum);
             cerr << "negative decimal numbers cannot be stored in 3 bytes"
                  << endl;
             return 0;
          }
-         ulong tempLong = (ulong)atoi(&word[quoteIndex + 1]);
-         uchar byte1 = (tempLong & 0x00ff0000) >> 16;
-         uchar byte2 = (tempLong & 0x0000ff00) >>  8;
-         uchar byte3 = (tempLong & 0x000000ff);
-         if (endianIndex == -1) {
-            out << byte1;
-            out << byte2;
-            out << byte3;
-         } else {
-            out << byte3;
-            out << byte2;
-            out << byte1;
-         }
+         appendBytes(out, (unsigned long long)(unsigned)value, 3,
+               littleEndian);
          return 1;
-         }
-         break;
-      case 4:
-         if (signIndex != -1) {
-            long tempLong = atoi(&word[quoteIndex + 1]);
-            if (endianIndex == -1) {
-               writeBigEndianLong(out, tempLong);
-            } else {
-               writeLittleEndianLong(out, tempLong);
-            }
-            return 1;
-         } else {
-            ulong tempuLong = (ulong)atoi(&word[quoteIndex + 1]);
-            if (endianIndex == -1) {
-               writeBigEndianULong(out, tempuLong);
-            } else {
-               writeLittleEndianULong(out, tempuLong);
-            }
-            return 1;
-         }
          break;
       default:
-         cerr << "Error on line " << lineNum << " at token: " << word
-              << endl;
+         printWordError(word, length, lineNum);
          cerr << "invalid byte count specification for decimal number" << endl;
          return 0;
    }
@@ -1425,37 +1471,27 @@ int Binasc::processDecimalWord(ostream& out, const string& word, int lineNum) {
 //     its binary byte form.
 //
 
-int Binasc::processHexWord(ostream& out, const string& word, int lineNum) {
-   int length = (int)word.size();
-   uchar outputByte;
-
+int Binasc::processHexWord(vector<uchar>& out, const char* word, int length,
+      int lineNum) {
    if (length > 2) {
-      cerr << "Error on line " << lineNum << " at token: " << word << endl;
+      printWordError(word, length, lineNum);
       cerr << "Size of hexadecimal number is too large.  Max is ff." << endl;
       return 0;
    }
 
    if (!isxdigit(word[0]) || (length == 2 && !isxdigit(word[1]))) {
-      cerr << "Error on line " << lineNum << " at token: " << word << endl;
+      printWordError(word, length, lineNum);
       cerr << "Invalid character in hexadecimal number." << endl;
       return 0;
    }
 
-   outputByte = (uchar)strtol(word.c_str(), (char**)NULL, 16);
-   out << outputByte;
-   return 1;
-}
-
-
-
-//////////////////////////////
-//
-// Binasc::processStringWord -- interprets a binary word into
-//     its constituent byte
-//
-
-int Binasc::processStringWord(ostream& out, const string& word, int lineNum) {
-   out << word;
+   uchar outputByte = 0;
+   for (int i=0; i<length; i++) {
+      char ch = word[i];
+      int digit = (ch <= '9') ? ch - '0' : (ch | 0x20) - 'a' + 10;
+      outputByte = (uchar)((outputByte << 4) | digit);
+   }
+   out.push_back(outputByte);
    return 1;
 }
 
@@ -1467,18 +1503,18 @@ int Binasc::processStringWord(ostream& out, const string& word, int lineNum) {
 //     its constituent byte
 //
 
-int Binasc::processAsciiWord(ostream& out, const string& word, int lineNum) {
-   int length = (int)word.size();
+int Binasc::processAsciiWord(vector<uchar>& out, const char* word, int length,
+      int lineNum) {
    uchar outputByte;
 
    if (word[0] != '+') {
-      cerr << "Error on line " << lineNum << " at token: " << word << endl;
+      printWordError(word, length, lineNum);
       cerr << "character byte must start with \'+\' sign: " << endl;
       return 0;
    }
 
    if (length > 2) {
-      cerr << "Error on line " << lineNum << " at token: " << word << endl;
+      printWordError(word, length, lineNum);
       cerr << "character byte word is too long -- specify only one character"
            << endl;
       return 0;
@@ -1489,7 +1525,7 @@ int Binasc::processAsciiWord(ostream& out, const string& word, int lineNum) {
    } else {
       outputByte = ' ';
    }
-   out << outputByte;
+   out.push_back(outputByte);
    return 1;
 }
 
@@ -1501,8 +1537,8 @@ int Binasc::processAsciiWord(ostream& out, const string& word, int lineNum) {
 //     its constituent byte
 //
 
-int Binasc::processBinaryWord(ostream& out, const string& word, int lineNum) {
-   int length = (int)word.size();        // length of ascii binary number
+int Binasc::processBinaryWord(vector<uchar>& out, const char* word,
+      int length, int lineNum) {
    int commaIndex = -1;             // index location of comma in number
    int leftDigits = -1;             // number of digits to left of comma
    int rightDigits = -1;            // number of digits to right of comma
@@ -1512,16 +1548,14 @@ int Binasc::processBinaryWord(ostream& out, const string& word, int lineNum) {
    for (i=0; i<length; i++) {
       if (word [i] == ',') {
          if (commaIndex != -1) {
-            cerr << "Error on line " << lineNum << " at token: " << word
-                 << endl;
+            printWordError(word, length, lineNum);
             cerr << "extra comma in binary number" << endl;
             return 0;
          } else {
             commaIndex = i;
          }
       } else if (!(word[i] == '1' || word[i] == '0')) {
-         cerr << "Error on line " << lineNum << " at token: " << word
-              << endl;
+         printWordError(word, length, lineNum);
          cerr << "Invalid character in binary number"
                  " (character is " << word[i] <<")" << endl;
          return 0;
@@ -1530,13 +1564,11 @@ int Binasc::processBinaryWord(ostream& out, const string& word, int lineNum) {
 
    // comma cannot start or end number
    if (commaIndex == 0) {
-      cerr << "Error on line " << lineNum << " at token: " << word
-           << endl;
+      printWordError(word, length, lineNum);
       cerr << "cannot start binary number with a comma" << endl;
       return 0;
    } else if (commaIndex == length - 1 ) {
-      cerr << "Error on line " << lineNum << " at token: " << word
-           << endl;
+      printWordError(word, length, lineNum);
       cerr << "cannot end binary number with a comma" << endl;
       return 0;
    }
@@ -1547,21 +1579,18 @@ int Binasc::processBinaryWord(ostream& out, const string& word, int lineNum) {
       leftDigits = commaIndex;
       rightDigits = length - commaIndex - 1;
    } else if (length > 8) {
-      cerr << "Error on line " << lineNum << " at token: " << word
-           << endl;
+      printWordError(word, length, lineNum);
       cerr << "too many digits in binary number" << endl;
       return 0;
    }
    // if there is a comma, then there cannot be more than 4 digits on a side
    if (leftDigits > 4) {
-      cerr << "Error on line " << lineNum << " at token: " << word
-           << endl;
+      printWordError(word, length, lineNum);
       cerr << "too many digits to left of comma" << endl;
       return 0;
    }
    if (rightDigits > 4) {
-      cerr << "Error on line " << lineNum << " at token: " << word
-           << endl;
+      printWordError(word, length, lineNum);
       cerr << "too many digits to right of comma" << endl;
       return 0;
    }
@@ -1591,7 +1620,7 @@ int Binasc::processBinaryWord(ostream& out, const string& word, int lineNum) {
    }
 
    // send the byte to the output
-   out << output;
+   out.push_back(output);
    return 1;
 }
 
@@ -1608,8 +1637,9 @@ int Binasc::processBinaryWord(ostream& out, const string& word, int lineNum) {
 //   without space by an integer.
 //
 
-int Binasc::processVlvWord(ostream& out, const string& word, int lineNum) {
-   if (word.size() < 2) {
+int Binasc::processVlvWord(vector<uchar>& out, const char* word, int length,
+      int lineNum) {
+   if (length < 2) {
       cerr << "Error on line: " << lineNum
            << ": 'v' needs to be followed immediately by a decimal digit"
            << endl;
@@ -1621,7 +1651,7 @@ int Binasc::processVlvWord(ostream& out, const string& word, int lineNum) {
            << endl;
       return 0;
    }
-   ulong value = atoi(&word[1]);
+   ulong value = parseInteger(word + 1, word + length);
 
    uchar byte[5];
    byte[0] = (value >> 28) & 0x7f;
@@ -1643,7 +1673,7 @@ int Binasc::processVlvWord(ostream& out, const string& word, int lineNum) {
 
    for (i=0; i<5; i++) {
       if (byte[i] >= 0x80 || i == 4) {
-         out << byte[i];
+         out.push_back(byte[i]);
       }
    }
 
@@ -1658,9 +1688,9 @@ int Binasc::processVlvWord(ostream& out, const string& word, int lineNum) {
 //   a three-byte number of microseconds per beat per minute value.
 //
 
-int Binasc::processMidiTempoWord(ostream& out, const string& word,
-      int lineNum) {
-   if (word.size() < 2) {
+int Binasc::processMidiTempoWord(vector<uchar>& out, const char* word,
+      int length, int lineNum) {
+   if (length < 2) {
       cerr << "Error on line: " << lineNum
            << ": 't' needs to be followed immediately by "
            << "a floating-point number" << endl;
@@ -1673,18 +1703,14 @@ int Binasc::processMidiTempoWord(ostream& out, const string& word,
            << "a floating-point number" << endl;
       return 0;
    }
-   double value = strtod(&word[1], NULL);
+   double value = parseFloat(word + 1, word + length);
 
    if (value < 0.0) {
       value = -value;
    }
 
    int intval = int(60.0 * 1000000.0 / value + 0.5);
-
-   uchar byte0 = intval & 0xff;
-   uchar byte1 = (intval >>  8) & 0xff;
-   uchar byte2 = (intval >> 16) & 0xff;
-   out << byte2 << byte1 << byte0;
+   appendBytes(out, (unsigned)intval, 3, 0);
    return 1;
 }
 
@@ -1699,9 +1725,9 @@ int Binasc::processMidiTempoWord(ostream& out, const string& word,
 //   7-bits of the 14-bit value, then the MSB coming second and containing
 //   the top 7-bits of the 14-bit value.
 
-int Binasc::processMidiPitchBendWord(ostream& out, const string& word,
-      int lineNum) {
-   if (word.size() < 2) {
+int Binasc::processMidiPitchBendWord(vector<uchar>& out, const char* word,
+      int length, int lineNum) {
+   if (length < 2) {
       cerr << "Error on line: " << lineNum
            << ": 'p' needs to be followed immediately by "
            << "a floating-point number" << endl;
@@ -1714,7 +1740,7 @@ int Binasc::processMidiPitchBendWord(ostream& out, const string& word,
            << "a floating-point number" << endl;
       return 0;
    }
-   double value = strtod(&word[1], NULL);
+   double value = parseFloat(word + 1, word + length);
 
    if (value > 1.0) {
       value = 1.0;
@@ -1724,9 +1750,8 @@ int Binasc::processMidiPitchBendWord(ostream& out, const string& word,
    }
 
    int intval = (int)(((1 << 13)-0.5)  * (value + 1.0) + 0.5);
-   uchar LSB = intval & 0x7f;
-   uchar MSB = (intval >>  7) & 0x7f;
-   out << LSB << MSB;
+   out.push_back(intval & 0x7f);
+   out.push_back((intval >> 7) & 0x7f);
    return 1;
 }
 
@@ -2,6 +2,8 @@
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Mon Feb 16 12:26:32 PST 2015 Adapted from binasc program.
 // Last Modified: Wed Feb 18 14:48:21 PST 2015
+// Last Modified: Fri Oct 16 14:12:08 PDT 2026 Assemble from memory buffers.
+// Last Modified: Fri Oct 16 15:40:51 PDT 2026 Disassemble from memory buffers.
 // Filename:      midifile/include/Binasc.cpp
 // Syntax:        C++11
 // vim:           ts=3 expandtab
@@ -15,6 +17,7 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
 
 using namespace std;
 
@@ -50,12 +53,16 @@ class Binasc {
       int      writeToBinary  (const string& outfile, istream& input);
       int      writeToBinary  (ostream& out, const string& infile);
       int      writeToBinary  (ostream& out, istream& input);
+      int      writeToBinary  (vector<uchar>& out, const uchar* data,
+                               size_t length);
 
       // functions for converting into an ASCII file with hex bytes:
       int      readFromBinary (const string& outfile, const string& infile);
       int      readFromBinary (const string& outfile, istream& input);
       int      readFromBinary (ostream& out, const string& infile);
       int      readFromBinary (ostream& out, istream& input);
+      int      readFromBinary (ostream& out, const uchar* data,
+                               size_t length);
 
       // static functions for writing ordered bytes:
       static ostream& writeLittleEndianUShort (ostream& out, ushort value);
@@ -75,37 +82,56 @@ class Binasc {
 
    protected:
       // helper functions for reading ASCII content to conver to binary:
-      int      processLine        (ostream& out, const string& input,
-                                   int lineNum);
-      int      processAsciiWord   (ostream& out, const string& input,
-                                   int lineNum);
-      int      processStringWord  (ostream& out, const string& input,
-                                   int lineNum);
-      int      processBinaryWord  (ostream& out, const string& input,
-                                   int lineNum);
-      int      processDecimalWord (ostream& out, const string& input,
-                                   int lineNum);
-      int      processHexWord     (ostream& out, const string& input,
-                                   int lineNum);
-      int      processVlvWord     (ostream& out, const string& input,
-                                   int lineNum);
-      int      processMidiPitchBendWord(ostream& out, const string& input,
-                                   int lineNum);
-      int      processMidiTempoWord(ostream& out, const string& input,
-                                   int lineNum);
+      int      processLine        (vector<uchar>& out, const char* input,
+                                   int length, int lineNum);
+      int      processAsciiWord   (vector<uchar>& out, const char* word,
+                                   int length, int lineNum);
+      int      processBinaryWord  (vector<uchar>& out, const char* word,
+                                   int length, int lineNum);
+      int      processDecimalWord (vector<uchar>& out, const char* word,
+                                   int length, int lineNum);
+      int      processHexWord     (vector<uchar>& out, const char* word,
+                                   int length, int lineNum);
+      int      processVlvWord     (vector<uchar>& out, const char* word,
+                                   int length, int lineNum);
+      int      processMidiPitchBendWord(vector<uchar>& out, const char* word,
+                                   int length, int lineNum);
+      int      processMidiTempoWord(vector<uchar>& out, const char* word,
+                                   int length, int lineNum);
+      static void   printWordError(const char* word, int length, int lineNum);
+      static int    parseInteger  (const char* start, const char* end);
+      static double parseFloat    (const char* start, const char* end);
+      static void   appendBytes   (vector<uchar>& out, unsigned long long value,
+                                   int byteCount, int littleEndian);
 
       // helper functions for reading binary content to convert to ASCII:
-      int      outputStyleAscii   (ostream& out, istream& input);
-      int      outputStyleBinary  (ostream& out, istream& input);
-      int      outputStyleBoth    (ostream& out, istream& input);
-      int      outputStyleMidi    (ostream& out, istream& input);
+      int      outputStyleAscii   (ostream& out, const uchar* data,
+                                   size_t length);
+      int      outputStyleBinary  (ostream& out, const uchar* data,
+                                   size_t length);
+      int      outputStyleBoth    (ostream& out, const uchar* data,
+                                   size_t length);
+      int      outputStyleMidi    (ostream& out, const uchar* data,
+                                   size_t length);
 
       // MIDI parsing helper functions:
-      int      readMidiEvent  (ostream& out, istream& infile, int& trackbytes,
+      int      readMidiEvent  (string& out, const uchar*& ptr,
+                               const uchar* end, int& trackbytes,
                                int& command);
-      int      getVLV         (istream& infile, int& trackbytes);
-      int      getWord        (string& word, const string& input,
-                               const string& terminators, int index);
+      int      getVLV         (const uchar*& ptr, const uchar* end,
+                               int& trackbytes);
+      static int   matchByte  (const uchar*& ptr, const uchar* end,
+                               uchar value, const char* message);
+      static ulong readBytes  (const uchar*& ptr, const uchar* end,
+                               int count);
+
+      // text formatting helper functions:
+      static void appendDecimal   (string& out, long value);
+      static void appendHex       (string& out, unsigned long value);
+      static void appendHexByte   (string& out, uchar value);
+      static void appendNumber    (string& out, long value, int hexQ);
+      static void appendPitchName (string& out, int key);
+      static void flushBuffer     (ostream& out, string& buffer, size_t size);
 
 
    private:
@@ -114,6 +140,8 @@ class Binasc {
       int midiQ;         // output ASCII data as parsed MIDI file.
       int maxLineLength; // number of character in ASCII output on a line.
       int maxLineBytes;  // number of hex bytes in ASCII output on a line.
+
+      enum { BUFFER_SIZE = 1 << 16 };  // output is written in blocks this size
 };
 
 
@@ -2,6 +2,8 @@
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Feb 14 21:47:39 PST 2015
 // Last Modified: Sat Feb 14 21:54:52 PST 2015
+// Last Modified: Fri Oct 16 13:05:51 PDT 2026 Pooled event allocation.
+// Last Modified: Fri Oct 16 21:40:12 PDT 2026 Pool removed; files use arenas.
 // Filename:      midifile/include/MidiEvent.h
 // Website:       http://midifile.sapp.org
 // Syntax:        C++11
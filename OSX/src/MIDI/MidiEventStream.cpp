@@ -0,0 +1,401 @@
+//
+// Creation Date: Fri Oct 16 11:02:17 PDT 2026
+// Last Modified: Fri Oct 16 11:02:17 PDT 2026
+// Filename:      midifile/src/MidiEventStream.cpp
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Pull-based reader which returns the events of a Standard
+//                MIDI File one at a time in time order, merging the tracks
+//                on the fly.  Only one pending event per track is held in
+//                memory, so playback can begin before a large file has been
+//                fully decoded.
+//
+
+#include "MidiEventStream.h"
+#include "Binasc.h"
+
+#include <string.h>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+
+using namespace std;
+
+
+//////////////////////////////
+//
+// MidiEventStream::MidiEventStream -- Constructor.
+//
+
+MidiEventStream::MidiEventStream(void) {
+   mapped = NULL;
+   data = NULL;
+   length = 0;
+   ticksPerQuarterNote = 120;
+   rwstatus = 0;
+   eventCount = 0;
+   lasttick = 0;
+   lastsec = 0.0;
+   secondsPerTick = 0.0;
+}
+
+
+MidiEventStream::MidiEventStream(const char* aFile) {
+   mapped = NULL;
+   data = NULL;
+   length = 0;
+   ticksPerQuarterNote = 120;
+   rwstatus = 0;
+   eventCount = 0;
+   lasttick = 0;
+   lastsec = 0.0;
+   secondsPerTick = 0.0;
+   open(aFile);
+}
+
+
+MidiEventStream::MidiEventStream(const string& aFile) {
+   mapped = NULL;
+   data = NULL;
+   length = 0;
+   ticksPerQuarterNote = 120;
+   rwstatus = 0;
+   eventCount = 0;
+   lasttick = 0;
+   lastsec = 0.0;
+   secondsPerTick = 0.0;
+   open(aFile);
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventStream::~MidiEventStream -- Deconstructor.
+//
+
+MidiEventStream::~MidiEventStream() {
+   close();
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventStream::open -- Prepare a Standard MIDI File (or its binasc
+//    equivalent) for streaming.  Only the header and the track chunk
+//    boundaries are read here; events are decoded on demand by next().
+//    Returns 0 if the file could not be opened or is not a MIDI file.
+//
+
+int MidiEventStream::open(const char* aFile) {
+   close();
+   mapped = new _MappedFile(aFile);
+   if (!mapped->isOpen()) {
+      close();
+      return 0;
+   }
+   data = mapped->data();
+   length = mapped->size();
+   rwstatus = parseHeader();
+   return rwstatus;
+}
+
+
+int MidiEventStream::open(const string& aFile) {
+   return open(aFile.c_str());
+}
+
+
+//
+// memory version of open().  The bytes are not copied, so they must
+// remain valid until the stream is closed.
+//
+
+int MidiEventStream::open(const uchar* bytes, size_t size) {
+   close();
+   data = bytes;
+   length = size;
+   rwstatus = parseHeader();
+   return rwstatus;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventStream::close -- Release the input file.
+//
+
+void MidiEventStream::close(void) {
+   if (mapped != NULL) {
+      delete mapped;
+      mapped = NULL;
+   }
+   converted.clear();
+   data = NULL;
+   length = 0;
+   cursors.clear();
+   heap.clear();
+   eventCount = 0;
+   rwstatus = 0;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventStream::isOpen -- Returns true if a MIDI file is ready to
+//    be streamed.
+//
+
+int MidiEventStream::isOpen(void) const {
+   return rwstatus;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventStream::status -- Returns 0 if opening the file or decoding
+//    its events failed; otherwise returns 1.
+//
+
+int MidiEventStream::status(void) const {
+   return rwstatus;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventStream::rewind -- Restart the stream at the first event.
+//
+
+void MidiEventStream::rewind(void) {
+   heap.clear();
+   eventCount = 0;
+   lasttick = 0;
+   lastsec = 0.0;
+   double defaultTempo = 120.0;
+   secondsPerTick = 60.0 / (defaultTempo * ticksPerQuarterNote);
+
+   const uchar* ptr = data + 14;
+   const uchar* end = data + length;
+   for (int i=0; i<(int)cursors.size(); i++) {
+      // the chunk ID and size were checked when the stream was opened:
+      ulong size = MidiFile::readLittleEndian4Bytes(ptr + 4);
+      ptr += 8;
+      if (size > (ulong)(end - ptr)) {
+         size = (ulong)(end - ptr);
+      }
+      cursors[i].ptr = ptr;
+      cursors[i].end = ptr + size;
+      cursors[i].running = 0;
+      cursors[i].tick = 0;
+      cursors[i].done = 0;
+      cursors[i].pending.clear();
+      ptr += size;
+      if (advance(i)) {
+         heap.push_back(i);
+      }
+   }
+
+   auto comparison = [this](int a, int b) { return later(a, b) != 0; };
+   make_heap(heap.begin(), heap.end(), comparison);
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventStream::next -- Store the next event in time order into the
+//    given event and return 1, or return 0 when all tracks have been
+//    exhausted.  Events at the same tick are returned in track order and
+//    then in file order, as after MidiFile::joinTracks().  The .tick
+//    value is absolute, .track is the source track and .seconds is
+//    calculated from the tempo messages returned so far.
+//
+
+int MidiEventStream::next(MidiEvent& event) {
+   if (heap.empty()) {
+      return 0;
+   }
+
+   auto comparison = [this](int a, int b) { return later(a, b) != 0; };
+   pop_heap(heap.begin(), heap.end(), comparison);
+   int track = heap.back();
+   heap.pop_back();
+
+   _TrackCursor& cursor = cursors[track];
+   event = cursor.pending;
+
+   if (cursor.tick > lasttick) {
+      lastsec += (cursor.tick - lasttick) * secondsPerTick;
+      lasttick = cursor.tick;
+   }
+   event.seconds = lastsec;
+   if (event.isTempo()) {
+      secondsPerTick = event.getTempoSPT(ticksPerQuarterNote);
+   }
+   eventCount++;
+
+   if (advance(track)) {
+      heap.push_back(track);
+      push_heap(heap.begin(), heap.end(), comparison);
+   }
+   return 1;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventStream::getTrackCount -- Return the number of tracks in the
+//    MIDI file.
+//
+
+int MidiEventStream::getTrackCount(void) const {
+   return (int)cursors.size();
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventStream::getTicksPerQuarterNote -- Return the time base of
+//    the MIDI file.
+//
+
+int MidiEventStream::getTicksPerQuarterNote(void) const {
+   return ticksPerQuarterNote;
+}
+
+//
+// Alias for getTicksPerQuarterNote:
+//
+
+int MidiEventStream::getTPQ(void) const {
+   return getTicksPerQuarterNote();
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventStream::getEventCount -- Return the number of events returned
+//    by next() since the stream was opened or rewound.
+//
+
+int MidiEventStream::getEventCount(void) const {
+   return eventCount;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// private functions
+//
+
+//////////////////////////////
+//
+// MidiEventStream::parseHeader -- Check the MThd chunk, then locate the
+//    MTrk chunks from their size fields and prime one cursor per track.
+//    Unlike MidiFile::read(), the chunk sizes must be correct since the
+//    tracks are decoded side by side.
+//
+
+int MidiEventStream::parseHeader(void) {
+   if (length == 0 || data[0] != 'M') {
+      // presume binasc content, so convert it to binary first.
+      Binasc binasc;
+      binasc.writeToBinary(converted, data, length);
+      data = converted.data();
+      length = converted.size();
+   }
+
+   if ((length < 14) || (memcmp(data, "MThd", 4) != 0) ||
+         (MidiFile::readLittleEndian4Bytes(data + 4) != 6)) {
+      cerr << "Bad MIDI data input" << endl;
+      return 0;
+   }
+   int type   = MidiFile::readLittleEndian2Bytes(data + 8);
+   int tracks = MidiFile::readLittleEndian2Bytes(data + 10);
+   ticksPerQuarterNote = MidiFile::readLittleEndian2Bytes(data + 12);
+   if ((type > 1) || (type == 0 && tracks != 1)) {
+      cerr << "Error: cannot stream a type-" << type << " MIDI file with "
+           << tracks << " tracks" << endl;
+      return 0;
+   }
+
+   const uchar* ptr = data + 14;
+   const uchar* end = data + length;
+   for (int i=0; i<tracks; i++) {
+      if ((end - ptr < 8) || (memcmp(ptr, "MTrk", 4) != 0)) {
+         cerr << "Error: cannot find MTrk chunk for track " << i << endl;
+         return 0;
+      }
+      ulong size = MidiFile::readLittleEndian4Bytes(ptr + 4);
+      ptr += 8;
+      ptr += size < (ulong)(end - ptr) ? size : (ulong)(end - ptr);
+   }
+
+   cursors.resize(tracks);
+   rwstatus = 1;
+   rewind();
+   return rwstatus;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventStream::advance -- Decode the next event of a track into its
+//    cursor.  Returns 0 when the track has no more events.
+//
+
+int MidiEventStream::advance(int track) {
+   _TrackCursor& cursor = cursors[track];
+   if (cursor.done || (cursor.ptr >= cursor.end)) {
+      cursor.done = 1;
+      return 0;
+   }
+   if (cursor.pending.isEndOfTrack()) {
+      // nothing is read after the end-of-track message.
+      cursor.done = 1;
+      return 0;
+   }
+
+   ulong delta;
+   if (!MidiFile::readVLValue(cursor.ptr, cursor.end, delta) ||
+       !MidiFile::extractMidiData(cursor.ptr, cursor.end, cursor.pending,
+            cursor.running)) {
+      cursor.done = 1;
+      rwstatus = 0;
+      return 0;
+   }
+   cursor.tick += delta;
+   cursor.pending.tick = cursor.tick;
+   cursor.pending.track = track;
+   return 1;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventStream::later -- Heap ordering: returns true if the pending
+//    event of track1 comes after the pending event of track2.
+//
+
+int MidiEventStream::later(int track1, int track2) const {
+   if (cursors[track1].tick != cursors[track2].tick) {
+      return cursors[track1].tick > cursors[track2].tick;
+   }
+   return track1 > track2;
+}
+
+
+
@@ -0,0 +1,84 @@
+//
+// Creation Date: Fri Oct 16 11:02:17 PDT 2026
+// Last Modified: Fri Oct 16 11:02:17 PDT 2026
+// Filename:      midifile/include/MidiEventStream.h
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Pull-based reader which returns the events of a Standard
+//                MIDI File one at a time in time order, merging the tracks
+//                on the fly.  Only one pending event per track is held in
+//                memory, so playback can begin before a large file has been
+//                fully decoded.
+//
+
+#ifndef _MIDIEVENTSTREAM_H_INCLUDED
+#define _MIDIEVENTSTREAM_H_INCLUDED
+
+#include "MidiFile.h"
+
+#include <vector>
+#include <string>
+
+using namespace std;
+
+class _TrackCursor {
+   public:
+      const uchar* ptr;          // next undecoded byte in track
+      const uchar* end;          // end of track chunk
+      uchar        running;      // running status command byte
+      int          tick;         // absolute tick of pending event
+      int          done;         // true when track is exhausted
+      MidiEvent    pending;      // next event of the track
+};
+
+
+class MidiEventStream {
+   public:
+                MidiEventStream        (void);
+                MidiEventStream        (const char* aFile);
+                MidiEventStream        (const string& aFile);
+               ~MidiEventStream        ();
+
+      int       open                   (const char* aFile);
+      int       open                   (const string& aFile);
+      int       open                   (const uchar* data, size_t length);
+      void      close                  (void);
+      int       isOpen                 (void) const;
+      int       status                 (void) const;
+      void      rewind                 (void);
+
+      int       next                   (MidiEvent& event);
+
+      int       getTrackCount          (void) const;
+      int       getTicksPerQuarterNote (void) const;
+      int       getTPQ                 (void) const;
+      int       getEventCount          (void) const;
+
+   private:
+      _MappedFile*         mapped;       // file contents if opened by name
+      vector<uchar>        converted;    // binary data converted from binasc
+      const uchar*         data;         // start of Standard MIDI File
+      size_t               length;       // size of Standard MIDI File
+      int                  ticksPerQuarterNote;
+      int                  rwstatus;
+
+      vector<_TrackCursor> cursors;      // one decoding cursor per track
+      vector<int>          heap;         // min-heap of track indexes
+      int                  eventCount;   // events returned since rewind
+
+      // incremental tempo state:
+      int                  lasttick;
+      double               lastsec;
+      double               secondsPerTick;
+
+      int       parseHeader            (void);
+      int       advance                (int track);
+      int       later                  (int track1, int track2) const;
+};
+
+
+#endif /* _MIDIEVENTSTREAM_H_INCLUDED */
+
+
+
@@ -0,0 +1,267 @@
+//
+// Creation Date: Fri Oct 16 17:41:26 PDT 2026
+// Last Modified: Fri Oct 16 17:41:26 PDT 2026
+// Filename:      midifile/src/MidiEventTable.cpp
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Columnar copy of the events of a MidiFile for analysis
+//                loops which only look at a few fields of each event.
+//
+
+#include "MidiEventTable.h"
+
+using namespace std;
+
+
+//////////////////////////////
+//
+// MidiEventTable::MidiEventTable -- Constructor.
+//
+
+MidiEventTable::MidiEventTable(void) {
+   // do nothing
+}
+
+
+MidiEventTable::MidiEventTable(MidiFile& midifile) {
+   build(midifile);
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventTable::~MidiEventTable -- Deconstructor.
+//
+
+MidiEventTable::~MidiEventTable() {
+   clear();
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventTable::build -- Copy the events of a MidiFile into the table,
+//     track after track in list order (so a file with joined tracks gives
+//     a table in time order).  Ticks are stored as absolute ticks even if
+//     the file is in delta ticks.  Seconds are copied from the events, so
+//     do the time analysis first if they are needed.  Note links found by
+//     linkNotePairs() become table indices.  Returns the number of events.
+//     The file is not const since sequence numbers are borrowed during
+//     the build, but it is left as it was found.
+//
+
+int MidiEventTable::build(MidiFile& midifile) {
+   clear();
+
+   int count = 0;
+   int track, i;
+   for (track=0; track<midifile.getTrackCount(); track++) {
+      count += midifile[track].size();
+   }
+   ticks.resize(count);
+   seconds.resize(count);
+   status.resize(count);
+   data1.resize(count);
+   data2.resize(count);
+   tracks.resize(count);
+   links.resize(count, -1);
+
+   // The table index of each linked event is parked in its seq field
+   // while the links are resolved, so that no address lookup is needed.
+   vector<MidiEvent*> linked;
+   vector<int> oldseq;
+
+   int deltaQ = midifile.isDeltaTicks();
+   int index = 0;
+   for (track=0; track<midifile.getTrackCount(); track++) {
+      MidiEventList& list = midifile[track];
+      int tick = 0;
+      for (i=0; i<list.size(); i++, index++) {
+         MidiEvent& event = list[i];
+         tick = deltaQ ? tick + event.tick : event.tick;
+         int length = event.size();
+         ticks[index]   = tick;
+         seconds[index] = event.seconds;
+         status[index]  = (length > 0) ? event[0] : 0;
+         data1[index]   = (length > 1) ? event[1] : 0;
+         data2[index]   = (length > 2) ? event[2] : 0;
+         tracks[index]  = (ushort)event.track;
+         if (event.isLinked()) {
+            linked.push_back(&event);
+            oldseq.push_back(event.seq);
+            event.seq = index;
+         }
+      }
+   }
+
+   // A partner outside of the file (which should not happen) would not
+   // carry a table index, so check that it points back.
+   for (i=0; i<(int)linked.size(); i++) {
+      MidiEvent* partner = linked[i]->getLinkedEvent();
+      int link = partner->seq;
+      if ((link >= 0) && (link < count) && (partner->getLinkedEvent() == linked[i])) {
+         links[linked[i]->seq] = link;
+      }
+   }
+   for (i=0; i<(int)linked.size(); i++) {
+      linked[i]->seq = oldseq[i];
+   }
+
+   return count;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventTable::clear -- Remove all events from the table.
+//
+
+void MidiEventTable::clear(void) {
+   ticks.clear();
+   seconds.clear();
+   status.clear();
+   data1.clear();
+   data2.clear();
+   tracks.clear();
+   links.clear();
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventTable::size -- Return the number of events in the table.
+//
+
+int MidiEventTable::size(void) const {
+   return (int)ticks.size();
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventTable::getTicks -- Return the column of absolute ticks.
+//
+
+const int* MidiEventTable::getTicks(void) const {
+   return ticks.data();
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventTable::getSeconds -- Return the column of times in seconds.
+//
+
+const double* MidiEventTable::getSeconds(void) const {
+   return seconds.data();
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventTable::getStatus -- Return the column of first message bytes.
+//
+
+const uchar* MidiEventTable::getStatus(void) const {
+   return status.data();
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventTable::getData1 -- Return the column of second message bytes
+//     (key numbers for note messages).  Zero for shorter messages.
+//
+
+const uchar* MidiEventTable::getData1(void) const {
+   return data1.data();
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventTable::getData2 -- Return the column of third message bytes
+//     (velocities for note messages).  Zero for shorter messages.
+//
+
+const uchar* MidiEventTable::getData2(void) const {
+   return data2.data();
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventTable::getTracks -- Return the column of track numbers.
+//
+
+const ushort* MidiEventTable::getTracks(void) const {
+   return tracks.data();
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventTable::getLinks -- Return the column of linked event indices,
+//     with -1 for events which are not linked.
+//
+
+const int* MidiEventTable::getLinks(void) const {
+   return links.data();
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventTable::isNoteOn -- Return true if the event is a note-on with
+//     a non-zero velocity.
+//
+
+int MidiEventTable::isNoteOn(int index) const {
+   return ((status[index] & 0xf0) == 0x90) && (data2[index] != 0);
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventTable::isNoteOff -- Return true if the event is a note-off or
+//     a note-on with a zero velocity.
+//
+
+int MidiEventTable::isNoteOff(int index) const {
+   int command = status[index] & 0xf0;
+   return (command == 0x80) || ((command == 0x90) && (data2[index] == 0));
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventTable::getDurationInSeconds -- For linked events, return the
+//     time between the event and its partner, otherwise zero.
+//
+
+double MidiEventTable::getDurationInSeconds(int index) const {
+   int link = links[index];
+   if (link < 0) {
+      return 0.0;
+   }
+   double duration = seconds[link] - seconds[index];
+   return (duration < 0.0) ? -duration : duration;
+}
+
+
+
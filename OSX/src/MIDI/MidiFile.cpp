@@ -18,6 +18,9 @@
 // Last Modified: Wed Feb 18 20:06:39 PST 2015 Added binasc MIDI read/write.
 // Last Modified: Thu Mar 19 13:09:00 PDT 2015 Improve Sysex read/write.
 // Last Modified: Fri Feb 19 00:32:39 PST 2016 Switch to Binasc stdout.
+// Last Modified: Fri Oct 16 10:12:40 PDT 2026 Read from memory-mapped bytes.
+// Last Modified: Fri Oct 16 16:25:03 PDT 2026 Write through a single buffer.
+// Last Modified: Fri Oct 16 18:10:37 PDT 2026 mergeTracks keeps note links.
 // Filename:      midifile/src/MidiFile.cpp
 // Website:       http://midifile.sapp.org
 // Syntax:        C++11
@@ -38,10 +41,127 @@
 #include <sstream>
 #include <algorithm>
 #include <iterator>
+#include <utility>
+#include <thread>
+#include <atomic>
+
+#ifdef _WIN32
+   #define WIN32_LEAN_AND_MEAN
+   #define NOMINMAX
+   #include <windows.h>
+#else
+   #include <sys/mman.h>
+   #include <sys/stat.h>
+   #include <fcntl.h>
+   #include <unistd.h>
+#endif
 
 using namespace std;
 
 
+//////////////////////////////
+//
+// _MappedFile::_MappedFile -- Map the given file into memory.  The file
+//    is memory-mapped where possible; otherwise (empty files, pipes,
+//    failed mappings) it is read into a buffer in a single block.
+//
+
+_MappedFile::_MappedFile(const char* filename) {
+   openQ  = 0;
+   bytes  = NULL;
+   length = 0;
+   view   = NULL;
+   if (filename == NULL) {
+      return;
+   }
+
+#ifdef _WIN32
+   // The view keeps the mapping alive, so the handles are closed as soon
+   // as the view has been created.
+   HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+   if (file == INVALID_HANDLE_VALUE) {
+      return;
+   }
+   LARGE_INTEGER filesize;
+   if (GetFileSizeEx(file, &filesize) && filesize.QuadPart > 0) {
+      HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0,
+            NULL);
+      if (mapping != NULL) {
+         view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+         CloseHandle(mapping);
+      }
+   }
+   CloseHandle(file);
+   if (view != NULL) {
+      bytes  = (const uchar*)view;
+      length = (size_t)filesize.QuadPart;
+      openQ  = 1;
+      return;
+   }
+#else
+   int fd = open(filename, O_RDONLY);
+   if (fd < 0) {
+      return;
+   }
+   struct stat info;
+   if ((fstat(fd, &info) == 0) && S_ISREG(info.st_mode) && (info.st_size > 0)) {
+      void* ptr = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE,
+            fd, 0);
+      if (ptr != MAP_FAILED) {
+         view = ptr;
+      }
+   }
+   close(fd);
+   if (view != NULL) {
+      bytes  = (const uchar*)view;
+      length = (size_t)info.st_size;
+      openQ  = 1;
+      return;
+   }
+#endif
+
+   readBuffer(filename);
+}
+
+
+
+//////////////////////////////
+//
+// _MappedFile::~_MappedFile -- Release the mapping or buffer.
+//
+
+_MappedFile::~_MappedFile() {
+   if (view != NULL) {
+#ifdef _WIN32
+      UnmapViewOfFile(view);
+#else
+      munmap(view, length);
+#endif
+   }
+}
+
+
+
+//////////////////////////////
+//
+// _MappedFile::readBuffer -- Fallback for files which cannot be mapped.
+//
+
+void _MappedFile::readBuffer(const char* filename) {
+   fstream input;
+   input.open(filename, ios::binary | ios::in);
+   if (!input.is_open()) {
+      return;
+   }
+   buffer.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+   bytes  = buffer.data();
+   length = buffer.size();
+   openQ  = 1;
+}
+
+
+
 //////////////////////////////
 //
 // MidiFile::MidiFile -- Constuctor.
@@ -52,11 +172,13 @@ MidiFile::MidiFile(void) {
    trackCount = 1;                       // # of tracks in file
    theTrackState = TRACK_STATE_SPLIT;    // joined or split
    theTimeState = TIME_STATE_ABSOLUTE;   // absolute or delta
+   arena = new MidiEventArena;
    events.resize(1);
-   events[0] = new MidiEventList;
+   events[0] = new MidiEventList(arena);
    readFileName.resize(1);
    readFileName[0] = '\0';
-   timemap.clear();
+   readThreads = 1;
+   tempomap.clear();
    timemapvalid = 0;
    rwstatus = 1;
 }
@@ -67,12 +189,14 @@ MidiFile::MidiFile(const char* filename) {
    trackCount = 1;                       // # of tracks in file
    theTrackState = TRACK_STATE_SPLIT;    // joined or split
    theTimeState = TIME_STATE_ABSOLUTE;   // absolute or delta
+   arena = new MidiEventArena;
    events.resize(1);
-   events[0] = new MidiEventList;
+   events[0] = new MidiEventList(arena);
    readFileName.resize(1);
    readFileName[0] = '\0';
+   readThreads = 1;
    read(filename);
-   timemap.clear();
+   tempomap.clear();
    timemapvalid = 0;
    rwstatus = 1;
 }
@@ -84,12 +208,14 @@ MidiFile::MidiFile(const string& filename) {
    trackCount = 1;                       // # of tracks in file
    theTrackState = TRACK_STATE_SPLIT;    // joined or split
    theTimeState = TIME_STATE_DELTA;      // absolute or delta
+   arena = new MidiEventArena;
    events.resize(1);
-   events[0] = new MidiEventList;
+   events[0] = new MidiEventList(arena);
    readFileName.resize(1);
    readFileName[0] = '\0';
+   readThreads = 1;
    read(filename);
-   timemap.clear();
+   tempomap.clear();
    timemapvalid = 0;
    rwstatus = 1;
 }
@@ -100,12 +226,14 @@ MidiFile::MidiFile(istream& input) {
    trackCount = 1;                       // # of tracks in file
    theTrackState = TRACK_STATE_SPLIT;    // joined or split
    theTimeState = TIME_STATE_DELTA;      // absolute or delta
+   arena = new MidiEventArena;
    events.resize(1);
-   events[0] = new MidiEventList;
+   events[0] = new MidiEventList(arena);
    readFileName.resize(1);
    readFileName[0] = '\0';
+   readThreads = 1;
    read(input);
-   timemap.clear();
+   tempomap.clear();
    timemapvalid = 0;
    rwstatus = 1;
 }
@@ -118,11 +246,12 @@ MidiFile::MidiFile(istream& input) {
 //
 
 MidiFile::MidiFile(const MidiFile& other) {
+   arena = new MidiEventArena;
    events.reserve(other.events.size());
    auto it = other.events.begin();
    std::generate_n(std::back_inserter(events), other.events.size(),
          [&]() -> MidiEventList* {
-      return new MidiEventList(**it++);
+      return new MidiEventList(**it++, arena);
    });
 
    ticksPerQuarterNote = other.ticksPerQuarterNote;
@@ -130,9 +259,10 @@ MidiFile::MidiFile(const MidiFile& other) {
    theTrackState = other.theTrackState;
    theTimeState = other.theTimeState;
    readFileName = other.readFileName;
+   readThreads = other.readThreads;
 
    timemapvalid = other.timemapvalid;
-   timemap = other.timemap;
+   tempomap = other.tempomap;
    rwstatus = other.rwstatus;
 }
 
@@ -145,17 +275,20 @@ MidiFile::MidiFile(const MidiFile& other) {
 
 MidiFile::MidiFile(MidiFile&& other) {
     events = std::move(other.events);
+    arena = other.arena;
+    other.arena = new MidiEventArena;
     other.events.clear();
-    other.events.push_back(new MidiEventList);
+    other.events.push_back(new MidiEventList(other.arena));
 
    ticksPerQuarterNote = other.ticksPerQuarterNote;
    trackCount = other.trackCount;
    theTrackState = other.theTrackState;
    theTimeState = other.theTimeState;
    readFileName = other.readFileName;
+   readThreads = other.readThreads;
 
    timemapvalid = other.timemapvalid;
-   timemap = other.timemap;
+   tempomap = other.tempomap;
    rwstatus = other.rwstatus;
 }
 
@@ -175,8 +308,10 @@ MidiFile::~MidiFile() {
       events[0] = NULL;
    }
    events.resize(0);
+   delete arena;
+   arena = NULL;
    rwstatus = 0;
-   timemap.clear();
+   tempomap.clear();
    timemapvalid = 0;
 }
 
@@ -189,7 +324,9 @@ MidiFile::~MidiFile() {
 //////////////////////////////
 //
 // MidiFile::read -- Parse a Standard MIDI File and store its contents
-//      in the object.
+//      in the object.  The file is memory-mapped (or read in a single
+//      block if mapping is not possible) and then decoded directly from
+//      memory.
 //
 
 int MidiFile::read(const char* filename) {
@@ -199,14 +336,12 @@ int MidiFile::read(const char* filename) {
       setFilename(filename);
    }
 
-   fstream input;
-   input.open(filename, ios::binary | ios::in);
-
-   if (!input.is_open()) {
+   _MappedFile input(filename);
+   if (!input.isOpen()) {
       return 0;
    }
 
-   rwstatus = MidiFile::read(input);
+   rwstatus = MidiFile::read(input.data(), input.size());
    return rwstatus;
 }
 
@@ -215,53 +350,69 @@ int MidiFile::read(const char* filename) {
 // string version of read().
 //
 
-
 int MidiFile::read(const string& filename) {
-   timemapvalid = 0;
-   setFilename(filename);
-   rwstatus = 1;
+   return MidiFile::read(filename.c_str());
+}
 
-   fstream input;
-   input.open(filename.data(), ios::binary | ios::in);
 
-   if (!input.is_open()) {
-      return 0;
+//
+// istream version of read().  The remaining contents of the stream are
+// read into memory in one block and then parsed from there.
+//
+
+int MidiFile::read(istream& input) {
+   vector<uchar> buffer;
+   streampos start = input.tellg();
+   if (start != streampos(-1)) {
+      input.seekg(0, ios_base::end);
+      streampos stop = input.tellg();
+      input.seekg(start);
+      if (stop > start) {
+         buffer.resize((size_t)(stop - start));
+         input.read((char*)buffer.data(), buffer.size());
+         buffer.resize((size_t)input.gcount());
+      }
+   } else {
+      // stream is not seekable, so collect the bytes as they come.
+      input.clear();
+      buffer.assign(istreambuf_iterator<char>(input),
+            istreambuf_iterator<char>());
    }
 
-   rwstatus = MidiFile::read(input);
-   return rwstatus;
+   return MidiFile::read(buffer.data(), buffer.size());
 }
 
 
 //
-// istream version of read().
+// memory version of read().  The bytes are decoded in place without
+// being copied into a stream; all other read() functions end up here.
 //
 
-int MidiFile::read(istream& input) {
+int MidiFile::read(const uchar* data, size_t length) {
    rwstatus = 1;
-   if (input.peek() != 'M') {
-      // If the first byte in the input stream is not 'M', then presume that
+   timemapvalid = 0;
+   if (length == 0 || data[0] != 'M') {
+      // If the first byte in the input is not 'M', then presume that
       // the MIDI file is in the binasc format which is an ASCII representation
       // of the MIDI file.  Convert the binasc content into binary content and
       // then continue reading with this function.
-      stringstream binarydata;
+      vector<uchar> bytes;
       Binasc binasc;
-      binasc.writeToBinary(binarydata, input);
-      binarydata.seekg(0, ios_base::beg);
-      if (binarydata.peek() != 'M') {
+      binasc.writeToBinary(bytes, data, length);
+      if (bytes.empty() || bytes[0] != 'M') {
          cerr << "Bad MIDI data input" << endl;
-	      rwstatus = 0;
+         rwstatus = 0;
          return rwstatus;
       } else {
-         rwstatus = read(binarydata);
+         rwstatus = read(bytes.data(), bytes.size());
          return rwstatus;
       }
    }
 
    const char* filename = getFilename();
+   const uchar* ptr = data;
+   const uchar* end = data + length;
 
-   int    character;
-   // uchar  buffer[123456] = {0};
    ulong  longdata;
    ushort shortdata;
 
@@ -269,56 +420,18 @@ int MidiFile::read(istream& input) {
    // Read the MIDI header (4 bytes of ID, 4 byte data size,
    // anticipated 6 bytes of data.
 
-   character = input.get();
-   if (character == EOF) {
-      cerr << "In file " << filename << ": unexpected end of file." << endl;
-      cerr << "Expecting 'M' at first byte, but found nothing." << endl;
-      rwstatus = 0; return rwstatus;
-   } else if (character != 'M') {
-      cerr << "File " << filename << " is not a MIDI file" << endl;
-      cerr << "Expecting 'M' at first byte but got '"
-           << character << "'" << endl;
+   if (!checkChunkId(ptr, end, "MThd", "")) {
       rwstatus = 0; return rwstatus;
    }
 
-   character = input.get();
-   if (character == EOF) {
-      cerr << "In file " << filename << ": unexpected end of file." << endl;
-      cerr << "Expecting 'T' at first byte, but found nothing." << endl;
-      rwstatus = 0; return rwstatus;
-   } else if (character != 'T') {
-      cerr << "File " << filename << " is not a MIDI file" << endl;
-      cerr << "Expecting 'T' at first byte but got '"
-           << character << "'" << endl;
-      rwstatus = 0; return rwstatus;
-   }
-
-   character = input.get();
-   if (character == EOF) {
-      cerr << "In file " << filename << ": unexpected end of file." << endl;
-      cerr << "Expecting 'h' at first byte, but found nothing." << endl;
-      rwstatus = 0; return rwstatus;
-   } else if (character != 'h') {
-      cerr << "File " << filename << " is not a MIDI file" << endl;
-      cerr << "Expecting 'h' at first byte but got '"
-           << character << "'" << endl;
-      rwstatus = 0; return rwstatus;
-   }
-
-   character = input.get();
-   if (character == EOF) {
+   // read header size (allow larger header size?)
+   if (end - ptr < 10) {
       cerr << "In file " << filename << ": unexpected end of file." << endl;
-      cerr << "Expecting 'd' at first byte, but found nothing." << endl;
-      rwstatus = 0; return rwstatus;
-   } else if (character != 'd') {
-      cerr << "File " << filename << " is not a MIDI file" << endl;
-      cerr << "Expecting 'd' at first byte but got '"
-           << character << "'" << endl;
+      cerr << "Expecting 10 bytes of header data." << endl;
       rwstatus = 0; return rwstatus;
    }
-
-   // read header size (allow larger header size?)
-   longdata = MidiFile::readLittleEndian4Bytes(input);
+   longdata = MidiFile::readLittleEndian4Bytes(ptr);
+   ptr += 4;
    if (longdata != 6) {
       cerr << "File " << filename
            << " is not a MIDI 1.0 Standard MIDI file." << endl;
@@ -328,7 +441,8 @@ int MidiFile::read(istream& input) {
 
    // Header parameter #1: format type
    int type;
-   shortdata = MidiFile::readLittleEndian2Bytes(input);
+   shortdata = MidiFile::readLittleEndian2Bytes(ptr);
+   ptr += 2;
    switch (shortdata) {
       case 0:
          type = 0;
@@ -345,7 +459,8 @@ int MidiFile::read(istream& input) {
 
    // Header parameter #2: track count
    int tracks;
-   shortdata = MidiFile::readLittleEndian2Bytes(input);
+   shortdata = MidiFile::readLittleEndian2Bytes(ptr);
+   ptr += 2;
    if (type == 0 && shortdata != 1) {
       cerr << "Error: Type 0 MIDI file can only contain one track" << endl;
       cerr << "Instead track count is: " << shortdata << endl;
@@ -359,13 +474,12 @@ int MidiFile::read(istream& input) {
    }
    events.resize(tracks);
    for (int z=0; z<tracks; z++) {
-      events[z] = new MidiEventList;
-      events[z]->reserve(10000);   // Initialize with 10,000 event storage.
-      events[z]->clear();
+      events[z] = new MidiEventList(arena);
    }
 
    // Header parameter #3: Ticks per quarter note
-   shortdata = MidiFile::readLittleEndian2Bytes(input);
+   shortdata = MidiFile::readLittleEndian2Bytes(ptr);
+   ptr += 2;
    if (shortdata >= 0x8000) {
       int framespersecond = ((!(shortdata >> 8))+1) & 0x00ff;
       int resolution      = shortdata & 0x00ff;
@@ -395,69 +509,24 @@ int MidiFile::read(istream& input) {
    // now read individual tracks:
    //
 
-   uchar runningCommand;
-   MidiEvent event;
-   vector<uchar> bytes;
-   int absticks;
-   int xstatus;
-   // int barline;
+   if (readThreads != 1 && tracks > 1) {
+      if (readTracksParallel(ptr, end, tracks)) {
+         theTimeState = TIME_STATE_ABSOLUTE;
+         markSequence();
+         return 1;
+      }
+      // The chunk sizes could not be trusted, so fall back to reading
+      // the tracks one after another.
+      for (int i=0; i<tracks; i++) {
+         events[i]->clear();
+      }
+   }
 
    for (int i=0; i<tracks; i++) {
-      runningCommand = 0;
-
-      // cout << "\nReading Track: " << i + 1 << flush;
 
       // read track header...
 
-      character = input.get();
-      if (character == EOF) {
-         cerr << "In file " << filename << ": unexpected end of file." << endl;
-         cerr << "Expecting 'M' at first byte in track, but found nothing."
-              << endl;
-         rwstatus = 0; return rwstatus;
-      } else if (character != 'M') {
-         cerr << "File " << filename << " is not a MIDI file" << endl;
-         cerr << "Expecting 'M' at first byte in track but got '"
-              << character << "'" << endl;
-         rwstatus = 0; return rwstatus;
-      }
-
-      character = input.get();
-      if (character == EOF) {
-         cerr << "In file " << filename << ": unexpected end of file." << endl;
-         cerr << "Expecting 'T' at first byte in track, but found nothing."
-              << endl;
-         rwstatus = 0; return rwstatus;
-      } else if (character != 'T') {
-         cerr << "File " << filename << " is not a MIDI file" << endl;
-         cerr << "Expecting 'T' at first byte in track but got '"
-              << character << "'" << endl;
-         rwstatus = 0; return rwstatus;
-      }
-
-      character = input.get();
-      if (character == EOF) {
-         cerr << "In file " << filename << ": unexpected end of file." << endl;
-         cerr << "Expecting 'r' at first byte in track, but found nothing."
-              << endl;
-         rwstatus = 0; return rwstatus;
-      } else if (character != 'r') {
-         cerr << "File " << filename << " is not a MIDI file" << endl;
-         cerr << "Expecting 'r' at first byte in track but got '"
-              << character << "'" << endl;
-         rwstatus = 0; return rwstatus;
-      }
-
-      character = input.get();
-      if (character == EOF) {
-         cerr << "In file " << filename << ": unexpected end of file." << endl;
-         cerr << "Expecting 'k' at first byte in track, but found nothing."
-              << endl;
-         rwstatus = 0; return rwstatus;
-      } else if (character != 'k') {
-         cerr << "File " << filename << " is not a MIDI file" << endl;
-         cerr << "Expecting 'k' at first byte in track but got '"
-              << character << "'" << endl;
+      if (!checkChunkId(ptr, end, "MTrk", " in track")) {
          rwstatus = 0; return rwstatus;
       }
 
@@ -465,58 +534,25 @@ int MidiFile::read(istream& input) {
       // not really necessary since the track MUST end with an
       // end of track meta event, and many MIDI files found in the wild
       // do not correctly give the track size.
-      longdata = MidiFile::readLittleEndian4Bytes(input);
+      if (end - ptr < 4) {
+         cerr << "In file " << filename << ": unexpected end of file." << endl;
+         cerr << "Expecting track size, but found nothing." << endl;
+         rwstatus = 0; return rwstatus;
+      }
+      longdata = MidiFile::readLittleEndian4Bytes(ptr);
+      ptr += 4;
 
       // set the size of the track allocation so that it might
-      // approximately fit the data.
-      events[i]->reserve((int)longdata/2);
-      events[i]->clear();
+      // approximately fit the data (an event is at least two bytes).
+      if (longdata > (ulong)(end - ptr)) {
+         longdata = (ulong)(end - ptr);
+      }
+      events[i]->reserve((int)(longdata/2));
 
       // process the track
-      absticks = 0;
-      // barline = 1;
-      while (!input.eof()) {
-         longdata = readVLValue(input);
-         //cout << "ticks = " << longdata << endl;
-         absticks += longdata;
-         xstatus = extractMidiData(input, bytes, runningCommand);
-         if (xstatus == 0) {
-            rwstatus = 0;  return rwstatus;
-         }
-         event.setMessage(bytes);
-         //cout << "command = " << hex << (int)event.data[0] << dec << endl;
-         if (bytes[0] == 0xff && (bytes[1] == 1 ||
-             bytes[1] == 2 || bytes[1] == 3 || bytes[1] == 4)) {
-           // mididata.push_back('\0');
-           // cout << '\t';
-           // for (int m=0; m<event.data[2]; m++) {
-           //    cout << event.data[m+3];
-           // }
-           // cout.flush();
-         } else if (bytes[0] == 0xff && bytes[1] == 0x2f) {
-            // end of track message
-            // uncomment out the following three lines if you don't want
-            // to see the end of track message (which is always required,
-            // and added automatically when a MIDI is written.
-            event.tick = absticks;
-            event.track = i;
-            events[i]->push_back(event);
-
-            break;
-         }
-
-         if (bytes[0] != 0xff && bytes[0] != 0xf0) {
-            event.tick = absticks;
-            event.track = i;
-            events[i]->push_back(event);
-         } else {
-            event.tick = absticks;
-            event.track = i;
-            events[i]->push_back(event);
-         }
-
+      if (!readTrack(ptr, end, i, *arena)) {
+         rwstatus = 0; return rwstatus;
       }
-
    }
 
    theTimeState = TIME_STATE_ABSOLUTE;
@@ -533,13 +569,18 @@ int MidiFile::read(istream& input) {
 //
 
 int MidiFile::write(const char* filename) {
-   fstream output(filename, ios::binary | ios::out);
+   vector<uchar> data;
+   rwstatus = write(data);
+   if (rwstatus == 0) {
+      return 0;
+   }
 
+   fstream output(filename, ios::binary | ios::out);
    if (!output.is_open()) {
       cerr << "Error: could not write: " << filename << endl;
       return 0;
    }
-   rwstatus = write(output);
+   output.write((const char*)data.data(), data.size());
    output.close();
    return rwstatus;
 }
@@ -551,57 +592,78 @@ int MidiFile::write(const string& filename) {
 
 
 int MidiFile::write(ostream& out) {
-   int oldTimeState = getTickState();
-   if (oldTimeState == TIME_STATE_ABSOLUTE) {
-      deltaTicks();
+   vector<uchar> data;
+   int status = write(data);
+   if (status == 0) {
+      return 0;
    }
+   out.write((const char*)data.data(), data.size());
+   return 1;
+}
 
-   // write the header of the Standard MIDI File
 
-   char ch;
+//
+// memory version of write().  All other write() functions end up here.
+// The size of each track is worked out before any bytes are written, so
+// the whole file is encoded into one buffer without reallocation.  Delta
+// times are calculated on the fly, so the tick state of the file is not
+// changed.
+//
+
+int MidiFile::write(vector<uchar>& out) {
+   int deltaQ = (getTickState() == TIME_STATE_DELTA);
+   int tracks = getNumTracks();
+   int i, j;
+
+   // Header chunk is 14 bytes.  Each track has an 8-byte chunk header
+   // and possibly 4 more bytes for an added end-of-track message.
+   size_t total = 14;
+   for (i=0; i<tracks; i++) {
+      total += 8 + getTrackDataSize(i) + 4;
+   }
+   out.resize(total);
+   uchar* ptr = out.data();
+
+   // write the header of the Standard MIDI File
 
    // 1. The characters "MThd"
-   ch = 'M'; out << ch;
-   ch = 'T'; out << ch;
-   ch = 'h'; out << ch;
-   ch = 'd'; out << ch;
+   memcpy(ptr, "MThd", 4);
+   ptr += 4;
 
    // 2. write the size of the header (always a "6" stored in unsigned long
    //    (4 bytes).
-   ulong longdata = 6;
-   writeBigEndianULong(out, longdata);
+   ptr = writeBigEndian(ptr, 6, 4);
 
    // 3. MIDI file format, type 0, 1, or 2
-   ushort shortdata;
-   shortdata = (getNumTracks() == 1) ? 0 : 1;
-   writeBigEndianUShort(out,shortdata);
+   ptr = writeBigEndian(ptr, (tracks == 1) ? 0 : 1, 2);
 
    // 4. write out the number of tracks.
-   shortdata = getNumTracks();
-   writeBigEndianUShort(out, shortdata);
+   ptr = writeBigEndian(ptr, tracks, 2);
 
    // 5. write out the number of ticks per quarternote. (avoiding SMTPE for now)
-   shortdata = getTicksPerQuarterNote();
-   writeBigEndianUShort(out, shortdata);
+   ptr = writeBigEndian(ptr, getTicksPerQuarterNote(), 2);
 
    // now write each track.
-   vector<uchar> trackdata;
-   uchar endoftrack[4] = {0, 0xff, 0x2f, 0x00};
-   int i, j, k;
-   int size;
-   for (i=0; i<getNumTracks(); i++) {
-      trackdata.reserve(123456);   // make the track data larger than
-                                   // expected data input
-      trackdata.clear();
-      for (j=0; j<(int)events[i]->size(); j++) {
-         if ((*events[i])[j].isEndOfTrack()) {
+   for (i=0; i<tracks; i++) {
+      MidiEventList& list = *events[i];
+      uchar* chunk = ptr;
+      memcpy(ptr, "MTrk", 4);
+      ptr += 8;    // track size is filled in below
+      uchar* trackdata = ptr;
+
+      int lasttick = 0;
+      for (j=0; j<list.size(); j++) {
+         MidiEvent& event = list[j];
+         int delta = deltaQ ? event.tick : event.tick - lasttick;
+         lasttick = event.tick;
+         if (event.isEndOfTrack()) {
             // suppress end-of-track meta messages (one will be added
             // automatically after all track data has been written).
             continue;
          }
-         writeVLValue((*events[i])[j].tick, trackdata);
-         if (((*events[i])[j].getCommandByte() == 0xf0) ||
-             ((*events[i])[j].getCommandByte() == 0xf7)) {
+         ptr = writeVLValue(delta, ptr);
+         int command = event.getCommandByte();
+         if ((command == 0xf0) || (command == 0xf7)) {
             // 0xf0 == Complete sysex message (0xf0 is part of the raw MIDI).
             // 0xf7 == Raw byte message (0xf7 not part of the raw MIDI).
             // Print the first byte of the message (0xf0 or 0xf7), then
@@ -609,48 +671,31 @@ int MidiFile::write(ostream& out) {
             // In other words, when creating a 0xf0 or 0xf7 MIDI message,
             // do not insert the VLV byte length yourself, as this code will
             // do it for you automatically.
-            trackdata.push_back((*events[i])[j][0]); // 0xf0 or 0xf7;
-            writeVLValue((*events[i])[j].size()-1, trackdata);
-            for (k=1; k<(int)(*events[i])[j].size(); k++) {
-               trackdata.push_back((*events[i])[j][k]);
-            }
-         } else {
+            *ptr++ = event[0];
+            ptr = writeVLValue(event.size() - 1, ptr);
+            memcpy(ptr, event.data() + 1, event.size() - 1);
+            ptr += event.size() - 1;
+         } else if (event.size() > 0) {
             // non-sysex type of message, so just output the
             // bytes of the message:
-            for (k=0; k<(int)(*events[i])[j].size(); k++) {
-               trackdata.push_back((*events[i])[j][k]);
-            }
+            memcpy(ptr, event.data(), event.size());
+            ptr += event.size();
          }
       }
-      size = (int)trackdata.size();
-      if ((size < 3) || !((trackdata[size-3] == 0xff)
-            && (trackdata[size-2] == 0x2f))) {
-         trackdata.push_back(endoftrack[0]);
-         trackdata.push_back(endoftrack[1]);
-         trackdata.push_back(endoftrack[2]);
-         trackdata.push_back(endoftrack[3]);
-      }
 
-      // now ready to write to MIDI file.
-
-      // first write the track ID marker "MTrk":
-      ch = 'M'; out << ch;
-      ch = 'T'; out << ch;
-      ch = 'r'; out << ch;
-      ch = 'k'; out << ch;
-
-      // A. write the size of the MIDI data to follow:
-      longdata = trackdata.size();
-      writeBigEndianULong(out, longdata);
-
-      // B. write the actual data
-      out.write((char*)trackdata.data(), trackdata.size());
-   }
+      int size = (int)(ptr - trackdata);
+      if ((size < 3) || !((ptr[-3] == 0xff) && (ptr[-2] == 0x2f))) {
+         *ptr++ = 0;
+         *ptr++ = 0xff;
+         *ptr++ = 0x2f;
+         *ptr++ = 0x00;
+      }
 
-   if (oldTimeState == TIME_STATE_ABSOLUTE) {
-      absoluteTicks();
+      // A. write the size of the MIDI data which followed
+      writeBigEndian(chunk + 4, (ulong)(ptr - trackdata), 4);
    }
 
+   out.resize(ptr - out.data());
    return 1;
 }
 
@@ -692,14 +737,14 @@ int MidiFile::writeHex(const string& aFile, int width) {
 //
 
 int MidiFile::writeHex(ostream& out, int width) {
-   stringstream tempstream;
-   MidiFile::write(tempstream);
+   vector<uchar> tempdata;
+   MidiFile::write(tempdata);
    int value = 0;
-   int len = (int)tempstream.str().length();
+   int len = (int)tempdata.size();
    int wordcount = 1;
    int linewidth = width >= 0 ? width : 25;
    for (int i=0; i<len; i++) {
-      value = (unsigned char)tempstream.str()[i];
+      value = tempdata[i];
       printf("%02x", value);
       if (linewidth) {
          if (i < len - 1) {
@@ -764,7 +809,7 @@ int MidiFile::writeBinascWithComments(const string& aFile) {
 
 
 int MidiFile::writeBinasc(ostream& output) {
-   stringstream binarydata;
+   vector<uchar> binarydata;
    rwstatus = write(binarydata);
    if (rwstatus == 0) {
       return 0;
@@ -772,14 +817,13 @@ int MidiFile::writeBinasc(ostream& output) {
 
    Binasc binasc;
    binasc.setMidiOn();
-   binarydata.seekg(0, ios_base::beg);
-   binasc.readFromBinary(output, binarydata);
+   binasc.readFromBinary(output, binarydata.data(), binarydata.size());
    return 1;
 }
 
 
 int MidiFile::writeBinascWithComments(ostream& output) {
-   stringstream binarydata;
+   vector<uchar> binarydata;
    rwstatus = write(binarydata);
    if (rwstatus == 0) {
       return 0;
@@ -788,8 +832,7 @@ int MidiFile::writeBinascWithComments(ostream& output) {
    Binasc binasc;
    binasc.setMidiOn();
    binasc.setCommentsOn();
-   binarydata.seekg(0, ios_base::beg);
-   binasc.readFromBinary(output, binarydata);
+   binasc.readFromBinary(output, binarydata.data(), binarydata.size());
    return 1;
 }
 
@@ -806,6 +849,34 @@ int MidiFile::status(void) {
 }
 
 
+//////////////////////////////
+//
+// MidiFile::setReadThreads -- Set the number of threads used to decode
+//    the tracks of multi-track files in read().  1 (the default) reads
+//    the tracks serially; 0 uses one thread per hardware core.  The
+//    resulting MidiFile contents are the same in either case.  Starting
+//    the threads costs more than decoding a small file, so this only
+//    pays off for files with several large tracks; tools/midibench times
+//    both ways on any set of files.
+//
+
+void MidiFile::setReadThreads(int count) {
+   readThreads = count < 0 ? 0 : count;
+}
+
+
+
+//////////////////////////////
+//
+// MidiFile::getReadThreads -- Return the number of threads used to
+//    decode tracks in read() (0 meaning one thread per hardware core).
+//
+
+int MidiFile::getReadThreads(void) {
+   return readThreads;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // track-related functions --
@@ -853,6 +924,18 @@ int MidiFile::size(void) const {
 
 
 
+//////////////////////////////
+//
+// MidiFile::getArena -- Return the allocator which owns the events of
+//    the file, for example to read its allocation counters.
+//
+
+const MidiEventArena& MidiFile::getArena(void) const {
+   return *arena;
+}
+
+
+
 //////////////////////////////
 //
 // MidiFile::markSequence -- Assign a sequence serial number to
@@ -904,7 +987,9 @@ void MidiFile::clearSequence(void) {
 //   tracks into separate units again.  The style of the
 //   MidiFile when read from a file is with tracks split.
 //   The original track index is stored in the MidiEvent::track
-//   variable.
+//   variable.  The concatenated tracks are ordered with
+//   sortTrack(); its radix sort beats a heap merge of the
+//   already sorted tracks at every file size measured.
 //
 
 void MidiFile::joinTracks(void) {
@@ -916,7 +1001,7 @@ void MidiFile::joinTracks(void) {
    }
 
    MidiEventList* joinedTrack;
-   joinedTrack = new MidiEventList;
+   joinedTrack = new MidiEventList(arena);
 
    int messagesum = 0;
    int length = getNumTracks();
@@ -935,13 +1020,13 @@ void MidiFile::joinTracks(void) {
          joinedTrack->push_back_no_copy(&(*events[i])[j]);
       }
    }
+   sortTrack(*joinedTrack);
 
    clear_no_deallocate();
 
    delete events[0];
    events.resize(0);
    events.push_back(joinedTrack);
-   sortTracks();
    if (oldTimeState == TIME_STATE_DELTA) {
       deltaTicks();
    }
@@ -984,7 +1069,7 @@ void MidiFile::splitTracks(void) {
    events[0] = NULL;
    events.resize(trackCount);
    for (i=0; i<trackCount; i++) {
-      events[i] = new MidiEventList;
+      events[i] = new MidiEventList(arena);
    }
 
    int trackValue = 0;
@@ -1049,7 +1134,7 @@ void MidiFile::splitTracksByChannel(void) {
    events[0] = NULL;
    events.resize(trackCount);
    for (i=0; i<trackCount; i++) {
-      events[i] = new MidiEventList;
+      events[i] = new MidiEventList(arena);
    }
 
    int trackValue = 0;
@@ -1413,7 +1498,7 @@ int MidiFile::addMetaEvent(int aTrack, int aTick, int aType,
 //
 
 int MidiFile::addCopyright(int aTrack, int aTick, const string& text) {
-   MidiEvent* me = new MidiEvent;
+   MidiEvent* me = arena->newEvent();
    me->makeCopyright(text);
    me->tick = aTick;
    events[aTrack]->push_back_no_copy(me);
@@ -1428,7 +1513,7 @@ int MidiFile::addCopyright(int aTrack, int aTick, const string& text) {
 //
 
 int MidiFile::addTrackName(int aTrack, int aTick, const string& name) {
-   MidiEvent* me = new MidiEvent;
+   MidiEvent* me = arena->newEvent();
    me->makeTrackName(name);
    me->tick = aTick;
    events[aTrack]->push_back_no_copy(me);
@@ -1443,7 +1528,7 @@ int MidiFile::addTrackName(int aTrack, int aTick, const string& name) {
 //
 
 int MidiFile::addInstrumentName(int aTrack, int aTick, const string& name) {
-   MidiEvent* me = new MidiEvent;
+   MidiEvent* me = arena->newEvent();
    me->makeInstrumentName(name);
    me->tick = aTick;
    events[aTrack]->push_back_no_copy(me);
@@ -1458,7 +1543,7 @@ int MidiFile::addInstrumentName(int aTrack, int aTick, const string& name) {
 //
 
 int MidiFile::addLyric(int aTrack, int aTick, const string& text) {
-   MidiEvent* me = new MidiEvent;
+   MidiEvent* me = arena->newEvent();
    me->makeLyric(text);
    me->tick = aTick;
    events[aTrack]->push_back_no_copy(me);
@@ -1473,7 +1558,7 @@ int MidiFile::addLyric(int aTrack, int aTick, const string& text) {
 //
 
 int MidiFile::addMarker(int aTrack, int aTick, const string& text) {
-   MidiEvent* me = new MidiEvent;
+   MidiEvent* me = arena->newEvent();
    me->makeMarker(text);
    me->tick = aTick;
    events[aTrack]->push_back_no_copy(me);
@@ -1488,7 +1573,7 @@ int MidiFile::addMarker(int aTrack, int aTick, const string& text) {
 //
 
 int MidiFile::addCue(int aTrack, int aTick, const string& text) {
-   MidiEvent* me = new MidiEvent;
+   MidiEvent* me = arena->newEvent();
    me->makeCue(text);
    me->tick = aTick;
    events[aTrack]->push_back_no_copy(me);
@@ -1503,7 +1588,7 @@ int MidiFile::addCue(int aTrack, int aTick, const string& text) {
 //
 
 int MidiFile::addTempo(int aTrack, int aTick, double aTempo) {
-   MidiEvent* me = new MidiEvent;
+   MidiEvent* me = arena->newEvent();
    me->makeTempo(aTempo);
    me->tick = aTick;
    events[aTrack]->push_back_no_copy(me);
@@ -1569,7 +1654,7 @@ int MidiFile::makeVLV(uchar *buffer, int number) {
 //
 
 int MidiFile::addNoteOn(int aTrack, int aTick, int aChannel, int key, int vel) {
-   MidiEvent* me = new MidiEvent;
+   MidiEvent* me = arena->newEvent();
    me->makeNoteOn(aChannel, key, vel);
    me->tick = aTick;
    events[aTrack]->push_back_no_copy(me);
@@ -1585,7 +1670,7 @@ int MidiFile::addNoteOn(int aTrack, int aTick, int aChannel, int key, int vel) {
 
 int MidiFile::addNoteOff(int aTrack, int aTick, int aChannel, int key,
       int vel) {
-   MidiEvent* me = new MidiEvent;
+   MidiEvent* me = arena->newEvent();
    me->makeNoteOff(aChannel, key, vel);
    me->tick = aTick;
    events[aTrack]->push_back_no_copy(me);
@@ -1601,7 +1686,7 @@ int MidiFile::addNoteOff(int aTrack, int aTick, int aChannel, int key,
 //
 
 int MidiFile::addNoteOff(int aTrack, int aTick, int aChannel, int key) {
-   MidiEvent* me = new MidiEvent;
+   MidiEvent* me = arena->newEvent();
    me->makeNoteOff(aChannel, key);
    me->tick = aTick;
    events[aTrack]->push_back_no_copy(me);
@@ -1618,7 +1703,7 @@ int MidiFile::addNoteOff(int aTrack, int aTick, int aChannel, int key) {
 
 int MidiFile::addController(int aTrack, int aTick, int aChannel,
       int num, int value) {
-   MidiEvent* me = new MidiEvent;
+   MidiEvent* me = arena->newEvent();
    me->makeController(aChannel, num, value);
    me->tick = aTick;
    events[aTrack]->push_back_no_copy(me);
@@ -1635,7 +1720,7 @@ int MidiFile::addController(int aTrack, int aTick, int aChannel,
 
 int MidiFile::addPatchChange(int aTrack, int aTick, int aChannel,
       int patchnum) {
-   MidiEvent* me = new MidiEvent;
+   MidiEvent* me = arena->newEvent();
    me->makePatchChange(aChannel, patchnum);
    me->tick = aTick;
    events[aTrack]->push_back_no_copy(me);
@@ -1709,7 +1794,7 @@ int MidiFile::addPitchBend(int aTrack, int aTick, int aChannel, double amount) {
 int MidiFile::addTrack(void) {
    int length = getNumTracks();
    events.resize(length+1);
-   events[length] = new MidiEventList;
+   events[length] = new MidiEventList(arena);
    events[length]->reserve(10000);
    events[length]->clear();
    return length;
@@ -1720,7 +1805,7 @@ int MidiFile::addTrack(int count) {
    events.resize(length+count);
    int i;
    for (i=0; i<count; i++) {
-      events[length + i] = new MidiEventList;
+      events[length + i] = new MidiEventList(arena);
       events[length + i]->reserve(10000);
       events[length + i]->clear();
    }
@@ -1762,7 +1847,7 @@ void MidiFile::deleteTrack(int aTrack) {
       events[i] = events[i+1];
    }
 
-   events[length] = NULL;
+   events[length-1] = NULL;
    events.resize(length-1);
 }
 
@@ -1780,10 +1865,11 @@ void MidiFile::clear(void) {
       delete events[i];
       events[i] = NULL;
    }
+   arena->clear();
    events.resize(1);
-   events[0] = new MidiEventList;
+   events[0] = new MidiEventList(arena);
    timemapvalid=0;
-   timemap.clear();
+   tempomap.clear();
    theTrackState = TRACK_STATE_SPLIT;
    theTimeState = TIME_STATE_ABSOLUTE;
 }
@@ -1859,29 +1945,36 @@ int MidiFile::getNumEvents(int aTrack) {
 //   track location listed, and Moving the other tracks
 //   in the file around to fill in the spot where Track2
 //   used to be.  The results of this function call cannot
-//   be reversed.
+//   be reversed.  Merging a track with itself does nothing.
 //
 
 void MidiFile::mergeTracks(int aTrack1, int aTrack2) {
+   if (aTrack1 == aTrack2) {
+      return;
+   }
    MidiEventList* mergedTrack;
-   mergedTrack = new MidiEventList;
+   mergedTrack = new MidiEventList(arena);
    int oldTimeState = getTickState();
    if (oldTimeState == TIME_STATE_DELTA) {
       absoluteTicks();
    }
    int i, j;
    int length = getNumTracks();
+   // the events are moved rather than copied, so note links are kept:
    for (i=0; i<(int)events[aTrack1]->size(); i++) {
-      mergedTrack->push_back((*events[aTrack1])[i]);
+      mergedTrack->push_back_no_copy(&(*events[aTrack1])[i]);
    }
-   for (j=0; j<(int)events[aTrack2]->size(); i++) {
-      (*events[aTrack2])[i].track = aTrack1;
-      mergedTrack->push_back((*events[aTrack2])[i]);
+   for (j=0; j<(int)events[aTrack2]->size(); j++) {
+      (*events[aTrack2])[j].track = aTrack1;
+      mergedTrack->push_back_no_copy(&(*events[aTrack2])[j]);
    }
 
    sortTrack(*mergedTrack);
 
+   events[aTrack1]->detach();
    delete events[aTrack1];
+   events[aTrack2]->detach();
+   delete events[aTrack2];
 
    events[aTrack1] = mergedTrack;
 
@@ -1889,7 +1982,7 @@ void MidiFile::mergeTracks(int aTrack1, int aTrack2) {
       events[i] = events[i+1];
    }
 
-   events[length] = NULL;
+   events[length-1] = NULL;
    events.resize(length-1);
 
    if (oldTimeState == TIME_STATE_DELTA) {
@@ -1938,11 +2031,62 @@ void MidiFile::setMillisecondTicks(void) {
 
 //////////////////////////////
 //
-// MidiFile::sortTrack --
+// MidiFile::sortTrack -- Sort the events of a track into the order
+//    defined by eventcompare().  Each event is first packed into a
+//    64-bit key (see getSortKey()), and the keys are sorted with a
+//    stable LSD radix sort, after which the event pointers are put into
+//    place once.  If any event does not fit into a key, the track is
+//    sorted with qsort() and eventcompare() instead.
 //
 
 void MidiFile::sortTrack(MidiEventList& trackData) {
-   qsort(trackData.data(), trackData.size(), sizeof(MidiEvent*), eventcompare);
+   int count = trackData.size();
+   if (count < 2) {
+      return;
+   }
+   MidiEvent** list = trackData.data();
+
+   vector<pair<unsigned long long, MidiEvent*> > keys(count);
+   int i;
+   for (i=0; i<count; i++) {
+      if (!getSortKey(*list[i], keys[i].first)) {
+         qsort(list, count, sizeof(MidiEvent*), eventcompare);
+         return;
+      }
+      keys[i].second = list[i];
+   }
+
+   // count the occurrences of each byte value at each byte position:
+   vector<int> histogram(8 * 256, 0);
+   for (i=0; i<count; i++) {
+      unsigned long long key = keys[i].first;
+      for (int b=0; b<8; b++) {
+         histogram[b * 256 + ((key >> (b * 8)) & 0xff)]++;
+      }
+   }
+
+   vector<pair<unsigned long long, MidiEvent*> > buffer(count);
+   for (int b=0; b<8; b++) {
+      int* bucket = &histogram[b * 256];
+      // skip byte positions which are the same for every key:
+      if (bucket[keys[0].first >> (b * 8) & 0xff] == count) {
+         continue;
+      }
+      int offset = 0;
+      for (int k=0; k<256; k++) {
+         int n = bucket[k];
+         bucket[k] = offset;
+         offset += n;
+      }
+      for (i=0; i<count; i++) {
+         buffer[bucket[keys[i].first >> (b * 8) & 0xff]++] = keys[i];
+      }
+      keys.swap(buffer);
+   }
+
+   for (i=0; i<count; i++) {
+      list[i] = keys[i].second;
+   }
 }
 
 
@@ -2003,24 +2147,41 @@ double MidiFile::getTimeInSeconds(int tickvalue) {
          return -1.0;    // something went wrong
       }
    }
+   if (tickvalue < 0) {
+      return -1.0;
+   }
+   const _TempoSegment& segment = tempomap[findTempoSegment(tickvalue, -1)];
+   return segment.seconds + (tickvalue - segment.tick) * segment.secondsPerTick;
+}
 
-   _TickTime key;
-   key.tick    = tickvalue;
-   key.seconds = -1;
 
-   void* ptr = bsearch(&key, timemap.data(), timemap.size(),
-         sizeof(_TickTime), ticksearch);
+//
+// Batch version: convert a list of tick values into seconds.  If the ticks
+// are in increasing order, the tempo segment of each tick is found by
+// stepping forward from the previous one, so the list is converted in
+// linear time.
+//
 
-   if (ptr == NULL) {
-      // The specific tick value was not found, so do a linear
-      // search for the two tick values which occur before and
-      // after the tick value, and do a linear interpolation of
-      // the time in seconds values to figure out the final
-      // time in seconds.
-      // Since the code is not yet written, kill the program at this point:
-      return linearSecondInterpolationAtTick(tickvalue);
-   } else {
-      return ((_TickTime*)ptr)->seconds;
+void MidiFile::getTimeInSeconds(const vector<int>& ticks,
+      vector<double>& seconds) {
+   seconds.resize(ticks.size());
+   if (timemapvalid == 0) {
+      buildTimeMap();
+      if (timemapvalid == 0) {
+         fill(seconds.begin(), seconds.end(), -1.0);
+         return;
+      }
+   }
+   int index = 0;
+   for (int i=0; i<(int)ticks.size(); i++) {
+      if (ticks[i] < 0) {
+         seconds[i] = -1.0;
+         continue;
+      }
+      index = findTempoSegment(ticks[i], index);
+      const _TempoSegment& segment = tempomap[index];
+      seconds[i] = segment.seconds +
+            (ticks[i] - segment.tick) * segment.secondsPerTick;
    }
 }
 
@@ -2037,29 +2198,47 @@ int MidiFile::getAbsoluteTickTime(double starttime) {
    if (timemapvalid == 0) {
       buildTimeMap();
       if (timemapvalid == 0) {
-         if (timemapvalid == 0) {
-            return -1.0;    // something went wrong
-         }
+         return -1;    // something went wrong
       }
    }
+   if (starttime < 0.0) {
+      return -1;
+   }
 
-   _TickTime key;
-   key.tick    = -1;
-   key.seconds = starttime;
+   // find the last tempo segment starting at or before the given time:
+   int low  = 0;
+   int high = (int)tempomap.size() - 1;
+   while (low < high) {
+      int middle = (low + high + 1) / 2;
+      if (tempomap[middle].seconds <= starttime) {
+         low = middle;
+      } else {
+         high = middle - 1;
+      }
+   }
+   const _TempoSegment& segment = tempomap[low];
+   if (segment.secondsPerTick <= 0.0) {
+      return segment.tick;
+   }
+   // allow for round-off when the time is exactly on a tick:
+   return segment.tick + (int)((starttime - segment.seconds) /
+         segment.secondsPerTick + 1.0e-9);
+}
 
-   void* ptr = bsearch(&key, timemap.data(), timemap.size(),
-         sizeof(_TickTime), secondsearch);
 
-   if (ptr == NULL) {
-      // The specific seconds value was not found, so do a linear
-      // search for the two time values which occur before and
-      // after the given time value, and do a linear interpolation of
-      // the time in tick values to figure out the final time in ticks.
-      return linearTickInterpolationAtSecond(starttime);
-   } else {
-      return ((_TickTime*)ptr)->tick;
-   }
 
+//////////////////////////////
+//
+// MidiFile::getTempoSegmentCount -- Return the number of tempo segments
+//    in the time map (one more than the number of ticks at which the
+//    tempo changes).
+//
+
+int MidiFile::getTempoSegmentCount(void) {
+   if (timemapvalid == 0) {
+      buildTimeMap();
+   }
+   return (int)tempomap.size();
 }
 
 
@@ -2150,10 +2329,14 @@ void MidiFile::doTimeAnalysis(void) {
 //
 // MidiFile::linkNotePairs --  Link note-ons to note-offs separately
 //     for each track.  Returns the total number of note message pairs
-//     that were linked.
+//     that were linked.  If the tracks are joined, the joined list is
+//     linked in one pass, still keeping the original tracks apart.
 //
 
 int MidiFile::linkNotePairs(void) {
+   if (getTrackState() == TRACK_STATE_JOINED) {
+      return events[0]->linkNotePairsByTrack();
+   }
    int i;
    int sum = 0;
    for (i=0; i<getTrackCount(); i++) {
@@ -2194,222 +2377,271 @@ void MidiFile::clearLinks(void) {
 
 //////////////////////////////
 //
-// MidiFile::linearTickInterpolationAtSecond -- return the tick value at the
-//    given input time.
+// MidiFile::findTempoSegment -- Return the index of the tempo segment
+//    which contains the given tick.  If hint is the index of a segment
+//    at or before the tick (such as the segment of the previous tick in
+//    a sorted list), the search steps forward from there; otherwise a
+//    binary search is done.
 //
 
-int MidiFile::linearTickInterpolationAtSecond(double seconds) {
-   if (timemapvalid == 0) {
-      buildTimeMap();
-      if (timemapvalid == 0) {
-         return -1.0;    // something went wrong
+int MidiFile::findTempoSegment(int tick, int hint) {
+   int count = (int)tempomap.size();
+   if ((hint >= 0) && (hint < count) && (tempomap[hint].tick <= tick)) {
+      while ((hint + 1 < count) && (tempomap[hint+1].tick <= tick)) {
+         hint++;
       }
-   }
-
-   int i;
-   double lasttime = timemap[timemap.size()-1].seconds;
-   // give an error value of -1 if time is out of range of data.
-   if (seconds < 0.0) {
-      return -1;
-   }
-   if (seconds > timemap[timemap.size()-1].seconds) {
-      return -1;
-   }
-
-   // Guess which side of the list is closest to target:
-   // Could do a more efficient algorithm since time values are sorted,
-   // but good enough for now...
-   int startindex = -1;
-   if (seconds < lasttime / 2) {
-      for (i=0; i<(int)timemap.size(); i++) {
-         if (timemap[i].seconds > seconds) {
-            startindex = i-1;
-            break;
-         } else if (timemap[i].seconds == seconds) {
-            startindex = i;
-            break;
-         }
-      }
-   } else {
-      for (i=(int)timemap.size()-1; i>0; i--) {
-         if (timemap[i].seconds < seconds) {
-            startindex = i+1;
-            break;
-         } else if (timemap[i].seconds == seconds) {
-            startindex = i;
-            break;
-         }
+      return hint;
+   }
+   int low  = 0;
+   int high = count - 1;
+   while (low < high) {
+      int middle = (low + high + 1) / 2;
+      if (tempomap[middle].tick <= tick) {
+         low = middle;
+      } else {
+         high = middle - 1;
       }
    }
-
-   if (startindex < 0) {
-      return -1;
-   }
-   if (startindex >= (int)timemap.size()-1) {
-      return -1;
-   }
-
-   double x1 = timemap[startindex].seconds;
-   double x2 = timemap[startindex+1].seconds;
-   double y1 = timemap[startindex].tick;
-   double y2 = timemap[startindex+1].tick;
-   double xi = seconds;
-
-   return (xi-x1) * ((y2-y1)/(x2-x1)) + y1;
+   return low;
 }
 
 
 
 //////////////////////////////
 //
-// MidiFile::linearSecondInterpolationAtTick -- return the time in seconds
-//    value at the given input tick time. (Ticks input could be made double).
+// MidiFile::buildTimeMap -- build a list of the tempo segments of the
+//      MIDI file: the ticks at which the tempo changes, the time in
+//      seconds at those ticks and the tempo which follows.  If no
+//      tempo messages are given (or until they are given, then the
+//      tempo is set to 120 beats per minute).  Only the tempo meta
+//      messages are looked at, and the tracks are left in their current
+//      joined/split and delta/absolute states.  The time in seconds of
+//      every event is then filled in from the segments.  If SMPTE time
+//      code is used, then ticks are actually time values (1000 ticks per
+//      second SMPTE is the only mode tested (25 frames per second and 40
+//      subframes per frame).
 //
 
-double MidiFile::linearSecondInterpolationAtTick(int ticktime) {
-   if (timemapvalid == 0) {
-      buildTimeMap();
-      if (timemapvalid == 0) {
-         return -1.0;    // something went wrong
-      }
-   }
+void MidiFile::buildTimeMap(void) {
+   int tpq = getTicksPerQuarterNote();
+   double defaultTempo = 120.0;
 
-   int i;
-   double lasttick = timemap[timemap.size()-1].tick;
-   // give an error value of -1 if time is out of range of data.
-   if (ticktime < 0.0) {
-      return -1;
-   }
-   if (ticktime > timemap.back().tick) {
-      return -1;  // don't try to extrapolate
-   }
-
-   // Guess which side of the list is closest to target:
-   // Could do a more efficient algorithm since time values are sorted,
-   // but good enough for now...
-   int startindex = -1;
-   if (ticktime < lasttick / 2) {
-      for (i=0; i<(int)timemap.size(); i++) {
-         if (timemap[i].tick > ticktime) {
-            startindex = i-1;
-            break;
-         } else if (timemap[i].tick == ticktime) {
-            startindex = i;
-            break;
+   // collect the tempo changes in the order in which joinTracks() would
+   // place them:
+   vector<MidiEvent*> tempos;
+   vector<int> tempoticks;
+   int track, i, tick;
+   for (track=0; track<(int)events.size(); track++) {
+      MidiEventList& list = *events[track];
+      tick = 0;
+      for (i=0; i<list.size(); i++) {
+         tick = (theTimeState == TIME_STATE_DELTA) ? tick + list[i].tick :
+               list[i].tick;
+         if (list[i].isTempo()) {
+            tempos.push_back(&list[i]);
+            tempoticks.push_back(tick);
          }
       }
-   } else {
-      for (i=(int)timemap.size()-1; i>0; i--) {
-         if (timemap[i].tick < ticktime) {
-            startindex = i;
-            break;
-         } else if (timemap[i].tick == ticktime) {
-            startindex = i;
-            break;
-         }
-      }
-   }
-
-   if (startindex < 0) {
-      return -1;
    }
-   if (startindex >= (int)timemap.size()-1) {
-      return -1;
+   vector<int> order(tempos.size());
+   for (i=0; i<(int)order.size(); i++) {
+      order[i] = i;
    }
+   stable_sort(order.begin(), order.end(), [&](int a, int b) -> bool {
+      if (tempoticks[a] != tempoticks[b]) {
+         return tempoticks[a] < tempoticks[b];
+      }
+      return tempos[a]->seq < tempos[b]->seq;
+   });
 
-   if (timemap[startindex].tick == ticktime) {
-      return timemap[startindex].seconds;
+   tempomap.clear();
+   tempomap.reserve(order.size() + 1);
+   _TempoSegment segment;
+   segment.tick = 0;
+   segment.seconds = 0.0;
+   segment.secondsPerTick = 60.0 / (defaultTempo * tpq);
+   tempomap.push_back(segment);
+   for (i=0; i<(int)order.size(); i++) {
+      _TempoSegment& last = tempomap.back();
+      tick = tempoticks[order[i]];
+      // the new tempo applies to the time after the tempo message:
+      if (tick <= last.tick) {
+         last.secondsPerTick = tempos[order[i]]->getTempoSPT(tpq);
+      } else {
+         segment.tick = tick;
+         segment.seconds = last.seconds + (tick - last.tick) *
+               last.secondsPerTick;
+         segment.secondsPerTick = tempos[order[i]]->getTempoSPT(tpq);
+         tempomap.push_back(segment);
+      }
    }
+   timemapvalid = 1;
 
-   double x1 = timemap[startindex].tick;
-   double x2 = timemap[startindex+1].tick;
-   double y1 = timemap[startindex].seconds;
-   double y2 = timemap[startindex+1].seconds;
-   double xi = ticktime;
-
-   return (xi-x1) * ((y2-y1)/(x2-x1)) + y1;
+   // store the time in seconds of each event:
+   int index;
+   for (track=0; track<(int)events.size(); track++) {
+      MidiEventList& list = *events[track];
+      tick = 0;
+      index = 0;
+      for (i=0; i<list.size(); i++) {
+         tick = (theTimeState == TIME_STATE_DELTA) ? tick + list[i].tick :
+               list[i].tick;
+         index = findTempoSegment(tick, index);
+         list[i].seconds = tempomap[index].seconds +
+               (tick - tempomap[index].tick) * tempomap[index].secondsPerTick;
+      }
+   }
 }
 
 
 
 //////////////////////////////
 //
-// MidiFile::buildTimeMap -- build an index of the absolute tick values
-//      found in a MIDI file, and their corresponding time values in
-//      seconds, taking into consideration tempo change messages.  If no
-//      tempo messages are given (or until they are given, then the
-//      tempo is set to 120 beats per minute).  If SMPTE time code is
-//      used, then ticks are actually time values.  So don't build
-//      a time map for SMPTE ticks, and just calculate the time in
-//      seconds from the tick value (1000 ticks per second SMPTE
-//      is the only mode tested (25 frames per second and 40 subframes
-//      per frame).
+// MidiFile::readTrack -- Read the events of one MTrk chunk into the
+//    given track, starting at ptr (just after the chunk size) and stopping
+//    after the end-of-track meta message or at the end of the input.
+//    The events are created in eventArena.  Return value is 0 if failure;
+//    otherwise, returns 1.
 //
 
-void MidiFile::buildTimeMap(void) {
-
-   // convert the MIDI file to absolute time representation
-   // in single track mode (and undo if the MIDI file was not
-   // in that state when this function was called.
-   //
-   int trackstate = getTrackState();
-   int timestate  = getTickState();
+int MidiFile::readTrack(const uchar*& ptr, const uchar* end, int track,
+      MidiEventArena& eventArena) {
+   uchar runningCommand = 0;
+   MidiMessage message;
+   MidiEvent* event;
+   ulong delta;
+   int absticks = 0;
 
-   absoluteTicks();
-   joinTracks();
+   while (ptr < end) {
+      if (!readVLValue(ptr, end, delta)) {
+         return 0;
+      }
+      absticks += delta;
+      if (!extractMidiData(ptr, end, message, runningCommand)) {
+         return 0;
+      }
+      event = eventArena.newEvent(message);
+      event->tick = absticks;
+      event->track = track;
+      events[track]->push_back_no_copy(event);
+
+      if (message[0] == 0xff && message[1] == 0x2f) {
+         // end of track message (which is always required, and added
+         // automatically when a MIDI is written).
+         break;
+      }
+   }
+   return 1;
+}
 
-   int allocsize = getNumEvents(0);
-   timemap.reserve(allocsize+10);
-   timemap.clear();
 
-   _TickTime value;
 
-   int lasttick = 0;
-   int curtick;
-   int tickinit = 0;
+//////////////////////////////
+//
+// MidiFile::readTracksParallel -- Scan the table of MTrk chunks using
+//    their size fields, then decode the chunks concurrently, one track
+//    per task.  Each thread creates its events in its own arena, and the
+//    arenas are handed over to the file's arena afterwards.  Returns 0
+//    without reporting an error if the chunk sizes do not describe the
+//    file exactly (each chunk must end with its end-of-track message), in
+//    which case the caller should read the tracks serially instead.
+//
 
+int MidiFile::readTracksParallel(const uchar* ptr, const uchar* end,
+      int tracks) {
+   vector<const uchar*> starts(tracks);
+   vector<const uchar*> stops(tracks);
+   ulong length;
    int i;
-   int tpq = getTicksPerQuarterNote();
-   double defaultTempo = 120.0;
-   double secondsPerTick = 60.0 / (defaultTempo * tpq);
-
-   double lastsec = 0.0;
-   double cursec = 0.0;
-
-   for (i=0; i<getNumEvents(0); i++) {
-      curtick = getEvent(0, i).tick;
-      getEvent(0, i).seconds = cursec;
-      if ((curtick > lasttick) || !tickinit) {
-         tickinit = 1;
+   for (i=0; i<tracks; i++) {
+      if ((end - ptr < 8) || (memcmp(ptr, "MTrk", 4) != 0)) {
+         return 0;
+      }
+      length = MidiFile::readLittleEndian4Bytes(ptr + 4);
+      ptr += 8;
+      if ((length < 3) || (length > (ulong)(end - ptr))) {
+         return 0;
+      }
+      starts[i] = ptr;
+      stops[i]  = ptr + length;
+      if ((stops[i][-3] != 0xff) || (stops[i][-2] != 0x2f) ||
+            (stops[i][-1] != 0x00)) {
+         return 0;
+      }
+      ptr += length;
+      events[i]->reserve((int)(length/2));
+   }
 
-         // calculate the current time in seconds:
-         cursec = lastsec + (curtick - lasttick) * secondsPerTick;
-         getEvent(0, i).seconds = cursec;
+   int threadcount = readThreads;
+   if (threadcount <= 0) {
+      threadcount = (int)thread::hardware_concurrency();
+   }
+   if (threadcount > tracks) {
+      threadcount = tracks;
+   }
+   if (threadcount < 1) {
+      threadcount = 1;
+   }
 
-         // store the new tick to second mapping
-         value.tick = curtick;
-         value.seconds = cursec;
-         timemap.push_back(value);
-         lasttick   = curtick;
-         lastsec    = cursec;
+   vector<int> success(tracks, 0);
+   vector<MidiEventArena> arenas(threadcount);
+   atomic<int> nexttrack(0);
+   auto worker = [&](int index) {
+      int track;
+      while ((track = nexttrack++) < tracks) {
+         const uchar* cursor = starts[track];
+         success[track] = readTrack(cursor, stops[track], track,
+               arenas[index]) && (cursor == stops[track]);
       }
+   };
 
-      // update the tempo if needed:
-      if (getEvent(0,i).isTempo()) {
-         secondsPerTick = getEvent(0,i).getTempoSPT(getTicksPerQuarterNote());
-      }
+   vector<thread> pool;
+   for (i=1; i<threadcount; i++) {
+      pool.push_back(thread(worker, i));
    }
-
-   // reset the states of the tracks or time values if necessary here:
-   if (timestate == TIME_STATE_DELTA) {
-      deltaTicks();
+   worker(0);
+   for (i=0; i<(int)pool.size(); i++) {
+      pool[i].join();
    }
-   if (trackstate == TRACK_STATE_SPLIT) {
-      splitTracks();
+   for (i=0; i<threadcount; i++) {
+      arena->splice(arenas[i]);
    }
 
-   timemapvalid = 1;
+   for (i=0; i<tracks; i++) {
+      if (!success[i]) {
+         return 0;
+      }
+   }
+   return 1;
+}
+
+
+
+//////////////////////////////
+//
+// MidiFile::checkChunkId -- Verify that the next four bytes of input
+//    match the given chunk identifier ("MThd" or "MTrk").  Return value
+//    is 0 if failure; otherwise, returns 1.
+//
 
+int MidiFile::checkChunkId(const uchar*& ptr, const uchar* end,
+      const char* id, const char* location) {
+   const char* filename = getFilename();
+   for (int i=0; i<4; i++) {
+      if (ptr >= end) {
+         cerr << "In file " << filename << ": unexpected end of file." << endl;
+         cerr << "Expecting '" << id[i] << "' at byte " << i+1 << location
+              << ", but found nothing." << endl;
+         return 0;
+      } else if (*ptr != (uchar)id[i]) {
+         cerr << "File " << filename << " is not a MIDI file" << endl;
+         cerr << "Expecting '" << id[i] << "' at byte " << i+1 << location
+              << " but got '" << (int)*ptr << "'" << endl;
+         return 0;
+      }
+      ptr++;
+   }
+   return 1;
 }
 
 
@@ -2417,23 +2649,22 @@ void MidiFile::buildTimeMap(void) {
 //////////////////////////////
 //
 // MidiFile::extractMidiData -- Extract MIDI data from input
-//    stream.  Return value is 0 if failure; otherwise, returns 1.
+//    bytes, advancing ptr past the message.  Return value is 0 if
+//    failure; otherwise, returns 1.
 //
 
-int MidiFile::extractMidiData(istream& input, vector<uchar>& array,
-   uchar& runningCommand) {
+int MidiFile::extractMidiData(const uchar*& ptr, const uchar* end,
+      MidiMessage& array, uchar& runningCommand) {
 
-   int character;
    uchar byte;
    array.clear();
    int runningQ;
 
-   character = input.get();
-   if (character == EOF) {
+   if (ptr >= end) {
       cerr << "Error: unexpected end of file." << endl;
       return 0;
    } else {
-      byte = (uchar)character;
+      byte = *ptr++;
    }
 
    if (byte < 0x80) {
@@ -2457,43 +2688,34 @@ int MidiFile::extractMidiData(istream& input, vector<uchar>& array,
       array.push_back(byte);
    }
 
-   int i;
-   uchar metai;
+   ulong length = 0;
+   const uchar* start;
    switch (runningCommand & 0xf0) {
       case 0x80:        // note off (2 more bytes)
       case 0x90:        // note on (2 more bytes)
       case 0xA0:        // aftertouch (2 more bytes)
       case 0xB0:        // cont. controller (2 more bytes)
       case 0xE0:        // pitch wheel (2 more bytes)
-         byte = MidiFile::readByte(input);
-         array.push_back(byte);
-         if (!runningQ) {
-            byte = MidiFile::readByte(input);
-            array.push_back(byte);
-         }
+         length = runningQ ? 1 : 2;
          break;
       case 0xC0:        // patch change (1 more byte)
       case 0xD0:        // channel pressure (1 more byte)
-         if (!runningQ) {
-            byte = MidiFile::readByte(input);
-            array.push_back(byte);
-         }
+         length = runningQ ? 0 : 1;
          break;
       case 0xF0:
          switch (runningCommand) {
             case 0xff:                 // meta event
-               {
-               if (!runningQ) {
-                  byte = MidiFile::readByte(input); // meta type
-               array.push_back(byte);
-               }
-               metai = MidiFile::readByte(input); // meta type
-               array.push_back(metai);
-               for (uchar j=0; j<metai; j++) {
-                  byte = MidiFile::readByte(input); // meta type
-                  array.push_back(byte);
+               if (ptr >= end) {
+                  cerr << "Error: unexpected end of file." << endl;
+                  return 0;
                }
+               array.push_back(*ptr++); // meta type
+               // the VLV data length is kept in the message:
+               start = ptr;
+               if (!readVLValue(ptr, end, length)) {
+                  return 0;
                }
+               array.append(start, ptr);
                break;
             // The 0xf0 and 0xf7 meta commands deal with system-exclusive
             // messages. 0xf0 is used to either start a message or to store
@@ -2508,12 +2730,9 @@ int MidiFile::extractMidiData(istream& input, vector<uchar>& array,
                                       // bytes, but are included to indicate
                                       // that this is a raw byte message.
             case 0xf0:                // System Exclusive message
-               {                      // (complete, or start of message).
-               int length = (int)readVLValue(input);
-               for (i=0; i<length; i++) {
-                  byte = MidiFile::readByte(input);
-                  array.push_back(byte);
-               }
+                                      // (complete, or start of message).
+               if (!readVLValue(ptr, end, length)) {
+                  return 0;
                }
                break;
              // other "F" MIDI commands are not expected, but can be
@@ -2525,6 +2744,13 @@ int MidiFile::extractMidiData(istream& input, vector<uchar>& array,
          cout << "Command byte was " << (int)runningCommand << endl;
          return 0;
    }
+
+   if (length > (ulong)(end - ptr)) {
+      cerr << "Error: unexpected end of file." << endl;
+      return 0;
+   }
+   array.append(ptr, ptr + length);
+   ptr += length;
    return 1;
 }
 
@@ -2533,20 +2759,26 @@ int MidiFile::extractMidiData(istream& input, vector<uchar>& array,
 //////////////////////////////
 //
 // MidiFile::readVLValue -- The VLV value is expected to be unpacked into
-//   a 4-byte integer, so only up to 5 bytes will be considered.
+//   a 4-byte integer, so only up to 5 bytes will be considered.  Return
+//   value is 0 if the input ends before the VLV; otherwise, returns 1.
 //
 
-ulong MidiFile::readVLValue(istream& input) {
+int MidiFile::readVLValue(const uchar*& ptr, const uchar* end, ulong& value) {
    uchar b[5] = {0};
 
    for (int i=0; i<5; i++) {
-      b[i] = MidiFile::readByte(input);
+      if (ptr >= end) {
+         cerr << "Error: unexpected end of file." << endl;
+         return 0;
+      }
+      b[i] = *ptr++;
       if (b[i] < 0x80) {
          break;
       }
    }
 
-   return unpackVLV(b[0], b[1], b[2], b[3], b[4]);
+   value = unpackVLV(b[0], b[1], b[2], b[3], b[4]);
+   return 1;
 }
 
 
@@ -2589,6 +2821,18 @@ ulong MidiFile::unpackVLV(uchar a, uchar b, uchar c, uchar d, uchar e) {
 //
 
 void MidiFile::writeVLValue(long aValue, vector<uchar>& outdata) {
+   uchar bytes[5];
+   uchar* end = writeVLValue(aValue, bytes);
+   outdata.insert(outdata.end(), bytes, end);
+}
+
+
+//
+// pointer version of writeVLValue().  The bytes are stored at ptr and
+// a pointer to the byte after the value is returned.
+//
+
+uchar* MidiFile::writeVLValue(long aValue, uchar* ptr) {
    uchar bytes[5] = {0};
    bytes[0] = (uchar)(((ulong)aValue >> 28) & 0x7f);  // most significant 5 bits
    bytes[1] = (uchar)(((ulong)aValue >> 21) & 0x7f);  // next largest 7 bits
@@ -2600,10 +2844,72 @@ void MidiFile::writeVLValue(long aValue, vector<uchar>& outdata) {
    while (start<5 && bytes[start] == 0)  start++;
 
    for (int i=start; i<4; i++) {
-      bytes[i] = bytes[i] | 0x80;
-      outdata.push_back(bytes[i]);
+      *ptr++ = bytes[i] | 0x80;
+   }
+   *ptr++ = bytes[4];
+   return ptr;
+}
+
+
+
+//////////////////////////////
+//
+// MidiFile::getVLValueSize -- return the number of bytes which
+//    writeVLValue() will use to store the given number.
+//
+
+int MidiFile::getVLValueSize(long aValue) {
+   ulong value = (ulong)aValue;
+   if ((value >> 7)  == 0) return 1;
+   if ((value >> 14) == 0) return 2;
+   if ((value >> 21) == 0) return 3;
+   if ((value >> 28) == 0) return 4;
+   return 5;
+}
+
+
+
+//////////////////////////////
+//
+// MidiFile::getTrackDataSize -- return the number of bytes which write()
+//    will produce for the events of a track, not counting the chunk
+//    header or any end-of-track message which has to be added.
+//
+
+size_t MidiFile::getTrackDataSize(int track) {
+   MidiEventList& list = *events[track];
+   int deltaQ = (getTickState() == TIME_STATE_DELTA);
+   int lasttick = 0;
+   size_t size = 0;
+   for (int j=0; j<list.size(); j++) {
+      MidiEvent& event = list[j];
+      int delta = deltaQ ? event.tick : event.tick - lasttick;
+      lasttick = event.tick;
+      if (event.isEndOfTrack()) {
+         continue;
+      }
+      size += getVLValueSize(delta) + event.size();
+      int command = event.getCommandByte();
+      if ((command == 0xf0) || (command == 0xf7)) {
+         size += getVLValueSize(event.size() - 1);
+      }
+   }
+   return size;
+}
+
+
+
+//////////////////////////////
+//
+// MidiFile::writeBigEndian -- store the low count bytes of a number,
+//    most significant byte first, and return a pointer past them.
+//
+
+uchar* MidiFile::writeBigEndian(uchar* ptr, ulong value, int count) {
+   for (int i=count-1; i>=0; i--) {
+      *ptr++ = (uchar)((value >> (8 * i)) & 0xff);
    }
-   outdata.push_back(bytes[4]);
+   return ptr;
 }
 
 
@@ -2624,9 +2930,9 @@ void MidiFile::clear_no_deallocate(void) {
       events[i] = NULL;
    }
    events.resize(1);
-   events[0] = new MidiEventList;
+   events[0] = new MidiEventList(arena);
    timemapvalid=0;
-   timemap.clear();
+   tempomap.clear();
    // events.resize(0);   // causes a memory leak [20150205 Jorden Thatcher]
 }
 
@@ -2718,41 +3024,40 @@ ostream& operator<<(ostream& out, MidiFile& aMidiFile) {
 
 //////////////////////////////
 //
-// MidiFile::ticksearch -- for finding a tick entry in the time map.
+// MidiFile::getSortKey -- Pack the fields which eventcompare() looks
+//    at into one integer, so that ordering the keys orders the events:
+//       bits 32-63: tick (offset so that negative ticks sort first)
+//       bits  3-31: sequence number (see markSequence())
+//       bits  0- 2: rank of the message type: 0 = meta message,
+//                   1 = other, 2 = note-off, 3 = note-on,
+//                   4 = end-of-track.
+//    Returns 0 if the sequence number does not fit into the key.
 //
 
-int MidiFile::ticksearch(const void* A, const void* B) {
-   _TickTime& a = *((_TickTime*)A);
-   _TickTime& b = *((_TickTime*)B);
-
-   if (a.tick < b.tick) {
-      return -1;
-   } else if (a.tick > b.tick) {
-      return 1;
+int MidiFile::getSortKey(const MidiEvent& event, unsigned long long& key) {
+   if ((event.seq < 0) || (event.seq >= (1 << 29))) {
+      return 0;
    }
-   return 0;
-}
-
-
-
-//////////////////////////////
-//
-// MidiFile::secondsearch -- for finding a second entry in the time map.
-//
-
-int MidiFile::secondsearch(const void* A, const void* B) {
-   _TickTime& a = *((_TickTime*)A);
-   _TickTime& b = *((_TickTime*)B);
-
-   if (a.seconds < b.seconds) {
-      return -1;
-   } else if (a.seconds > b.seconds) {
-      return 1;
+   int rank = 1;
+   int size = (int)event.size();
+   if (size > 0) {
+      int command = event[0];
+      if (command == 0xff) {
+         rank = (size > 1) && (event[1] == 0x2f) ? 4 : 0;
+      } else if (((command & 0xf0) == 0x90) && (size > 2) &&
+            (event[2] != 0)) {
+         rank = 3;
+      } else if (((command & 0xf0) == 0x90) || ((command & 0xf0) == 0x80)) {
+         rank = 2;
+      }
    }
-   return 0;
+   key = ((unsigned long long)((unsigned int)event.tick ^ 0x80000000u) << 32)
+         | ((unsigned long long)event.seq << 3) | rank;
+   return 1;
 }
 
 
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // Static functions:
@@ -2777,6 +3082,17 @@ ulong MidiFile::readLittleEndian4Bytes(istream& input) {
 }
 
 
+//
+// memory version of readLittleEndian4Bytes().  The caller is responsible
+// for checking that four bytes are available.
+//
+
+ulong MidiFile::readLittleEndian4Bytes(const uchar* data) {
+   return (ulong)data[3] | ((ulong)data[2] << 8) | ((ulong)data[1] << 16) |
+         ((ulong)data[0] << 24);
+}
+
+
 
 //////////////////////////////
 //
@@ -2796,6 +3112,16 @@ ushort MidiFile::readLittleEndian2Bytes(istream& input) {
 }
 
 
+//
+// memory version of readLittleEndian2Bytes().  The caller is responsible
+// for checking that two bytes are available.
+//
+
+ushort MidiFile::readLittleEndian2Bytes(const uchar* data) {
+   return data[1] | (data[0] << 8);
+}
+
+
 
 //////////////////////////////
 //
@@ -3027,6 +3353,7 @@ ostream& MidiFile::writeLittleEndianDouble(ostream& out, double value) {
 
 MidiFile& MidiFile::operator=(MidiFile other) {
    events.swap(other.events);
+   std::swap(arena, other.arena);
    return *this;
 }
 
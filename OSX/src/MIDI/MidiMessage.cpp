@@ -2,6 +2,7 @@
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Feb 14 20:49:21 PST 2015
 // Last Modified: Sat Feb 14 21:40:31 PST 2015
+// Last Modified: Fri Oct 16 13:05:51 PDT 2026 Inline storage for short messages.
 // Filename:      midifile/src-library/MidiMessage.cpp
 // Website:       http://midifile.sapp.org
 // Syntax:        C++11
@@ -16,6 +17,7 @@
 #include <vector>
 #include <iostream>
 #include <iterator>
+#include <string.h>
 
 using namespace std;
 
@@ -25,25 +27,29 @@ using namespace std;
 // MidiMessage::MidiMessage -- Constructor.
 //
 
-MidiMessage::MidiMessage(void) {
+MidiMessage::MidiMessage(void) : bytecount(0),
+      bytecapacity(INLINE_SIZE), borrowed(0) {
    // do nothing
 }
 
 
-MidiMessage::MidiMessage(int command) {
+MidiMessage::MidiMessage(int command) : bytecount(0),
+      bytecapacity(INLINE_SIZE), borrowed(0) {
    this->resize(1);
    (*this)[0] = (uchar)command;
 }
 
 
-MidiMessage::MidiMessage(int command, int p1) {
+MidiMessage::MidiMessage(int command, int p1) : bytecount(0),
+      bytecapacity(INLINE_SIZE), borrowed(0) {
    this->resize(2);
    (*this)[0] = (uchar)command;
    (*this)[1] = (uchar)p1;
 }
 
 
-MidiMessage::MidiMessage(int command, int p1, int p2) {
+MidiMessage::MidiMessage(int command, int p1, int p2) : bytecount(0),
+      bytecapacity(INLINE_SIZE), borrowed(0) {
    this->resize(3);
    (*this)[0] = (uchar)command;
    (*this)[1] = (uchar)p1;
@@ -51,22 +57,32 @@ MidiMessage::MidiMessage(int command, int p1, int p2) {
 }
 
 
-MidiMessage::MidiMessage(const MidiMessage& message) {
-   (*this) = message;
+MidiMessage::MidiMessage(const MidiMessage& message) : bytecount(0),
+      bytecapacity(INLINE_SIZE), borrowed(0) {
+   assign(message.begin(), message.end());
 }
 
 
-MidiMessage::MidiMessage(const vector<uchar>& message) {
+MidiMessage::MidiMessage(MidiMessage&& message) : bytecount(0),
+      bytecapacity(INLINE_SIZE), borrowed(0) {
+   (*this) = std::move(message);
+}
+
+
+MidiMessage::MidiMessage(const vector<uchar>& message) : bytecount(0),
+      bytecapacity(INLINE_SIZE), borrowed(0) {
    setMessage(message);
 }
 
 
-MidiMessage::MidiMessage(const vector<char>& message) {
+MidiMessage::MidiMessage(const vector<char>& message) : bytecount(0),
+      bytecapacity(INLINE_SIZE), borrowed(0) {
    setMessage(message);
 }
 
 
-MidiMessage::MidiMessage(const vector<int>& message) {
+MidiMessage::MidiMessage(const vector<int>& message) : bytecount(0),
+      bytecapacity(INLINE_SIZE), borrowed(0) {
    setMessage(message);
 }
 
@@ -78,7 +94,9 @@ MidiMessage::MidiMessage(const vector<int>& message) {
 //
 
 MidiMessage::~MidiMessage() {
-   resize(0);
+   if (!isInline() && !borrowed) {
+      delete [] storage.heap;
+   }
 }
 
 
@@ -92,15 +110,34 @@ MidiMessage& MidiMessage::operator=(const MidiMessage& message) {
    if (this == &message) {
       return *this;
    }
-   (*this) = message;
+   assign(message.begin(), message.end());
    return *this;
 }
 
 
-MidiMessage& MidiMessage::operator=(const vector<uchar>& bytes) {
-   if (this == &bytes) {
+MidiMessage& MidiMessage::operator=(MidiMessage&& message) {
+   if (this == &message) {
       return *this;
    }
+   if (message.isInline() || message.borrowed) {
+      assign(message.begin(), message.end());
+   } else {
+      // take over the heap block of the other message:
+      if (!isInline() && !borrowed) {
+         delete [] storage.heap;
+      }
+      storage.heap = message.storage.heap;
+      bytecount    = message.bytecount;
+      bytecapacity = message.bytecapacity;
+      borrowed     = 0;
+      message.bytecapacity = INLINE_SIZE;
+   }
+   message.bytecount = 0;
+   return *this;
+}
+
+
+MidiMessage& MidiMessage::operator=(const vector<uchar>& bytes) {
    setMessage(bytes);
    return *this;
 }
@@ -119,6 +156,142 @@ MidiMessage& MidiMessage::operator=(const vector<int>& bytes) {
 
 
 
+//////////////////////////////
+//
+// MidiMessage::capacity -- Return the number of bytes which can be
+//     stored in the message before more memory has to be allocated.
+//
+
+size_t MidiMessage::capacity(void) const {
+   return bytecapacity;
+}
+
+
+
+//////////////////////////////
+//
+// MidiMessage::resize -- Change the number of bytes in the message.
+//     Any newly added bytes will be set to 0.
+//
+
+void MidiMessage::resize(size_t asize) {
+   if (asize > bytecapacity) {
+      grow(asize);
+   }
+   if (asize > bytecount) {
+      memset(data() + bytecount, 0, asize - bytecount);
+   }
+   bytecount = (unsigned int)asize;
+}
+
+
+
+//////////////////////////////
+//
+// MidiMessage::reserve -- Allocate space for at least the given number
+//     of bytes without changing the size of the message.
+//
+
+void MidiMessage::reserve(size_t asize) {
+   if (asize > bytecapacity) {
+      grow(asize);
+   }
+}
+
+
+
+//////////////////////////////
+//
+// MidiMessage::push_back -- Add a byte to the end of the message.
+//
+
+void MidiMessage::push_back(const uchar& value) {
+   if (bytecount >= bytecapacity) {
+      grow(bytecount * 2);
+   }
+   data()[bytecount++] = value;
+}
+
+
+
+//////////////////////////////
+//
+// MidiMessage::append -- Add a list of bytes to the end of the message.
+//
+
+void MidiMessage::append(const uchar* first, const uchar* last) {
+   size_t count = last - first;
+   if (bytecount + count > bytecapacity) {
+      grow(bytecount + count);
+   }
+   memcpy(data() + bytecount, first, count);
+   bytecount += (unsigned int)count;
+}
+
+
+
+//////////////////////////////
+//
+// MidiMessage::assign -- Replace the contents of the message with
+//     a list of bytes.
+//
+
+void MidiMessage::assign(const uchar* first, const uchar* last) {
+   bytecount = 0;
+   append(first, last);
+}
+
+
+
+//////////////////////////////
+//
+// MidiMessage::grow -- Move the bytes of the message into a heap block
+//     which can hold at least asize bytes.
+//
+
+void MidiMessage::grow(size_t asize) {
+   if (asize <= bytecapacity) {
+      return;
+   }
+   uchar* newbytes = new uchar[asize];
+   if (bytecount > 0) {
+      memcpy(newbytes, data(), bytecount);
+   }
+   if (!isInline() && !borrowed) {
+      delete [] storage.heap;
+   }
+   storage.heap = newbytes;
+   bytecapacity = (unsigned int)asize;
+   borrowed     = 0;
+}
+
+
+
+//////////////////////////////
+//
+// MidiMessage::setStorage -- Store the bytes of the message in a block of
+//     memory owned by the caller, such as a MidiEventArena, which must
+//     outlive the message.  The contents of the message are cleared.
+//     Blocks too small to be worth using are ignored.  If the message
+//     later grows beyond the block, it moves to its own heap storage.
+//
+
+void MidiMessage::setStorage(uchar* buffer, size_t asize) {
+   if (asize <= INLINE_SIZE) {
+      bytecount = 0;
+      return;
+   }
+   if (!isInline() && !borrowed) {
+      delete [] storage.heap;
+   }
+   storage.heap = buffer;
+   bytecount    = 0;
+   bytecapacity = (unsigned int)asize;
+   borrowed     = 1;
+}
+
+
+
 //////////////////////////////
 //
 // MidiMessage::setSize -- Change the size of the message byte list.
@@ -0,0 +1,406 @@
+//
+// Creation Date: Fri Oct 16 17:02:44 PDT 2026
+// Last Modified: Fri Oct 16 17:02:44 PDT 2026
+// Filename:      midifile/src/MidiNoteIndex.cpp
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Centered interval tree over the linked note pairs of a
+//                MidiFile.  Each node holds the notes sounding at its
+//                center point twice: once sorted by start and once sorted
+//                by end, so a query only touches notes it returns plus
+//                one path down the tree.  Notes are half-open spans from
+//                the note-on up to (not including) the note-off, so notes
+//                of zero length never sound and are left out.
+//
+
+#include "MidiNoteIndex.h"
+
+#include <algorithm>
+
+using namespace std;
+
+
+//////////////////////////////
+//
+// MidiNoteIndex::MidiNoteIndex -- Constructor.
+//
+
+MidiNoteIndex::MidiNoteIndex(void) {
+   root = -1;
+}
+
+
+MidiNoteIndex::MidiNoteIndex(MidiFile& midifile, int channel) {
+   root = -1;
+   build(midifile, channel);
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteIndex::~MidiNoteIndex -- Deconstructor.
+//
+
+MidiNoteIndex::~MidiNoteIndex() {
+   clear();
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteIndex::build -- Index the notes of a MidiFile, or only those of
+//     one channel if channel is 0-15.  The notes must already be linked
+//     with MidiFile::linkNotePairs(); unlinked note-ons are skipped.  The
+//     time analysis is done here if needed.  Returns the number of notes
+//     indexed.  Works on joined or split tracks.
+//
+
+int MidiNoteIndex::build(MidiFile& midifile, int channel) {
+   clear();
+   midifile.doTimeAnalysis();
+
+   for (int i=0; i<midifile.getTrackCount(); i++) {
+      MidiEventList& list = midifile[i];
+      for (int j=0; j<list.size(); j++) {
+         MidiEvent& event = list[j];
+         if (!event.isNoteOn()) {
+            continue;
+         }
+         if ((channel >= 0) && (event.getChannel() != channel)) {
+            continue;
+         }
+         MidiEvent* off = event.getLinkedEvent();
+         if ((off == NULL) || (off->tick <= event.tick)) {
+            continue;
+         }
+         MidiNoteSpan span;
+         span.starttick = event.tick;
+         span.endtick   = off->tick;
+         span.starttime = event.seconds;
+         span.endtime   = off->seconds;
+         span.track     = event.track;
+         span.index     = j;
+         span.channel   = event.getChannel();
+         span.key       = event.getKeyNumber();
+         span.velocity  = event.getVelocity();
+         spans.push_back(span);
+      }
+   }
+
+   // Order by start so that note numbers follow the music, which also
+   // gives every node its notes already sorted by start.
+   stable_sort(spans.begin(), spans.end(),
+         [](const MidiNoteSpan& a, const MidiNoteSpan& b) {
+            if (a.starttick != b.starttick) {
+               return a.starttick < b.starttick;
+            }
+            return a.endtick < b.endtick;
+         });
+
+   vector<int> items(spans.size());
+   for (int i=0; i<(int)items.size(); i++) {
+      items[i] = i;
+   }
+   nodes.reserve(spans.size());
+   bystart.reserve(spans.size());
+   byend.reserve(spans.size());
+   root = buildNode(items);
+
+   return (int)spans.size();
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteIndex::clear -- Remove all notes from the index.
+//
+
+void MidiNoteIndex::clear(void) {
+   spans.clear();
+   nodes.clear();
+   bystart.clear();
+   byend.clear();
+   root = -1;
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteIndex::size -- Return the number of notes in the index.
+//
+
+int MidiNoteIndex::size(void) const {
+   return (int)spans.size();
+}
+
+
+int MidiNoteIndex::getNoteCount(void) const {
+   return size();
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteIndex::operator[] -- Return a note by its number.  Notes are
+//    numbered in order of start tick, and queries return note numbers.
+//
+
+const MidiNoteSpan& MidiNoteIndex::operator[](int index) const {
+   return spans[index];
+}
+
+
+const MidiNoteSpan& MidiNoteIndex::getNote(int index) const {
+   return spans[index];
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteIndex::getNotesAtTick -- Store the numbers of the notes sounding
+//     at the given tick, in no particular order.  A note sounds from its
+//     note-on tick up to but not including its note-off tick.  Returns the
+//     number of notes found.
+//
+
+int MidiNoteIndex::getNotesAtTick(int tick, vector<int>& notes) const {
+   notes.clear();
+   stab(tick, 0, notes);
+   return (int)notes.size();
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteIndex::getNotesAtTime -- Same as getNotesAtTick(), but with
+//     the time given in seconds.
+//
+
+int MidiNoteIndex::getNotesAtTime(double seconds, vector<int>& notes) const {
+   notes.clear();
+   stab(seconds, 1, notes);
+   return (int)notes.size();
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteIndex::getNotesInTicks -- Store the numbers of the notes which
+//     sound at any point from starttick up to but not including endtick,
+//     in no particular order.  Returns the number of notes found.
+//
+
+int MidiNoteIndex::getNotesInTicks(int starttick, int endtick,
+      vector<int>& notes) const {
+   notes.clear();
+   if (starttick < endtick) {
+      overlap(root, starttick, endtick, 0, notes);
+   }
+   return (int)notes.size();
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteIndex::getNotesInTime -- Same as getNotesInTicks(), but with
+//     the times given in seconds.
+//
+
+int MidiNoteIndex::getNotesInTime(double starttime, double endtime,
+      vector<int>& notes) const {
+   notes.clear();
+   if (starttime < endtime) {
+      overlap(root, starttime, endtime, 1, notes);
+   }
+   return (int)notes.size();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// private functions
+//
+
+//////////////////////////////
+//
+// MidiNoteIndex::buildNode -- Make a tree node for a set of notes which
+//     is sorted by start.  The center is the start of the middle note,
+//     so that note (at least) stays at the node and each side gets at
+//     most half of the notes.  Returns the node index, or -1 if the set
+//     is empty.
+//
+
+int MidiNoteIndex::buildNode(vector<int>& items) {
+   if (items.empty()) {
+      return -1;
+   }
+
+   int center = items[items.size() / 2];
+   int centertick = spans[center].starttick;
+
+   vector<int> leftitems;
+   vector<int> rightitems;
+   int first = (int)bystart.size();
+   for (int i=0; i<(int)items.size(); i++) {
+      const MidiNoteSpan& span = spans[items[i]];
+      if (span.endtick <= centertick) {
+         leftitems.push_back(items[i]);
+      } else if (span.starttick > centertick) {
+         rightitems.push_back(items[i]);
+      } else {
+         bystart.push_back(items[i]);
+         byend.push_back(items[i]);
+      }
+   }
+
+   _NoteIndexNode node;
+   node.centertick = centertick;
+   node.centertime = spans[center].starttime;
+   node.first      = first;
+   node.count      = (int)bystart.size() - first;
+   sort(byend.begin() + first, byend.end(), [this](int a, int b) {
+         if (spans[a].endtick != spans[b].endtick) {
+            return spans[a].endtick > spans[b].endtick;
+         }
+         return a < b;
+      });
+
+   // The items are no longer needed, so free them before going deeper.
+   vector<int>().swap(items);
+
+   int index = (int)nodes.size();
+   nodes.push_back(node);
+   int left  = buildNode(leftitems);
+   int right = buildNode(rightitems);
+   nodes[index].left  = left;
+   nodes[index].right = right;
+   return index;
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteIndex::stab -- Collect the notes sounding at a point.  Only one
+//     path down the tree is followed: at each node the notes found are
+//     exactly a prefix of one of the node's sorted lists.
+//
+
+void MidiNoteIndex::stab(double point, int timeQ, vector<int>& notes) const {
+   int node = root;
+   while (node >= 0) {
+      const _NoteIndexNode& entry = nodes[node];
+      double center = getCenter(node, timeQ);
+      int i;
+      if (point < center) {
+         // every note here ends after center, so only the start matters
+         for (i=entry.first; i<entry.first + entry.count; i++) {
+            if (getStart(bystart[i], timeQ) > point) {
+               break;
+            }
+            notes.push_back(bystart[i]);
+         }
+         node = entry.left;
+      } else {
+         // every note here starts at or before center, so only the end
+         for (i=entry.first; i<entry.first + entry.count; i++) {
+            if (getEnd(byend[i], timeQ) <= point) {
+               break;
+            }
+            notes.push_back(byend[i]);
+         }
+         node = (point == center) ? -1 : entry.right;
+      }
+   }
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteIndex::overlap -- Collect the notes overlapping [start, end).
+//     Both sides of a node are only searched when its center is inside
+//     of the range, in which case all of its notes are returned.
+//
+
+void MidiNoteIndex::overlap(int node, double start, double end, int timeQ,
+      vector<int>& notes) const {
+   while (node >= 0) {
+      const _NoteIndexNode& entry = nodes[node];
+      double center = getCenter(node, timeQ);
+      int i;
+      if (center < start) {
+         for (i=entry.first; i<entry.first + entry.count; i++) {
+            if (getEnd(byend[i], timeQ) <= start) {
+               break;
+            }
+            notes.push_back(byend[i]);
+         }
+         node = entry.right;
+      } else if (center >= end) {
+         for (i=entry.first; i<entry.first + entry.count; i++) {
+            if (getStart(bystart[i], timeQ) >= end) {
+               break;
+            }
+            notes.push_back(bystart[i]);
+         }
+         node = entry.left;
+      } else {
+         notes.insert(notes.end(), bystart.begin() + entry.first,
+               bystart.begin() + entry.first + entry.count);
+         overlap(entry.left, start, end, timeQ, notes);
+         node = entry.right;
+      }
+   }
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteIndex::getStart -- Return the start of a note in ticks, or in
+//     seconds if timeQ is true.  Seconds increase with ticks, so one tree
+//     serves both units.
+//
+
+double MidiNoteIndex::getStart(int note, int timeQ) const {
+   return timeQ ? spans[note].starttime : spans[note].starttick;
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteIndex::getEnd -- Return the end of a note in ticks, or in
+//     seconds if timeQ is true.
+//
+
+double MidiNoteIndex::getEnd(int note, int timeQ) const {
+   return timeQ ? spans[note].endtime : spans[note].endtick;
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteIndex::getCenter -- Return the center of a node in ticks, or in
+//     seconds if timeQ is true.
+//
+
+double MidiNoteIndex::getCenter(int node, int timeQ) const {
+   return timeQ ? nodes[node].centertime : nodes[node].centertick;
+}
+
+
+
@@ -0,0 +1,100 @@
+//
+// Creation Date: Fri Oct 16 17:02:44 PDT 2026
+// Last Modified: Fri Oct 16 17:02:44 PDT 2026
+// Filename:      midifile/include/MidiNoteIndex.h
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Immutable index of the notes in a MidiFile which answers
+//                "which notes are sounding at this tick (or second)" and
+//                "which notes overlap this span" in O(log n + k) time.
+//                The notes are copied out of the file when the index is
+//                built, so the index stays valid after the file is
+//                changed or destroyed.  Const queries on one index may
+//                run from several threads at once.
+//
+
+#ifndef _MIDINOTEINDEX_H_INCLUDED
+#define _MIDINOTEINDEX_H_INCLUDED
+
+#include "MidiFile.h"
+
+#include <vector>
+
+using namespace std;
+
+class MidiNoteSpan {
+   public:
+      int    starttick;    // tick of the note-on
+      int    endtick;      // tick of the note-off
+      double starttime;    // note-on time in seconds
+      double endtime;      // note-off time in seconds
+      int    track;        // track of the note-on
+      int    index;        // index of the note-on in its event list
+      int    channel;      // 0-15
+      int    key;          // MIDI key number
+      int    velocity;     // note-on velocity
+};
+
+
+class _NoteIndexNode {
+   public:
+      int    centertick;   // every note at the node sounds here
+      double centertime;   // the same point in seconds
+      int    left;         // notes ending at or before center (-1 = none)
+      int    right;        // notes starting after center (-1 = none)
+      int    first;        // start of the node's notes in bystart/byend
+      int    count;        // number of notes at the node
+};
+
+
+class MidiNoteIndex {
+   public:
+                  MidiNoteIndex         (void);
+                  MidiNoteIndex         (MidiFile& midifile,
+                                         int channel = -1);
+                 ~MidiNoteIndex         ();
+
+      int         build                 (MidiFile& midifile,
+                                         int channel = -1);
+      void        clear                 (void);
+
+      int         size                  (void) const;
+      int         getNoteCount          (void) const;
+      const MidiNoteSpan& operator[]    (int index) const;
+      const MidiNoteSpan& getNote       (int index) const;
+
+      // stabbing queries:
+      int         getNotesAtTick        (int tick,
+                                         vector<int>& notes) const;
+      int         getNotesAtTime        (double seconds,
+                                         vector<int>& notes) const;
+
+      // range queries (start inclusive, end exclusive):
+      int         getNotesInTicks       (int starttick, int endtick,
+                                         vector<int>& notes) const;
+      int         getNotesInTime        (double starttime, double endtime,
+                                         vector<int>& notes) const;
+
+   private:
+      vector<MidiNoteSpan>   spans;      // sorted by start, then end
+      vector<_NoteIndexNode> nodes;      // centered interval tree
+      vector<int>            bystart;    // node notes by ascending start
+      vector<int>            byend;      // node notes by descending end
+      int                    root;
+
+      int         buildNode             (vector<int>& items);
+      void        stab                  (double point, int timeQ,
+                                         vector<int>& notes) const;
+      void        overlap               (int node, double start, double end,
+                                         int timeQ, vector<int>& notes) const;
+      double      getStart              (int note, int timeQ) const;
+      double      getEnd                (int note, int timeQ) const;
+      double      getCenter             (int node, int timeQ) const;
+};
+
+
+#endif /* _MIDINOTEINDEX_H_INCLUDED */
+
+
+
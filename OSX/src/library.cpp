@@ -0,0 +1,266 @@
+/**
+ * File: library.cpp
+ * -----------------
+ * Keeps a tab separated index of the
+ * songs in a folder. Rescans compare
+ * size and modification time against
+ * the index and only open new or changed
+ * files, spread over worker threads.
+ */
+
+#include "library.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "song.h"
+#include "MIDI/MidiFile.h"
+using namespace std;
+
+// first line of every index file
+static const string LIBRARY_HEADER("# LaptopAccordion library 1");
+
+/**
+ * Function: load
+ * --------------
+ * Reads an index written by save. A
+ * missing or foreign file just leaves
+ * the library empty.
+ */
+bool Library::load(const string& indexName) {
+  songs.clear();
+  ifstream input(indexName.c_str());
+  if (!input.is_open()) return false;
+
+  string line;
+  if (!getline(input, line) || line != LIBRARY_HEADER) return false;
+
+  while (getline(input, line)) {
+    // path is the only field that may hold spaces
+    size_t tab = line.find('\t');
+    if (tab == string::npos) continue;
+
+    SongInfo info;
+    info.path = line.substr(0, tab);
+    istringstream fields(line.substr(tab + 1));
+    fields >> info.size >> info.mtime >> hex >> info.hash >> dec >> info.duration
+      >> info.chordCount >> info.lowNote >> info.highNote >> info.trackCount;
+
+    if (fields) songs.push_back(info);
+  }
+
+  return true;
+}
+
+/**
+ * Function: save
+ * --------------
+ * Writes one line per song.
+ */
+bool Library::save(const string& indexName) const {
+  ofstream output(indexName.c_str(), ios::trunc);
+  if (!output.is_open()) return false;
+
+  output << LIBRARY_HEADER << "\n" << setprecision(9);
+  for (int i = 0; i < (int) songs.size(); i += 1) {
+    const SongInfo& info = songs[i];
+    output << info.path << "\t" << info.size << "\t" << info.mtime << "\t"
+      << hex << info.hash << dec << "\t" << info.duration << "\t" << info.chordCount << "\t"
+      << info.lowNote << "\t" << info.highNote << "\t" << info.trackCount << "\n";
+  }
+
+  output.close();
+  return !output.fail();
+}
+
+/**
+ * Function: scan
+ * --------------
+ * Lists the MIDI files in a folder and
+ * refreshes their entries. Unchanged
+ * files are never opened, and songs no
+ * longer in the folder are dropped.
+ */
+int Library::scan(const string& dirName, int threads) {
+  DIR *dir; struct dirent *ent;
+  if ((dir = opendir(dirName.c_str())) == NULL) return -1;
+
+  // index the entries we already know
+  map<string, int> known;
+  for (int i = 0; i < (int) songs.size(); i += 1)
+    known[songs[i].path] = i;
+
+  vector<SongInfo> found;
+  vector<int> previous; // index into songs or -1
+  vector<int> changed; // index into found
+
+  while ((ent = readdir(dir)) != NULL) {
+    char* name = ent -> d_name;
+    size_t len = strlen(name);
+    if (len <= 4 || strcmp(name + len - 4, ".mid") != 0) continue;
+
+    SongInfo info;
+    info.path = dirName + "/" + name;
+    struct stat status;
+    if (stat(info.path.c_str(), &status) != 0) continue;
+    info.size = status.st_size;
+    info.mtime = status.st_mtime;
+
+    map<string, int>::iterator it = known.find(info.path);
+    int old = (it == known.end()) ? -1 : it -> second;
+
+    if (old >= 0 && songs[old].size == info.size && songs[old].mtime == info.mtime)
+      info = songs[old]; // untouched since the last scan
+    else changed.push_back(found.size());
+
+    found.push_back(info);
+    previous.push_back(old);
+  }
+
+  closedir(dir);
+
+  // examine changed files in parallel
+  if (threads <= 0) threads = thread::hardware_concurrency();
+  if (threads > (int) changed.size()) threads = (int) changed.size();
+  atomic<int> next(0);
+
+  auto work = [&]() {
+    for (int i = next++; i < (int) changed.size(); i = next++) {
+      int index = changed[i];
+      examine(found[index], previous[index] < 0 ? NULL : &songs[previous[index]]);
+    }
+  };
+
+  vector<thread> workers;
+  for (int i = 1; i < threads; i += 1)
+    workers.push_back(thread(work));
+  work(); // this thread helps too
+
+  for (int i = 0; i < (int) workers.size(); i += 1)
+    workers[i].join();
+
+  // keep a stable order between runs
+  songs.swap(found);
+  sortSongs(SONG_PATH);
+  return changed.size();
+}
+
+/**
+ * Function: examine
+ * -----------------
+ * Hashes a song and pulls metadata out
+ * of it. A song whose bytes match the
+ * previous entry keeps the old metadata
+ * and is not parsed again.
+ */
+bool Library::examine(SongInfo& info, const SongInfo* previous) {
+  info.hash = 0;
+  info.duration = 0.0;
+  info.chordCount = 0;
+  info.lowNote = 0;
+  info.highNote = 0;
+  info.trackCount = 0;
+
+  _MappedFile source(info.path.c_str());
+  if (!source.isOpen()) return false;
+  info.hash = Song::hashBytes(source.data(), source.size());
+
+  // only the timestamp moved
+  if (previous && previous -> hash == info.hash && previous -> size == info.size) {
+    info.duration = previous -> duration;
+    info.chordCount = previous -> chordCount;
+    info.lowNote = previous -> lowNote;
+    info.highNote = previous -> highNote;
+    info.trackCount = previous -> trackCount;
+    return true;
+  }
+
+  MidiFile songMIDI; // from Midifile library
+  if (!songMIDI.read(source.data(), source.size())) return false;
+
+  info.trackCount = songMIDI.getTrackCount();
+  songMIDI.doTimeAnalysis();
+  info.duration = songMIDI.getTotalTimeInSeconds();
+  songMIDI.joinTracks();
+
+  // chords are grouped by tick the same way songs are
+  int deltaTick = -1;
+  info.lowNote = 127;
+  info.highNote = 0;
+
+  MidiEventList& events = songMIDI[0];
+  for (int evIdx = 0; evIdx < events.size(); evIdx += 1) {
+    MidiEvent* event = &events[evIdx];
+    if (!event -> isNoteOn()) continue;
+
+    if (event -> tick != deltaTick) {
+      deltaTick = event -> tick;
+      info.chordCount += 1;
+    }
+
+    int note = (*event)[1];
+    info.lowNote = min(info.lowNote, note);
+    info.highNote = max(info.highNote, note);
+  }
+
+  // no notes at all
+  if (!info.chordCount) info.lowNote = 0;
+  return true;
+}
+
+/**
+ * Function: sortSongs
+ * -------------------
+ * Orders the library by a metadata
+ * field, breaking ties by path.
+ */
+void Library::sortSongs(SongField field, bool descending) {
+  stable_sort(songs.begin(), songs.end(),
+    [field, descending](const SongInfo& a, const SongInfo& b) {
+      const SongInfo& x = descending ? b : a;
+      const SongInfo& y = descending ? a : b;
+
+      switch (field) {
+        case SONG_DURATION: if (x.duration != y.duration) return x.duration < y.duration; break;
+        case SONG_CHORDS: if (x.chordCount != y.chordCount) return x.chordCount < y.chordCount; break;
+        case SONG_LOW_NOTE: if (x.lowNote != y.lowNote) return x.lowNote < y.lowNote; break;
+        case SONG_HIGH_NOTE: if (x.highNote != y.highNote) return x.highNote < y.highNote; break;
+        case SONG_TRACKS: if (x.trackCount != y.trackCount) return x.trackCount < y.trackCount; break;
+        default: break;
+      }
+
+      return x.path < y.path;
+    });
+}
+
+/**
+ * Function: getPaths
+ * ------------------
+ * Lists song paths in library order.
+ */
+void Library::getPaths(vector<string>& list) const {
+  list.clear();
+  for (int i = 0; i < (int) songs.size(); i += 1)
+    list.push_back(songs[i].path);
+}
+
+/**
+ * Function: getPaths
+ * ------------------
+ * Lists the paths of songs which
+ * pass the given filter.
+ */
+void Library::getPaths(vector<string>& list, bool (*keep)(const SongInfo&)) const {
+  list.clear();
+  for (int i = 0; i < (int) songs.size(); i += 1)
+    if (keep(songs[i])) list.push_back(songs[i].path);
+}
@@ -10,109 +10,10 @@
 #include "ofApp.h"
 #include <sstream>
 #include <math.h>
-#include <dirent.h>
-#include "MIDI/MidiFile.h"
 
 using namespace ofxCv;
 using namespace cv;
 
-/**
- * Function: getMIDIFiles
- * ----------------------
- * Gets the MIDI files in a directory
- */
-bool getMIDIFiles(vector<string>& list, string dirName) {
-  DIR *dir; struct dirent *ent;
-  // ugly shit that looks like C code
-  if ((dir = opendir(dirName.c_str())) != NULL) {
-    while ((ent = readdir(dir)) != NULL) {
-      char* name = ent -> d_name;
-      size_t len = strlen(name);
-
-      if (len > 4 && strcmp(name + len - 4, ".mid") == 0)
-        list.push_back(dirName + "/" + name); // add MIDI to list
-    }
-
-    // clean up
-    closedir(dir);
-    return true;
-  }
-
-  // could not open
-  return false;
-}
-
-/**
- * Function: buildSongVector
- * -------------------------
- * Builds a vector of vectors representing
- * all of the notes in a song. Each inner
- * vector represents notes played at a
- * particular time together.
- */
-void buildSongVector(vector<vector<Note>>& song, vector<char>& songKeys,
-  vector<Note>& topNotes, string fileName) {
-  MidiFile songMIDI; // from Midifile library
-  songMIDI.read(fileName);
-
-  songMIDI.linkNotePairs();
-  songMIDI.doTimeAnalysis();
-  songMIDI.joinTracks();
-
-  MidiEvent* event;
-  int simulIndex = -1;
-  song.clear(); // empty old song
-  int deltaTick = -1;
-
-  // iterate through list of note on events and add them to song
-  for (int evIdx = 0; evIdx < songMIDI[0].size(); evIdx += 1) {
-    event = &songMIDI[0][evIdx];
-    if (!event -> isNoteOn()) continue;
-
-    if (event -> tick != deltaTick) {
-      deltaTick = event -> tick;
-      song.push_back(vector<Note>());
-      simulIndex += 1;
-    }
-
-    Note newNote;
-    newNote.note = (int) (*event)[1];
-    newNote.duration = event -> getDurationInSeconds();
-    song[simulIndex].push_back(newNote);
-  }
-
-  if (song.size() == 0) return; // empty
-  string hardKeys("fghj"); // six notes guitar hero style
-  Note lastNote = *max_element(song[0].begin(), song[0].end());
-  int lastKeyIndex = 3; // corresponds to j
-  songKeys.push_back(hardKeys[lastKeyIndex]);
-  topNotes.push_back(lastNote);
-
-  // determine hard mode key mappings [jank]
-  for (int i = 1; i < song.size(); i += 1) {
-    Note currNote = *max_element(song[i].begin(), song[i].end());
-    int diff = currNote.note - lastNote.note; // determines key interval
-
-    int nextKeyIndex;
-    if (diff == 0) nextKeyIndex = lastKeyIndex; // same note
-    else if (diff > 0 && diff < 3) nextKeyIndex = (lastKeyIndex + 1) % hardKeys.size();
-    else if (diff > 2 && diff < 5) nextKeyIndex = (lastKeyIndex + 2) % hardKeys.size();
-    else if (diff < 0 && diff > -3) nextKeyIndex = (lastKeyIndex - 1) % hardKeys.size();
-    else if (diff < -2 && diff > -5) nextKeyIndex = (lastKeyIndex - 2) % hardKeys.size();
-    else if (diff > 4) nextKeyIndex = (lastKeyIndex + 3) % hardKeys.size();
-    else nextKeyIndex = (lastKeyIndex - 3) % hardKeys.size();
-
-    // normalize negative mods to positive before append
-    if (nextKeyIndex < 0) nextKeyIndex += hardKeys.size();
-    songKeys.push_back(hardKeys[nextKeyIndex]);
-    topNotes.push_back(currNote);
-
-    // update last values
-    lastNote = currNote;
-    lastKeyIndex = nextKeyIndex;
-  }
-}
-
 /**
  * Function: setup
  * ---------------
@@ -136,8 +37,16 @@ void ofApp::setup() {
   mapper.init(prefix + "scales.txt", prefix + "modes.txt");
   bMapper.init(prefix + "basses.txt");
 
-  if (getMIDIFiles(filesMIDI, prefix + "MIDI"))
+  // only new or edited songs get opened
+  library.load(prefix + "library.txt");
+  if (library.scan(prefix + "MIDI") >= 0) {
+    library.save(prefix + "library.txt");
+    library.getPaths(filesMIDI);
     loadedMIDI = true; // successful load
+  }
+
+  // start building the first songs
+  loader.select(filesMIDI, filesIndex);
 
   // get UI listing variables
   scales = mapper.getScales();
@@ -146,7 +55,7 @@ void ofApp::setup() {
 
   // initialize synthesizer
   synth = new Synthesizer();
-  synth -> init(44100, 256, 3.0, true);
+  synth -> init(44100, 256, 3.0, true, true); // queued if the driver allows
   synth -> load((prefix + "primary.sf2").c_str());
 
   // load MIDI instrument number from file
@@ -555,21 +464,18 @@ void ofApp::keyPressed(int key) {
         return; // wrong key played
 
       keyPosMap[key] = songPosition; // turn off shit by the key
-      for (int i = 0; i < song[songPosition].size(); i += 1) {
-        int note = song[songPosition][i].note;
-        synth -> noteOn(1, note, 127);
-      }
+      synth -> noteOnBatch(1, song.getNotes(songPosition), song.chordSize(songPosition), 127);
 
       // colorings
       if (hardMode) {
         previews.clear();
-        if (songPosition + 1 < song.size()) highlight = songKeys[songPosition + 1];
-        if (songPosition + 2 < song.size()) previews.push_back(songKeys[songPosition + 2]);
-        if (songPosition + 3 < song.size()) previews.push_back(songKeys[songPosition + 3]);
-        if (songPosition + 4 < song.size()) previews.push_back(songKeys[songPosition + 4]);
-        if (songPosition + 5 < song.size()) previews.push_back(songKeys[songPosition + 5]);
-        if (songPosition + 6 < song.size()) previews.push_back(songKeys[songPosition + 6]);
-        if (songPosition + 7 < song.size()) previews.push_back(songKeys[songPosition + 7]);
+        if (songPosition + 1 < song.size()) highlight = song.getKey(songPosition + 1);
+        if (songPosition + 2 < song.size()) previews.push_back(song.getKey(songPosition + 2));
+        if (songPosition + 3 < song.size()) previews.push_back(song.getKey(songPosition + 3));
+        if (songPosition + 4 < song.size()) previews.push_back(song.getKey(songPosition + 4));
+        if (songPosition + 5 < song.size()) previews.push_back(song.getKey(songPosition + 5));
+        if (songPosition + 6 < song.size()) previews.push_back(song.getKey(songPosition + 6));
+        if (songPosition + 7 < song.size()) previews.push_back(song.getKey(songPosition + 7));
       }
 
       // move to next
@@ -610,6 +516,7 @@ void ofApp::keyPressed(int key) {
     key == ',' || key == '-' || key == '.' ||
     key == ';' || key == '[' || key == '=')) {
     vector<int> notes = bMapper.getNotes(key);
+    vector<int> starting; // sounded together
     bool foundPlaying = false; // avoid retrigger
 
     // play each of the bass notes
@@ -620,11 +527,13 @@ void ofApp::keyPressed(int key) {
       }
 
       // note is not already playing: turn it on
-      synth -> noteOn(1, notes[i], 127);
+      starting.push_back(notes[i]);
       playing.insert(notes[i]);
       pressed.insert(key);
     }
 
+    synth -> noteOnBatch(1, starting.data(), starting.size(), 127);
+
     if (foundPlaying) return; // TODO: remove?
     // hell mode activation by key frequency
     long long thisPress = ofGetElapsedTimeMillis();
@@ -684,8 +593,8 @@ void ofApp::keyPressed(int key) {
     playThrough = true;
     songPosition = 0;
 
-    // calculate note lengths and positions
-    buildSongVector(song, songKeys, topNotes, filesMIDI[filesIndex]);
+    // usually already built in the background
+    loader.take(filesMIDI[filesIndex], song);
 
     // bad song passed
     if (!song.size()) {
@@ -696,13 +605,13 @@ void ofApp::keyPressed(int key) {
     // highlights
     if (hardMode) {
       previews.clear();
-      if (song.size() > 0) highlight = songKeys[0];
-      if (song.size() > 1) previews.push_back(songKeys[1]);
-      if (song.size() > 2) previews.push_back(songKeys[2]);
-      if (song.size() > 3) previews.push_back(songKeys[3]);
-      if (song.size() > 4) previews.push_back(songKeys[4]);
-      if (song.size() > 5) previews.push_back(songKeys[5]);
-      if (song.size() > 6) previews.push_back(songKeys[6]);
+      if (song.size() > 0) highlight = song.getKey(0);
+      if (song.size() > 1) previews.push_back(song.getKey(1));
+      if (song.size() > 2) previews.push_back(song.getKey(2));
+      if (song.size() > 3) previews.push_back(song.getKey(3));
+      if (song.size() > 4) previews.push_back(song.getKey(4));
+      if (song.size() > 5) previews.push_back(song.getKey(5));
+      if (song.size() > 6) previews.push_back(song.getKey(6));
     }
   }
 
@@ -715,7 +624,10 @@ void ofApp::keyPressed(int key) {
   if (key == '\'') mapper.setModeIndex(modeIndex = ++modeIndex % modes.size());
 
   // change the selected song in directory with - when not in playthrough mode
-  if (key == '-' && !playThrough && !bassMode) filesIndex = ++filesIndex % filesMIDI.size();
+  if (key == '-' && !playThrough && !bassMode && filesMIDI.size()) {
+    filesIndex = ++filesIndex % filesMIDI.size();
+    loader.select(filesMIDI, filesIndex);
+  }
 
   // press 9 for skeumorphism
   if (key == '9' && !bassMode) skeumorph = !skeumorph;
@@ -779,10 +691,9 @@ void ofApp::keyReleased(int key) {
       }
 
       // turn off all notes in the time vector for the given key
-      for (int i = 0; i < song[keyPosMap[key]].size(); i += 1) {
-        int note = song[keyPosMap[key]][i].note;
-        synth -> noteOff(1, note);
-      }
+      int chord = keyPosMap[key];
+      if (!synth -> noteOffBatch(1, song.getNotes(chord), song.chordSize(chord)))
+        synth -> allNotesOff(1); // never leave a chord stuck
 
       // remove the key from map
       pressed.erase(key);
@@ -805,16 +716,20 @@ void ofApp::keyReleased(int key) {
     key == ',' || key == '-' || key == '.' ||
     key == ';' || key == '[' || key == '=')) {
     vector<int> notes = bMapper.getNotes(key);
+    vector<int> stopping; // released together
 
     // stop each of the bass notes
     for (size_t i = 0; i < notes.size(); i += 1) {
       if (!playing.count(notes[i])) continue;
 
       // note is playing: turn it off
-      synth -> noteOff(1, notes[i]);
+      stopping.push_back(notes[i]);
       playing.erase(notes[i]);
       pressed.erase(key);
     }
+
+    if (!synth -> noteOffBatch(1, stopping.data(), stopping.size()))
+      synth -> allNotesOff(1); // never leave a chord stuck
   }
 }
 
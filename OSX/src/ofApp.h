@@ -15,25 +15,8 @@
 #include "mapper.h"
 #include "bassMapper.h"
 #include "synthesizer.h"
-
-/**
- * Type: Note
- * ----------
- * A simple struct to hold
- * notes derived from MIDI.
- */
-struct Note {
-  int note;
-  // in seconds
-  double duration;
-
-  // comparison functions for algorithms
-  bool operator>(const Note& n) const { return note > n.note; }
-  bool operator>=(const Note& n) const { return note >= n.note; }
-  bool operator==(const Note& n) const { return note == n.note; }
-  bool operator<=(const Note& n) const { return note <= n.note; }
-  bool operator<(const Note& n) const { return note < n.note; }
-};
+#include "songLoader.h"
+#include "library.h"
 
 // master OpenFrameworks runner
 class ofApp : public ofBaseApp {
@@ -71,6 +54,7 @@ class ofApp : public ofBaseApp {
     BassMapper bMapper;
 
     // play through files
+    Library library;
     vector<string> filesMIDI;
     bool loadedMIDI = false;
     bool playThrough = false;
@@ -79,10 +63,10 @@ class ofApp : public ofBaseApp {
     int songPosition = 0;
     map<int, int> keyPosMap;
 
-    // built for every file
-    vector<vector<Note>> song;
-    vector<Note> topNotes;
-    vector<char> songKeys;
+    // compiled for every file
+    // and prefetched in order
+    SongLoader loader;
+    Song song;
 
     // hard mode coloring
     vector<int> previews;
@@ -0,0 +1,378 @@
+/**
+ * File: song.cpp
+ * --------------
+ * Compiles MIDI files into flat chord
+ * arrays and keeps a cached copy of
+ * the result next to each source file.
+ * The cache is keyed by a hash of the
+ * MIDI bytes, so an edited file gets
+ * recompiled on its next load.
+ */
+
+#include "song.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "MIDI/MidiFile.h"
+using namespace std;
+
+// bump when the layout changes
+static const uint32_t SONG_VERSION = 1;
+
+/**
+ * Function: getLayout
+ * -------------------
+ * Computes the byte offsets of each
+ * array in a compiled song and returns
+ * the total size of the file.
+ */
+static size_t getLayout(uint32_t chords, uint32_t notes, size_t* starts) {
+  starts[0] = sizeof(SongHeader); // durations
+  starts[1] = starts[0] + sizeof(double) * notes; // offsets
+  starts[2] = starts[1] + sizeof(uint32_t) * (chords + 1); // notes
+  starts[3] = starts[2] + sizeof(int32_t) * notes; // top notes
+  starts[4] = starts[3] + sizeof(int32_t) * chords; // keys
+  return starts[4] + chords;
+}
+
+/**
+ * Constructor: Song
+ * -----------------
+ * Starts out as an empty song.
+ */
+Song::Song() : mapped(NULL) {
+  clear();
+}
+
+/**
+ * Destructor: Song
+ * ----------------
+ * Releases the cache mapping.
+ */
+Song::~Song() {
+  delete mapped;
+}
+
+/**
+ * Constructor: Song
+ * -----------------
+ * Takes over the storage of another
+ * song. The views stay valid since
+ * neither storage kind moves.
+ */
+Song::Song(Song&& other) : mapped(NULL) {
+  clear();
+  *this = std::move(other);
+}
+
+/**
+ * Function: operator=
+ * -------------------
+ * Swaps storage and views with
+ * another song.
+ */
+Song& Song::operator=(Song&& other) {
+  if (this == &other) return *this;
+
+  swap(mapped, other.mapped);
+  buffer.swap(other.buffer);
+  swap(chordCount, other.chordCount);
+  swap(noteCount, other.noteCount);
+  swap(durations, other.durations);
+  swap(offsets, other.offsets);
+  swap(notes, other.notes);
+  swap(topNotes, other.topNotes);
+  swap(keys, other.keys);
+
+  other.clear();
+  return *this;
+}
+
+/**
+ * Function: clear
+ * ---------------
+ * Drops the current song.
+ */
+void Song::clear() {
+  delete mapped;
+  mapped = NULL;
+  buffer.clear();
+
+  // a lone offset keeps chordSize sane
+  static const uint32_t emptyOffsets[1] = {0};
+  chordCount = 0;
+  noteCount = 0;
+  durations = NULL;
+  offsets = emptyOffsets;
+  notes = NULL;
+  topNotes = NULL;
+  keys = NULL;
+}
+
+/**
+ * Function: getTopNote
+ * --------------------
+ * Gets the highest note of a chord.
+ */
+Note Song::getTopNote(int chord) const {
+  Note top;
+  top.note = notes[topNotes[chord]];
+  top.duration = durations[topNotes[chord]];
+  return top;
+}
+
+/**
+ * Function: getCacheName
+ * ----------------------
+ * Names the compiled song which
+ * sits next to a MIDI file.
+ */
+string Song::getCacheName(const string& fileName) {
+  return fileName + ".song";
+}
+
+/**
+ * Function: hashBytes
+ * -------------------
+ * 64-bit FNV-1a hash of a buffer,
+ * used to spot changed MIDI files.
+ */
+uint64_t Song::hashBytes(const unsigned char* data, size_t length) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < length; i += 1) {
+    hash ^= data[i];
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+/**
+ * Function: load
+ * --------------
+ * Loads a song from a MIDI file. A
+ * matching compiled song is mapped
+ * directly, otherwise the MIDI file
+ * is parsed and the cache rewritten.
+ */
+bool Song::load(const string& fileName) {
+  clear();
+
+  _MappedFile source(fileName.c_str());
+  if (!source.isOpen()) return false;
+  uint64_t hash = hashBytes(source.data(), source.size());
+
+  // try the compiled copy first
+  _MappedFile* cache = new _MappedFile(getCacheName(fileName).c_str());
+  if (cache -> isOpen() && attach(cache -> data(), cache -> size(), hash, source.size())) {
+    mapped = cache;
+    return true;
+  }
+
+  delete cache;
+  if (!compile(source.data(), source.size(), hash)) return false;
+  save(fileName); // a read-only folder is still usable
+  return true;
+}
+
+/**
+ * Function: save
+ * --------------
+ * Writes the compiled song next to
+ * its MIDI file. A temporary is written
+ * first so a reader never sees half a
+ * file.
+ */
+bool Song::save(const string& fileName) const {
+  if (buffer.empty()) return false; // mapped songs are already saved
+
+  string cacheName = getCacheName(fileName);
+  string tempName = cacheName + ".tmp";
+  ofstream output(tempName.c_str(), ios::binary | ios::trunc);
+  if (!output.is_open()) return false;
+
+  output.write((const char*) buffer.data(), buffer.size());
+  output.close();
+  if (!output) {
+    remove(tempName.c_str());
+    return false;
+  }
+
+#ifdef _WIN32
+  remove(cacheName.c_str()); // rename does not replace on Windows
+#endif
+  if (rename(tempName.c_str(), cacheName.c_str()) != 0) {
+    cerr << "Could not write song cache " << cacheName << "." << endl;
+    remove(tempName.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Function: build
+ * ---------------
+ * Parses a MIDI file without going
+ * through the cache.
+ */
+bool Song::build(const string& fileName) {
+  clear();
+
+  _MappedFile source(fileName.c_str());
+  if (!source.isOpen()) return false;
+
+  uint64_t hash = hashBytes(source.data(), source.size());
+  return compile(source.data(), source.size(), hash);
+}
+
+/**
+ * Function: attach
+ * ----------------
+ * Points the views at a compiled song
+ * after checking it belongs to the
+ * given source and is complete.
+ */
+bool Song::attach(const unsigned char* data, size_t length,
+  uint64_t sourceHash, uint64_t sourceSize) {
+  if (length < sizeof(SongHeader)) return false;
+
+  SongHeader header;
+  memcpy(&header, data, sizeof(SongHeader));
+  if (memcmp(header.magic, "LASG", 4) != 0) return false;
+  if (header.version != SONG_VERSION) return false;
+  if (header.sourceHash != sourceHash) return false;
+  if (header.sourceSize != sourceSize) return false;
+
+  size_t starts[5];
+  if (header.chordCount > header.noteCount) return false;
+  if (getLayout(header.chordCount, header.noteCount, starts) != length) return false;
+
+  const uint32_t* chordOffsets = (const uint32_t*) (data + starts[1]);
+  if (chordOffsets[0] != 0 || chordOffsets[header.chordCount] != header.noteCount)
+    return false; // truncated or stale arrays
+
+  chordCount = header.chordCount;
+  noteCount = header.noteCount;
+  durations = (const double*) (data + starts[0]);
+  offsets = chordOffsets;
+  notes = (const int32_t*) (data + starts[2]);
+  topNotes = (const int32_t*) (data + starts[3]);
+  keys = (const char*) (data + starts[4]);
+  return true;
+}
+
+/**
+ * Function: compile
+ * -----------------
+ * Groups the note ons of a MIDI file
+ * into chords by tick and assigns the
+ * hard mode keys, producing the same
+ * bytes that get written to the cache.
+ */
+bool Song::compile(const unsigned char* data, size_t length, uint64_t sourceHash) {
+  MidiFile songMIDI; // from Midifile library
+  if (!songMIDI.read(data, length)) return false;
+
+  songMIDI.linkNotePairs();
+  songMIDI.doTimeAnalysis();
+  return compile(songMIDI, sourceHash, length);
+}
+
+/**
+ * Function: compile
+ * -----------------
+ * Compiles an already parsed MIDI file
+ * whose notes are linked and whose times
+ * are analyzed. Its tracks get joined.
+ */
+bool Song::compile(MidiFile& songMIDI, uint64_t sourceHash, uint64_t sourceSize) {
+  clear();
+  songMIDI.joinTracks();
+
+  vector<uint32_t> chordOffsets;
+  vector<int32_t> chordNotes;
+  vector<double> chordDurations;
+  int deltaTick = -1;
+
+  // iterate through list of note on events and add them to song
+  MidiEventList& events = songMIDI[0];
+  for (int evIdx = 0; evIdx < events.size(); evIdx += 1) {
+    MidiEvent* event = &events[evIdx];
+    if (!event -> isNoteOn()) continue;
+
+    if (event -> tick != deltaTick) {
+      deltaTick = event -> tick;
+      chordOffsets.push_back(chordNotes.size());
+    }
+
+    chordNotes.push_back((int) (*event)[1]);
+    chordDurations.push_back(event -> getDurationInSeconds());
+  }
+
+  uint32_t chords = chordOffsets.size();
+  uint32_t total = chordNotes.size();
+  chordOffsets.push_back(total);
+
+  vector<int32_t> chordTops(chords);
+  vector<char> chordKeys(chords);
+  string hardKeys("fghj"); // six notes guitar hero style
+  int lastNote = 0;
+  int lastKeyIndex = 3; // corresponds to j
+
+  // determine hard mode key mappings [jank]
+  for (uint32_t i = 0; i < chords; i += 1) {
+    const int32_t* first = &chordNotes[0] + chordOffsets[i];
+    const int32_t* last = &chordNotes[0] + chordOffsets[i + 1];
+    chordTops[i] = max_element(first, last) - &chordNotes[0];
+
+    int currNote = chordNotes[chordTops[i]];
+    int diff = currNote - lastNote; // determines key interval
+
+    int nextKeyIndex;
+    if (i == 0) nextKeyIndex = lastKeyIndex; // first chord always on j
+    else if (diff == 0) nextKeyIndex = lastKeyIndex; // same note
+    else if (diff > 0 && diff < 3) nextKeyIndex = (lastKeyIndex + 1) % hardKeys.size();
+    else if (diff > 2 && diff < 5) nextKeyIndex = (lastKeyIndex + 2) % hardKeys.size();
+    else if (diff < 0 && diff > -3) nextKeyIndex = (lastKeyIndex - 1) % hardKeys.size();
+    else if (diff < -2 && diff > -5) nextKeyIndex = (lastKeyIndex - 2) % hardKeys.size();
+    else if (diff > 4) nextKeyIndex = (lastKeyIndex + 3) % hardKeys.size();
+    else nextKeyIndex = (lastKeyIndex - 3) % hardKeys.size();
+
+    // normalize negative mods to positive before append
+    if (nextKeyIndex < 0) nextKeyIndex += hardKeys.size();
+    chordKeys[i] = hardKeys[nextKeyIndex];
+
+    // update last values
+    lastNote = currNote;
+    lastKeyIndex = nextKeyIndex;
+  }
+
+  // lay the arrays out exactly as the cache file does
+  size_t starts[5];
+  buffer.assign(getLayout(chords, total, starts), 0);
+
+  SongHeader header;
+  memcpy(header.magic, "LASG", 4);
+  header.version = SONG_VERSION;
+  header.sourceHash = sourceHash;
+  header.sourceSize = sourceSize;
+  header.chordCount = chords;
+  header.noteCount = total;
+  memcpy(&buffer[0], &header, sizeof(SongHeader));
+
+  if (total) {
+    memcpy(&buffer[starts[0]], &chordDurations[0], sizeof(double) * total);
+    memcpy(&buffer[starts[2]], &chordNotes[0], sizeof(int32_t) * total);
+  }
+
+  memcpy(&buffer[starts[1]], &chordOffsets[0], sizeof(uint32_t) * (chords + 1));
+  if (chords) {
+    memcpy(&buffer[starts[3]], &chordTops[0], sizeof(int32_t) * chords);
+    memcpy(&buffer[starts[4]], &chordKeys[0], chords);
+  }
+
+  return attach(buffer.data(), buffer.size(), sourceHash, sourceSize);
+}
@@ -0,0 +1,108 @@
+/**
+ * File: song.h
+ * ------------
+ * A play-through song compiled from
+ * a MIDI file. Chords are stored in
+ * flat arrays that are cached on disk
+ * next to the source file and mapped
+ * back into memory on later loads.
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+class _MappedFile;
+class MidiFile;
+
+/**
+ * Type: Note
+ * ----------
+ * A simple struct to hold
+ * notes derived from MIDI.
+ */
+struct Note {
+  int note;
+  // in seconds
+  double duration;
+
+  // comparison functions for algorithms
+  bool operator>(const Note& n) const { return note > n.note; }
+  bool operator>=(const Note& n) const { return note >= n.note; }
+  bool operator==(const Note& n) const { return note == n.note; }
+  bool operator<=(const Note& n) const { return note <= n.note; }
+  bool operator<(const Note& n) const { return note < n.note; }
+};
+
+/**
+ * Type: SongHeader
+ * ----------------
+ * Leading block of a compiled song
+ * file. The arrays follow it in the
+ * order durations, chord offsets,
+ * notes, top notes and hard keys.
+ */
+struct SongHeader {
+  char magic[4]; // always "LASG"
+  uint32_t version;
+  uint64_t sourceHash;
+  uint64_t sourceSize;
+  uint32_t chordCount;
+  uint32_t noteCount;
+};
+
+// chords of a song
+class Song {
+  public:
+    Song();
+    ~Song();
+    Song(Song&& other);
+    Song& operator=(Song&& other);
+
+    // loads through the cache
+    bool load(const string& fileName);
+    bool build(const string& fileName);
+    bool save(const string& fileName) const;
+    void clear();
+
+    // from a parsed, linked and analyzed file
+    bool compile(MidiFile& songMIDI, uint64_t sourceHash, uint64_t sourceSize);
+
+    // chord accessors
+    int size() const { return chordCount; }
+    int chordSize(int chord) const { return offsets[chord + 1] - offsets[chord]; }
+    int getNote(int chord, int index) const { return notes[offsets[chord] + index]; }
+    const int32_t* getNotes(int chord) const { return notes + offsets[chord]; }
+    double getDuration(int chord, int index) const { return durations[offsets[chord] + index]; }
+    Note getTopNote(int chord) const;
+    char getKey(int chord) const { return keys[chord]; }
+
+    // helpers for the cache file
+    static string getCacheName(const string& fileName);
+    static uint64_t hashBytes(const unsigned char* data, size_t length);
+
+  private:
+    // storage is either mapped or owned
+    _MappedFile* mapped;
+    vector<unsigned char> buffer;
+
+    // views into the storage
+    int chordCount;
+    int noteCount;
+    const double* durations;
+    const uint32_t* offsets;
+    const int32_t* notes;
+    const int32_t* topNotes;
+    const char* keys;
+
+    bool attach(const unsigned char* data, size_t length,
+      uint64_t sourceHash, uint64_t sourceSize);
+    bool compile(const unsigned char* data, size_t length, uint64_t sourceHash);
+
+    // songs are moved but not copied
+    Song(const Song& other);
+    Song& operator=(const Song& other);
+};
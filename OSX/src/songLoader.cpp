@@ -0,0 +1,139 @@
+/**
+ * File: songLoader.cpp
+ * --------------------
+ * A single worker thread that loads
+ * songs in selection order. Songs that
+ * fall out of the selection are dropped
+ * from the queue, and a build that is
+ * already running is thrown away once
+ * it finishes.
+ */
+
+#include "songLoader.h"
+#include <algorithm>
+using namespace std;
+
+/**
+ * Constructor: SongLoader
+ * -----------------------
+ * Starts the worker thread, which
+ * sleeps until something is selected.
+ */
+SongLoader::SongLoader() : stopping(false) {
+  worker = thread(&SongLoader::run, this);
+}
+
+/**
+ * Destructor: SongLoader
+ * ----------------------
+ * Stops the worker after any build
+ * it is in the middle of.
+ */
+SongLoader::~SongLoader() {
+  loaderLock.lock();
+  stopping = true;
+  pending.clear();
+  loaderLock.unlock();
+
+  wake.notify_all();
+  worker.join();
+}
+
+/**
+ * Function: select
+ * ----------------
+ * Makes the song at index and the next
+ * few after it the wanted set. Anything
+ * else queued or built is cancelled.
+ */
+void SongLoader::select(const vector<string>& files, int index, int lookahead) {
+  if (files.empty()) return;
+  unique_lock<mutex> lock(loaderLock);
+
+  wanted.clear();
+  pending.clear();
+
+  // the selected song goes to the front of the queue
+  for (int i = 0; i <= lookahead && i < (int) files.size(); i += 1) {
+    const string& fileName = files[(index + i) % files.size()];
+    if (!wanted.insert(fileName).second) continue;
+    if (ready.count(fileName) || fileName == building) continue;
+    pending.push_back(fileName);
+  }
+
+  // release songs nobody is going to play
+  for (map<string, Song>::iterator it = ready.begin(); it != ready.end(); ) {
+    if (wanted.count(it -> first)) ++it;
+    else ready.erase(it++);
+  }
+
+  lock.unlock();
+  wake.notify_one();
+}
+
+/**
+ * Function: take
+ * --------------
+ * Moves a built song into the caller's
+ * song. Waits if it is being built right
+ * now, and loads it in place if it was
+ * never queued.
+ */
+bool SongLoader::take(const string& fileName, Song& song) {
+  unique_lock<mutex> lock(loaderLock);
+  finished.wait(lock, [&] { return building != fileName; });
+
+  map<string, Song>::iterator it = ready.find(fileName);
+  if (it != ready.end()) {
+    song = std::move(it -> second);
+    ready.erase(it);
+    return song.size() > 0;
+  }
+
+  // not worth waiting in line for
+  pending.erase(remove(pending.begin(), pending.end(), fileName), pending.end());
+  lock.unlock();
+
+  return song.load(fileName) && song.size() > 0;
+}
+
+/**
+ * Function: isReady
+ * -----------------
+ * Whether a song can be taken
+ * without any waiting.
+ */
+bool SongLoader::isReady(const string& fileName) {
+  lock_guard<mutex> lock(loaderLock);
+  return ready.count(fileName) > 0;
+}
+
+/**
+ * Function: run
+ * -------------
+ * Worker loop. Loads happen without
+ * the lock held so select and take
+ * never wait on a parse they do not
+ * need.
+ */
+void SongLoader::run() {
+  unique_lock<mutex> lock(loaderLock);
+
+  while (true) {
+    wake.wait(lock, [&] { return stopping || !pending.empty(); });
+    if (stopping) break;
+
+    building = pending.front();
+    pending.pop_front();
+    lock.unlock();
+
+    Song song;
+    song.load(building);
+
+    // keep the result unless the selection moved on
+    lock.lock();
+    if (wanted.count(building)) ready[building] = std::move(song);
+    building.clear();
+    finished.notify_all();
+  }
+}
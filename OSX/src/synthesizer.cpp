@@ -7,16 +7,32 @@
  */
 
 #include "synthesizer.h"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <vector>
 using namespace std;
 
+/**
+ * Function: isRelease
+ * -------------------
+ * Note offs and channel mode messages
+ * [all sound or notes off] may use the
+ * ring's reserved slots.
+ */
+static bool isRelease(const SynthCommand& command) {
+  if (command.type == SYNTH_NOTE_OFF) return true;
+  return command.type == SYNTH_CONTROL && command.dataOne >= 120;
+}
+
 /**
  * Constructor: Synthesizer
  * ------------------------
  * Sets FluidSynth objects to NULL.
  */
 Synthesizer::Synthesizer()
-  : settings(NULL), synth(NULL), driver(NULL) {}
+  : settings(NULL), synth(NULL), driver(NULL), queued(false), rate(0),
+    renderedFrames(0), blockTime(0), blockLength(0) {}
 
 /**
  * Destructor: Synthesizer
@@ -27,10 +43,15 @@ Synthesizer::~Synthesizer() {
   // lock synth
   synthLock.lock();
 
-  // clean up FluidSynth objects
+  // clean up FluidSynth objects [driver
+  // first, it may still be rendering]
+  if (driver) delete_fluid_audio_driver(driver);
+
+  // borrowed fonts belong to their owner
+  for (int i = 0; i < (int) borrowed.size(); i += 1)
+    fluid_synth_remove_sfont(synth, borrowed[i]);
   if (synth) delete_fluid_synth(synth);
   if (settings) delete_fluid_settings(settings);
-  if (driver) delete_fluid_audio_driver(driver);
 
   synth = NULL;
   settings = NULL;
@@ -44,9 +65,13 @@ Synthesizer::~Synthesizer() {
  * Function: init
  * --------------
  * Sets synthesizer sampling rate
- * and max polyphony voices.
+ * and max polyphony voices. In queued
+ * mode the calls below never lock and
+ * must all come from one thread, and
+ * each lands in the audio at the same
+ * delay after the call was made.
  */
-bool Synthesizer::init(int rate, int polyphony, double gain, bool live) {
+bool Synthesizer::init(int rate, int polyphony, double gain, bool live, bool queued) {
   if (synth != NULL) {
     // avoid potential reinitialization of synth
     cerr << "Synthesizer already initialized." << endl;
@@ -74,16 +99,32 @@ bool Synthesizer::init(int rate, int polyphony, double gain, bool live) {
 
   // instantiate the synth
   synth = new_fluid_synth(settings);
+  this -> queued = queued;
+  this -> rate = rate;
+
+  // room for two blocks worth of commands
+  if (queued) waiting.reserve(2 * CommandQueue::CAPACITY);
 
   if (live) { // go ahead and play FluidSynth live if live mode has been set
     char* defaultDriver = fluid_settings_getstr_default(settings, "audio.driver");
     fluid_settings_setstr(settings, "audio.driver", defaultDriver);
-    driver = new_fluid_audio_driver(settings, synth);
+
+    // queued commands are applied by our own callback
+    if (queued) driver = new_fluid_audio_driver2(settings, &Synthesizer::render, this);
+
+    // some drivers [dsound in 1.1.x] have no callback entry
+    if (queued && driver == NULL) {
+      cerr << "Audio driver has no callback, using locked mode." << endl;
+      this -> queued = false;
+    }
+
+    if (driver == NULL) driver = new_fluid_audio_driver(settings, synth);
+    if (driver == NULL) cerr << "Cannot open audio driver." << endl;
   }
 
   // unlock synth
   synthLock.unlock();
-  return synth != NULL;
+  return synth != NULL && (!live || driver != NULL);
 }
 
 /**
@@ -94,6 +135,7 @@ bool Synthesizer::init(int rate, int polyphony, double gain, bool live) {
 */
 void Synthesizer::setGain(double gain) {
   if (synth == NULL) return; // sanity
+  if (queued) { send(SYNTH_GAIN, 0, 0, 0, gain); return; }
 
   synthLock.lock(); // lock synth
   // set default gain in fluidsynth settings
@@ -127,6 +169,44 @@ bool Synthesizer::load(const char* path) {
   return true;
 }
 
+/**
+ * Function: share
+ * ---------------
+ * Adds the fonts loaded into another
+ * synthesizer without loading them
+ * again. Voices count the users of each
+ * sample in a plain field, so the two
+ * synths must render on one thread;
+ * synths rendering in parallel each
+ * load their own fonts.
+ */
+bool Synthesizer::share(Synthesizer& owner) {
+  if (synth == NULL || owner.synth == NULL) return false;
+
+  // lock both synths
+  owner.synthLock.lock();
+  synthLock.lock();
+
+  // bottom of the owner's stack first
+  int count = fluid_synth_sfcount(owner.synth);
+  for (int i = count - 1; i >= 0; i -= 1) {
+    fluid_sfont_t* font = fluid_synth_get_sfont(owner.synth, i);
+    unsigned int id = font -> id;
+    int added = fluid_synth_add_sfont(synth, font);
+    font -> id = id; // the owner keeps its numbering
+    if (added == -1) continue;
+    borrowed.push_back(font);
+  }
+
+  // bind channels to the new presets
+  fluid_synth_program_reset(synth);
+
+  // unlock both synths
+  synthLock.unlock();
+  owner.synthLock.unlock();
+  return count > 0 && (int) borrowed.size() == count;
+}
+
 /**
  * Function: setInstrument
  * -----------------------
@@ -136,6 +216,7 @@ bool Synthesizer::load(const char* path) {
 void Synthesizer::setInstrument(int channel, int program) {
   if (synth == NULL) return;
   if (program < 0 || program > 127) return;
+  if (queued) { send(SYNTH_PROGRAM, channel, program, 0, 0); return; }
 
   synthLock.lock(); // lock synth
   fluid_synth_program_change(synth, channel, program);
@@ -150,6 +231,7 @@ void Synthesizer::setInstrument(int channel, int program) {
 void Synthesizer::controlChange(int channel, int dataTwo, int dataThree) {
   if (synth == NULL) return;
   if (dataTwo < 0 || dataTwo > 127) return;
+  if (queued) { send(SYNTH_CONTROL, channel, dataTwo, dataThree, 0); return; }
 
   synthLock.lock(); // lock synth
   fluid_synth_cc(synth, channel, dataTwo, dataThree);
@@ -165,6 +247,7 @@ void Synthesizer::controlChange(int channel, int dataTwo, int dataThree) {
 void Synthesizer::noteOn(int channel, float pitch, int velocity) {
   // sanity check on synth
   if (synth == NULL) return;
+  if (queued) { send(SYNTH_NOTE_ON, channel, pitch, velocity, 0); return; }
 
   // get an integer pitch
   // int pitchI = (int) (pitch + .5f);
@@ -196,11 +279,13 @@ void Synthesizer::pitchBend(int channel, float pitchDiff) {
   // sanity check on synth
   if (synth == NULL) return;
 
+  // pitch bend [TODO: figure out exactly what pitchDiff means]
+  int bend = (int) (8192 + pitchDiff * 8191);
+  if (queued) { send(SYNTH_PITCH_BEND, channel, 0, 0, bend); return; }
+
   // lock synth
   synthLock.lock();
-
-  // pitch bend [TODO: figure out exactly what pitchDiff means]
-  fluid_synth_pitch_bend(synth, channel, (int) (8192 + pitchDiff * 8191));
+  fluid_synth_pitch_bend(synth, channel, bend);
 
   // unlock synth
   synthLock.unlock();
@@ -215,6 +300,7 @@ void Synthesizer::pitchBend(int channel, float pitchDiff) {
 void Synthesizer::noteOff(int channel, int pitch) {
   // sanity check on synth
   if (synth == NULL) return;
+  if (queued) { send(SYNTH_NOTE_OFF, channel, pitch, 0, 0); return; }
 
   synthLock.lock(); // lock synth
   fluid_synth_noteoff(synth, channel, pitch);
@@ -231,6 +317,88 @@ void Synthesizer::allNotesOff(int channel) {
   controlChange(channel, 120, 0x7B);
 }
 
+/**
+ * Function: noteOnBatch
+ * ---------------------
+ * Turns on a chord of notes
+ * with a single submission.
+ */
+bool Synthesizer::noteOnBatch(int channel, const int* pitches, int count, int velocity) {
+  vector<SynthCommand> batch(count > 0 ? count : 0);
+  int64_t time = getTime(); // one onset for the chord
+  for (int i = 0; i < count; i += 1) {
+    batch[i].type = SYNTH_NOTE_ON;
+    batch[i].channel = channel;
+    batch[i].dataOne = pitches[i];
+    batch[i].dataTwo = velocity;
+    batch[i].value = 0;
+    batch[i].time = time;
+  }
+
+  return submit(batch.data(), count);
+}
+
+/**
+ * Function: noteOffBatch
+ * ----------------------
+ * Turns off a chord of notes
+ * with a single submission.
+ */
+bool Synthesizer::noteOffBatch(int channel, const int* pitches, int count) {
+  vector<SynthCommand> batch(count > 0 ? count : 0);
+  int64_t time = getTime(); // one release for the chord
+  for (int i = 0; i < count; i += 1) {
+    batch[i].type = SYNTH_NOTE_OFF;
+    batch[i].channel = channel;
+    batch[i].dataOne = pitches[i];
+    batch[i].dataTwo = 0;
+    batch[i].value = 0;
+    batch[i].time = time;
+  }
+
+  return submit(batch.data(), count);
+}
+
+/**
+ * Function: submit
+ * ----------------
+ * Applies a list of commands together.
+ * Queued batches are published in one
+ * step and locked ones under one lock,
+ * so no audio block sees half of one.
+ * Locked mode ignores capture times.
+ * Releases may use the reserved end
+ * of the ring, and a release too big
+ * for what is left goes in note by
+ * note, since a dropped note off sticks.
+ */
+bool Synthesizer::submit(const SynthCommand* batch, int count) {
+  // sanity check on synth
+  if (synth == NULL) return false;
+  if (count <= 0) return true;
+
+  if (queued) {
+    bool releases = true;
+    for (int i = 0; i < count; i += 1)
+      if (!isRelease(batch[i])) releases = false;
+
+    if (!releases) return commands.push(batch, count, CommandQueue::RELEASE_RESERVE);
+    if (commands.depth() + count <= CommandQueue::CAPACITY) return commands.push(batch, count);
+
+    // too many to release at once
+    bool sent = true;
+    for (int i = 0; i < count; i += 1)
+      if (!commands.push(batch[i])) sent = false;
+    return sent;
+  }
+
+  synthLock.lock(); // lock synth
+  for (int i = 0; i < count; i += 1)
+    apply(batch[i]);
+  synthLock.unlock(); // unlock synth
+  return true;
+}
+
 /**
  * Function: synthesize
  * --------------------
@@ -242,9 +410,140 @@ bool Synthesizer::synthesize(float* buffer, unsigned int numFrames) {
   if (synth == NULL) return false;
 
   synthLock.lock(); // lock synth
-  int retVal = fluid_synth_write_float(synth, numFrames, buffer, 0, 2, buffer, 1, 2);
+  int retVal = queued ? renderScheduled(numFrames, buffer, buffer + 1, 2)
+    : fluid_synth_write_float(synth, numFrames, buffer, 0, 2, buffer, 1, 2);
   synthLock.unlock(); // unlock synth
 
   // return success
   return retVal == 0;
 }
+
+/**
+ * Function: send
+ * --------------
+ * Queues a command for the audio
+ * thread. Overflows are only counted.
+ */
+void Synthesizer::send(uint8_t type, int channel, int dataOne, int dataTwo, float value) {
+  SynthCommand command;
+  command.type = type;
+  command.channel = channel;
+  command.dataOne = dataOne;
+  command.dataTwo = dataTwo;
+  command.value = value;
+  command.time = getTime();
+  commands.push(command, isRelease(command) ? 0 : CommandQueue::RELEASE_RESERVE);
+}
+
+/**
+ * Function: getTime
+ * -----------------
+ * Microseconds on a steady clock.
+ */
+int64_t Synthesizer::getTime() {
+  return chrono::duration_cast<chrono::microseconds>(
+    chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Function: renderScheduled
+ * -------------------------
+ * Renders one block in queued mode.
+ * Each command is due one block after
+ * its capture time, measured against a
+ * smoothed block clock, and the block
+ * is rendered in pieces split at each
+ * due frame. Late commands go at the
+ * start of the block.
+ */
+int Synthesizer::renderScheduled(int len, float* left, float* right, int stride) {
+  // follow the callback clock loosely so
+  // wakeup jitter does not move notes
+  int64_t now = getTime();
+  int64_t expected = blockTime + blockLength;
+  if (blockTime == 0 || now - expected > blockLength || expected - now > blockLength)
+    blockTime = now; // first block or a stall
+  else blockTime = expected + (now - expected) / 16;
+  blockLength = (int64_t) len * 1000000 / rate;
+
+  int64_t start = renderedFrames;
+  SynthCommand command;
+
+  while (commands.pop(command)) {
+    int64_t due = start; // unstamped
+    if (command.time) {
+      due = start + len + (command.time - blockTime) * rate / 1000000;
+      due = max(start, min(due, start + 2 * (int64_t) len - 1));
+    }
+
+    // no allocation on the audio thread
+    if (waiting.size() == waiting.capacity()) {
+      apply(command);
+      continue;
+    }
+
+    // insert in frame order, after equals
+    ScheduledCommand scheduled = { due, command };
+    waiting.push_back(scheduled);
+    for (int i = waiting.size() - 1; i > 0 && waiting[i - 1].frame > due; i -= 1)
+      swap(waiting[i - 1], waiting[i]);
+  }
+
+  // render up to each due command
+  int done = 0, used = 0, retVal = 0;
+  while (used < (int) waiting.size() && waiting[used].frame < start + len) {
+    int offset = waiting[used].frame - start;
+    if (offset > done) {
+      retVal |= fluid_synth_write_float(synth, offset - done,
+        left, done * stride, stride, right, done * stride, stride);
+      done = offset;
+    }
+
+    apply(waiting[used].command);
+    used += 1;
+  }
+
+  if (done < len) retVal |= fluid_synth_write_float(synth, len - done,
+    left, done * stride, stride, right, done * stride, stride);
+
+  waiting.erase(waiting.begin(), waiting.begin() + used);
+  renderedFrames += len;
+  return retVal;
+}
+
+/**
+ * Function: apply
+ * ---------------
+ * Hands one command to FluidSynth.
+ */
+void Synthesizer::apply(const SynthCommand& command) {
+  switch (command.type) {
+    case SYNTH_NOTE_ON:
+      fluid_synth_noteon(synth, command.channel, command.dataOne, command.dataTwo); break;
+    case SYNTH_NOTE_OFF:
+      fluid_synth_noteoff(synth, command.channel, command.dataOne); break;
+    case SYNTH_CONTROL:
+      fluid_synth_cc(synth, command.channel, command.dataOne, command.dataTwo); break;
+    case SYNTH_PROGRAM:
+      fluid_synth_program_change(synth, command.channel, command.dataOne); break;
+    case SYNTH_PITCH_BEND:
+      fluid_synth_pitch_bend(synth, command.channel, (int) command.value); break;
+    case SYNTH_GAIN:
+      fluid_synth_set_gain(synth, command.value); break;
+    default: break;
+  }
+}
+
+/**
+ * Function: render
+ * ----------------
+ * Live driver callback in queued mode.
+ * Renders a scheduled block straight
+ * into the driver's buffers, without
+ * touching synthLock.
+ */
+int Synthesizer::render(void* data, int len, int /*nin*/, float** /*in*/, int nout, float** out) {
+  Synthesizer* self = (Synthesizer*) data;
+  if (nout < 2) return -1; // always stereo
+  return self -> renderScheduled(len, out[0], out[1], 1);
+}
@@ -10,7 +10,9 @@
 #define SYNTHESIZER_H
 
 #include <fluidsynth.h>
-#include "ofMain.h"
+#include <mutex>
+#include <vector>
+#include "commandQueue.h"
 
 // plays MIDI audio
 class Synthesizer {
@@ -19,8 +21,11 @@ class Synthesizer {
     ~Synthesizer();
 
     // initialize synthesizer and load soundfont
-    bool init(int rate, int polyphony, double gain, bool live);
+    bool init(int rate, int polyphony, double gain, bool live, bool queued = false);
     bool load(const char* path);
+    // use fonts another synth loaded [it must outlive this one
+    // and both must render on the same thread]
+    bool share(Synthesizer& owner);
 
     // program change [set instrument]
     void setInstrument(int channel, int program);
@@ -36,16 +41,53 @@ class Synthesizer {
     void noteOff(int channel, int pitch);
     // turn off all notes on channel
     void allNotesOff(int channel);
+
+    // whole chords land in the same audio block
+    bool noteOnBatch(int channel, const int* pitches, int count, int velocity);
+    bool noteOffBatch(int channel, const int* pitches, int count);
+    bool submit(const SynthCommand* batch, int count);
+
+    // clock for command capture times
+    static int64_t getTime();
     // synthesize stereo buffer of samples
     bool synthesize(float* buffer, unsigned int numFrames);
 
+    // command mode queue statistics
+    bool isQueued() const { return queued; }
+    int getQueueDepth() const { return commands.depth(); }
+    int getQueuePeak() const { return commands.peakDepth(); }
+    int getQueueOverflows() const { return commands.overflowCount(); }
+
     // TODO: maybe make an accessor
     fluid_synth_t* synth;
-    ofMutex synthLock;
+    std::mutex synthLock;
 
   protected:
     fluid_settings_t* settings;
     fluid_audio_driver_t* driver;
+    std::vector<fluid_sfont_t*> borrowed;
+
+    // command mode [one sending thread]
+    bool queued;
+    CommandQueue commands;
+    void send(uint8_t type, int channel, int dataOne, int dataTwo, float value);
+    void apply(const SynthCommand& command);
+
+    // audio thread schedule in queued mode
+    struct ScheduledCommand {
+      int64_t frame;
+      SynthCommand command;
+    };
+
+    int rate;
+    int64_t renderedFrames;
+    int64_t blockTime; // smoothed start of block
+    int64_t blockLength; // in microseconds
+    std::vector<ScheduledCommand> waiting;
+    int renderScheduled(int len, float* left, float* right, int stride);
+
+    // live driver callback in command mode
+    static int render(void* data, int len, int nin, float** in, int nout, float** out);
 };
 
 // guard
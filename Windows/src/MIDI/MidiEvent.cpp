@@ -2,6 +2,9 @@
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Feb 14 21:40:14 PST 2015
 // Last Modified: Sat Feb 14 23:33:51 PST 2015
+// Last Modified: Fri Oct 16 13:05:51 PDT 2026 Pooled event allocation.
+// Last Modified: Fri Oct 16 18:10:37 PDT 2026 Links cleared on both sides.
+// Last Modified: Fri Oct 16 21:40:12 PDT 2026 Pool removed; files use arenas.
 // Filename:      midifile/src/MidiEvent.cpp
 // Website:       http://midifile.sapp.org
 // Syntax:        C++11
@@ -51,33 +54,35 @@ MidiEvent::MidiEvent(int aTime, int aTrack, vector<uchar>& message)
 }
 
 
-MidiEvent::MidiEvent(const MidiEvent& mfevent) {
+MidiEvent::MidiEvent(const MidiMessage& message) : MidiMessage(message) {
+   clearVariables();
+}
+
+
+MidiEvent::MidiEvent(const MidiEvent& mfevent) : MidiMessage(mfevent) {
    tick    = mfevent.tick;
    track   = mfevent.track;
    seconds = mfevent.seconds;
    seq     = mfevent.seq;
    eventlink = NULL;
-   this->resize(mfevent.size());
-   for (int i=0; i<(int)this->size(); i++) {
-      (*this)[i] = mfevent[i];
-   }
 }
 
 
 
 //////////////////////////////
 //
-// MidiEvent::~MidiEvent -- MidiFile Event destructor
+// MidiEvent::~MidiEvent -- MidiFile Event destructor.  A linked partner
+//     is unlinked so that it is not left pointing at a deleted event.
 //
 
 MidiEvent::~MidiEvent() {
    tick  = -1;
    track = -1;
-   this->resize(0);
-   eventlink = NULL;
+   unlinkEvent();
 }
 
 
+
 //////////////////////////////
 //
 // MidiEvent::clearVariables --  Clear everything except MidiMessage data.
@@ -94,22 +99,21 @@ void MidiEvent::clearVariables(void) {
 
 //////////////////////////////
 //
-// MidiEvent::operator= -- Copy the contents of another MidiEvent.
+// MidiEvent::operator= -- Copy the contents of another MidiEvent.  Links
+//     are not copied (the copy is not the partner's partner), and any
+//     link the event had before is removed from both sides.
 //
 
 MidiEvent& MidiEvent::operator=(const MidiEvent& mfevent) {
    if (this == &mfevent) {
       return *this;
    }
+   unlinkEvent();
    tick    = mfevent.tick;
    track   = mfevent.track;
    seconds = mfevent.seconds;
    seq     = mfevent.seq;
-   eventlink = NULL;
-   this->resize(mfevent.size());
-   for (int i=0; i<(int)this->size(); i++) {
-      (*this)[i] = mfevent[i];
-   }
+   assign(mfevent.begin(), mfevent.end());
    return *this;
 }
 
@@ -118,26 +122,23 @@ MidiEvent& MidiEvent::operator=(const MidiMessage& message) {
    if (this == &message) {
       return *this;
    }
+   unlinkEvent();
    clearVariables();
-   this->resize(message.size());
-   for (int i=0; i<(int)this->size(); i++) {
-      (*this)[i] = message[i];
-   }
+   assign(message.begin(), message.end());
    return *this;
 }
 
 
 MidiEvent& MidiEvent::operator=(const vector<uchar>& bytes) {
+   unlinkEvent();
    clearVariables();
-   this->resize(bytes.size());
-   for (int i=0; i<(int)this->size(); i++) {
-      (*this)[i] = bytes[i];
-   }
+   setMessage(bytes);
    return *this;
 }
 
 
 MidiEvent& MidiEvent::operator=(const vector<char>& bytes) {
+   unlinkEvent();
    clearVariables();
    setMessage(bytes);
    return *this;
@@ -145,6 +146,7 @@ MidiEvent& MidiEvent::operator=(const vector<char>& bytes) {
 
 
 MidiEvent& MidiEvent::operator=(const vector<int>& bytes) {
+   unlinkEvent();
    clearVariables();
    setMessage(bytes);
    return *this;
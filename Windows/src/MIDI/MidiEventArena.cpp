@@ -0,0 +1,285 @@
+//
+// Creation Date: Fri Oct 16 14:20:08 PDT 2026
+// Last Modified: Fri Oct 16 14:20:08 PDT 2026
+// Filename:      midifile/src/MidiEventArena.cpp
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Bump allocator which owns the MidiEvents (and any message
+//                bytes too long to be stored inside of the events) of a
+//                MidiFile.
+//
+
+#include "MidiEventArena.h"
+
+#include <new>
+
+using namespace std;
+
+// Size of the first chunk; later chunks double up to the maximum size.
+#define ARENA_FIRST_CHUNK  (64 * 1024)
+#define ARENA_MAX_CHUNK    (4 * 1024 * 1024)
+
+
+//////////////////////////////
+//
+// MidiEventArena::MidiEventArena -- Constructor.  No memory is allocated
+//     until the first event is created.
+//
+
+MidiEventArena::MidiEventArena(void) {
+   allocations = 0;
+   eventCount = 0;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventArena::~MidiEventArena -- Deconstructor.  Any events still
+//     in the arena must have been destroyed already by their lists.
+//
+
+MidiEventArena::~MidiEventArena() {
+   for (int i=0; i<(int)chunks.size(); i++) {
+      ::operator delete(chunks[i].start);
+   }
+   chunks.clear();
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventArena::newEvent -- Create an event in the arena.  Message bytes
+//     which do not fit inside of the event are also stored in the arena.
+//
+
+MidiEvent* MidiEventArena::newEvent(void) {
+   MidiEvent* event = ::new (allocate(sizeof(MidiEvent))) MidiEvent;
+   eventCount++;
+   return event;
+}
+
+
+MidiEvent* MidiEventArena::newEvent(const MidiEvent& event) {
+   MidiEvent* output = newEvent();
+   if (event.size() > output->capacity()) {
+      output->setStorage(allocateBytes(event.size()), event.size());
+   }
+   *output = event;
+   return output;
+}
+
+
+MidiEvent* MidiEventArena::newEvent(const MidiMessage& message) {
+   MidiEvent* output = newEvent();
+   if (message.size() > output->capacity()) {
+      output->setStorage(allocateBytes(message.size()), message.size());
+   }
+   output->assign(message.begin(), message.end());
+   return output;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventArena::deleteEvent -- Destroy an event created by the arena.
+//     The memory is not reused until the arena is cleared.
+//
+
+void MidiEventArena::deleteEvent(MidiEvent* event) {
+   if (event != NULL) {
+      event->~MidiEvent();
+   }
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventArena::allocateBytes -- Reserve storage for message bytes.
+//
+
+uchar* MidiEventArena::allocateBytes(size_t count) {
+   return (uchar*)allocate(count);
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventArena::clear -- Give all memory back to the arena.  The largest
+//     chunk is kept for reuse, so reading files of similar size one after
+//     another does not have to go back to the system.  All events in the
+//     arena must have been destroyed first.
+//
+
+void MidiEventArena::clear(void) {
+   if (chunks.empty()) {
+      return;
+   }
+   int largest = 0;
+   int i;
+   for (i=1; i<(int)chunks.size(); i++) {
+      if (chunks[i].size > chunks[largest].size) {
+         largest = i;
+      }
+   }
+   for (i=0; i<(int)chunks.size(); i++) {
+      if (i != largest) {
+         ::operator delete(chunks[i].start);
+      }
+   }
+   chunks[0] = chunks[largest];
+   chunks[0].used = 0;
+   chunks.resize(1);
+   eventCount = 0;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventArena::splice -- Take over all of the memory of another arena,
+//     which is left empty.  Events created by the other arena now belong
+//     to this one.
+//
+
+void MidiEventArena::splice(MidiEventArena& other) {
+   if (&other == this) {
+      return;
+   }
+   // keep allocating from the current chunk of this arena:
+   chunks.insert(chunks.empty() ? chunks.end() : chunks.end() - 1,
+         other.chunks.begin(), other.chunks.end());
+   allocations += other.allocations;
+   eventCount  += other.eventCount;
+   other.chunks.clear();
+   other.allocations = 0;
+   other.eventCount = 0;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventArena::getChunkCount -- Return the number of chunks of memory
+//     currently held by the arena.
+//
+
+int MidiEventArena::getChunkCount(void) const {
+   return (int)chunks.size();
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventArena::getAllocationCount -- Return the number of chunks which
+//     have been requested from the system over the life of the arena.
+//
+
+int MidiEventArena::getAllocationCount(void) const {
+   return allocations;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventArena::getEventCount -- Return the number of events created
+//     since the arena was last cleared.
+//
+
+int MidiEventArena::getEventCount(void) const {
+   return eventCount;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventArena::getBytesUsed -- Return the number of bytes handed out
+//     since the arena was last cleared.
+//
+
+size_t MidiEventArena::getBytesUsed(void) const {
+   size_t sum = 0;
+   for (int i=0; i<(int)chunks.size(); i++) {
+      sum += chunks[i].used;
+   }
+   return sum;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventArena::getBytesReserved -- Return the number of bytes held
+//     by the arena.
+//
+
+size_t MidiEventArena::getBytesReserved(void) const {
+   size_t sum = 0;
+   for (int i=0; i<(int)chunks.size(); i++) {
+      sum += chunks[i].size;
+   }
+   return sum;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// private functions
+//
+
+//////////////////////////////
+//
+// MidiEventArena::allocate -- Hand out the next count bytes of the current
+//     chunk, rounded up so that the following allocation stays aligned
+//     for a MidiEvent.
+//
+
+void* MidiEventArena::allocate(size_t count) {
+   count = (count + sizeof(double) - 1) & ~(sizeof(double) - 1);
+   if (chunks.empty() || (chunks.back().size - chunks.back().used < count)) {
+      addChunk(count);
+   }
+   _ArenaChunk& chunk = chunks.back();
+   void* output = chunk.start + chunk.used;
+   chunk.used += count;
+   return output;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventArena::addChunk -- Get a new chunk from the system which can
+//     hold at least count bytes.
+//
+
+void MidiEventArena::addChunk(size_t count) {
+   size_t size = ARENA_FIRST_CHUNK;
+   if (!chunks.empty()) {
+      size = chunks.back().size * 2;
+      if (size > ARENA_MAX_CHUNK) {
+         size = ARENA_MAX_CHUNK;
+      }
+   }
+   if (size < count) {
+      size = count;
+   }
+   _ArenaChunk chunk;
+   chunk.start = (char*)::operator new(size);
+   chunk.size  = size;
+   chunk.used  = 0;
+   chunks.push_back(chunk);
+   allocations++;
+}
+
+
+
@@ -0,0 +1,72 @@
+//
+// Creation Date: Fri Oct 16 14:20:08 PDT 2026
+// Last Modified: Fri Oct 16 14:20:08 PDT 2026
+// Filename:      midifile/include/MidiEventArena.h
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Bump allocator which owns the MidiEvents (and any message
+//                bytes too long to be stored inside of the events) of a
+//                MidiFile.  Memory is taken from the system in large chunks
+//                and is only given back when the whole arena is cleared,
+//                so reading a file costs a handful of allocations and
+//                clearing it costs one free per chunk.  An arena is not
+//                thread-safe; use one per thread and splice them together.
+//
+
+#ifndef _MIDIEVENTARENA_H_INCLUDED
+#define _MIDIEVENTARENA_H_INCLUDED
+
+#include "MidiEvent.h"
+
+#include <vector>
+
+using namespace std;
+
+class _ArenaChunk {
+   public:
+      char*   start;       // first byte of chunk
+      size_t  size;        // number of bytes in chunk
+      size_t  used;        // number of bytes handed out
+};
+
+
+class MidiEventArena {
+   public:
+                  MidiEventArena        (void);
+                 ~MidiEventArena        ();
+
+      MidiEvent*  newEvent              (void);
+      MidiEvent*  newEvent              (const MidiEvent& event);
+      MidiEvent*  newEvent              (const MidiMessage& message);
+      void        deleteEvent           (MidiEvent* event);
+      uchar*      allocateBytes         (size_t count);
+
+      void        clear                 (void);
+      void        splice                (MidiEventArena& other);
+
+      // allocation counters:
+      int         getChunkCount         (void) const;
+      int         getAllocationCount    (void) const;
+      int         getEventCount         (void) const;
+      size_t      getBytesUsed          (void) const;
+      size_t      getBytesReserved      (void) const;
+
+   private:
+      vector<_ArenaChunk> chunks;        // chunks in order of allocation
+      int                 allocations;   // chunks ever taken from system
+      int                 eventCount;    // events allocated since clear
+
+      void*       allocate              (size_t count);
+      void        addChunk              (size_t count);
+
+      // arenas own raw memory, so they cannot be copied:
+                  MidiEventArena        (const MidiEventArena& other);
+      MidiEventArena& operator=         (const MidiEventArena& other);
+};
+
+
+#endif /* _MIDIEVENTARENA_H_INCLUDED */
+
+
+
@@ -2,6 +2,9 @@
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Feb 14 21:55:38 PST 2015
 // Last Modified: Sat Feb 14 21:55:40 PST 2015
+// Last Modified: Fri Oct 16 14:20:08 PDT 2026 Events may be owned by an arena.
+// Last Modified: Fri Oct 16 16:31:02 PDT 2026 Flat note-linking tables.
+// Last Modified: Fri Oct 16 18:10:37 PDT 2026 Copies keep note links.
 // Filename:      midifile/src-library/MidiEventList.cpp
 // Website:       http://midifile.sapp.org
 // Syntax:        C++11
@@ -17,6 +20,7 @@
 #include <iostream>
 #include <algorithm>
 #include <iterator>
+#include <unordered_map>
 #include <utility>
 
 using namespace std;
@@ -28,6 +32,18 @@ using namespace std;
 //
 
 MidiEventList::MidiEventList(void) {
+   arena = NULL;
+   reserve(1000);
+}
+
+
+//
+// When an arena is given, events added to the list are created in (and
+// owned by) the arena rather than allocated individually with new.
+//
+
+MidiEventList::MidiEventList(MidiEventArena* anArena) {
+   arena = anArena;
    reserve(1000);
 }
 
@@ -35,15 +51,30 @@ MidiEventList::MidiEventList(void) {
 
 //////////////////////////////
 //
-// MidiEventList::MidiEventList(MidiEventList&) -- Copy constructor.
+// MidiEventList::MidiEventList(MidiEventList&) -- Copy constructor.  Note
+//     links between events of the other list are copied as links between
+//     the matching events of the new list.
 //
 
 MidiEventList::MidiEventList(const MidiEventList& other) {
+   arena = NULL;
    list.reserve(other.list.size());
    auto it = other.list.begin();
    std::generate_n(std::back_inserter(list), other.list.size(), [&]() -> MidiEvent* {
       return new MidiEvent(**it++);
    });
+   copyLinks(other);
+}
+
+
+MidiEventList::MidiEventList(const MidiEventList& other,
+      MidiEventArena* anArena) {
+   arena = anArena;
+   list.reserve(other.list.size());
+   for (int i=0; i<(int)other.list.size(); i++) {
+      append(*other.list[i]);
+   }
+   copyLinks(other);
 }
 
 
@@ -56,6 +87,7 @@ MidiEventList::MidiEventList(const MidiEventList& other) {
 MidiEventList::MidiEventList(MidiEventList&& other) {
     list = std::move(other.list);
     other.list.clear();
+    arena = other.arena;
 }
 
 
@@ -120,13 +152,18 @@ MidiEvent& MidiEventList::getEvent(int index) {
 //////////////////////////////
 //
 // MidiEventList::clear -- De-allocate any MidiEvents present in the list
-//    and set the size of the list to 0.
+//    and set the size of the list to 0.  Events owned by an arena are
+//    only destroyed; their memory is released when the arena is cleared.
 //
 
 void MidiEventList::clear(void) {
    for (int i=0; i<(int)list.size(); i++) {
       if (list[i] != NULL) {
-         delete list[i];
+         if (arena != NULL) {
+            arena->deleteEvent(list[i]);
+         } else {
+            delete list[i];
+         }
          list[i] = NULL;
       }
    }
@@ -146,6 +183,18 @@ MidiEvent** MidiEventList::data(void) {
 
 
 
+//////////////////////////////
+//
+// MidiEventList::getArena -- Return the arena which owns the events of
+//     the list, or NULL if the events are allocated with new.
+//
+
+MidiEventArena* MidiEventList::getArena(void) const {
+   return arena;
+}
+
+
+
 //////////////////////////////
 //
 // MidiEventList::reserve --  Pre-allocate space in the list for storing
@@ -182,7 +231,12 @@ int MidiEventList::size(void) const {
 //
 
 int MidiEventList::append(MidiEvent& event) {
-   MidiEvent* ptr = new MidiEvent(event);
+   MidiEvent* ptr;
+   if (arena != NULL) {
+      ptr = arena->newEvent(event);
+   } else {
+      ptr = new MidiEvent(event);
+   }
    list.push_back(ptr);
    return (int)list.size()-1;
 }
@@ -198,6 +252,177 @@ int MidiEventList::push_back(MidiEvent& event) {
 }
 
 
+//////////////////////////////
+//
+// _NoteLinker -- State used by MidiEventList::linkNotePairs() while
+//   walking through a track.  Pending note-ons are kept in one stack per
+//   channel and key; the stacks are linked lists of nodes taken from one
+//   pool which only moves to the heap if more than LINK_LOCAL_NODES notes
+//   are sounding at once.  The tables for a single track are stored in
+//   the object itself, so linking a track normally allocates nothing.
+//
+
+#define LINK_KEYS         (16 * 128)   // channels * keys
+#define LINK_SWITCHES     (18 * 16)    // switch controllers * channels
+#define LINK_LOCAL_NODES  512          // pending note-ons before heap use
+
+class _NoteNode {
+   public:
+      MidiEvent* event;
+      int        below;       // next node down the stack, or -1
+};
+
+
+class _NoteLinker {
+   public:
+      _NoteLinker(int tracks) {
+         if (tracks <= 1) {
+            heads    = localheads;
+            switches = localswitches;
+            states   = localstates;
+         } else {
+            heapheads.resize(tracks * LINK_KEYS);
+            heapswitches.resize(tracks * LINK_SWITCHES);
+            heapstates.resize(tracks * LINK_SWITCHES);
+            heads    = heapheads.data();
+            switches = heapswitches.data();
+            states   = heapstates.data();
+         }
+         int count = (tracks <= 1) ? 1 : tracks;
+         fill(heads, heads + count * LINK_KEYS, -1);
+         fill(switches, switches + count * LINK_SWITCHES, (MidiEvent*)NULL);
+         fill(states, states + count * LINK_SWITCHES, (signed char)-1);
+         nodes = localnodes;
+         capacity = LINK_LOCAL_NODES;
+         used = 0;
+         freenode = -1;
+      }
+
+      // Process the next event of the given track; returns 1 if a
+      // note pair was linked.
+      int process(MidiEvent* mev, int track) {
+         mev->unlinkEvent();
+         if (mev->isNoteOn()) {
+            // store the note-on to pair later with a note-off message.
+            int& top = heads[track * LINK_KEYS + getKeySlot(mev)];
+            int node = newNode();
+            nodes[node].event = mev;
+            nodes[node].below = top;
+            top = node;
+         } else if (mev->isNoteOff()) {
+            int& top = heads[track * LINK_KEYS + getKeySlot(mev)];
+            if (top >= 0) {
+               int node = top;
+               top = nodes[node].below;
+               nodes[node].below = freenode;
+               freenode = node;
+               nodes[node].event->linkEvent(mev);
+               return 1;
+            }
+         } else if (mev->isController()) {
+            int conti = getSwitchSlot(mev->getP1());
+            if (conti < 0) {
+               return 0;
+            }
+            int index = track * LINK_SWITCHES + conti * 16 + mev->getChannel();
+            int contstate = mev->getP2() < 64 ? 0 : 1;
+            if ((states[index] == -1) && contstate) {
+               // a newly initialized onstate was detected, so store for
+               // later linking to an off state.
+               switches[index] = mev;
+               states[index] = contstate;
+            } else if (states[index] == contstate) {
+               // the controller state is redundant and will be ignored.
+            } else if ((states[index] == 0) && contstate) {
+               // controller is currently off, so store on-state for next link
+               switches[index] = mev;
+               states[index] = contstate;
+            } else if ((states[index] == 1) && (contstate == 0)) {
+               // controller has just been turned off, so link to
+               // stored on-message.
+               switches[index]->linkEvent(mev);
+               states[index] = contstate;
+               // not necessary, but maybe use for something later:
+               switches[index] = mev;
+            }
+         }
+         return 0;
+      }
+
+   private:
+      int                 localheads[LINK_KEYS];
+      MidiEvent*          localswitches[LINK_SWITCHES];
+      signed char         localstates[LINK_SWITCHES];
+      _NoteNode           localnodes[LINK_LOCAL_NODES];
+      vector<int>         heapheads;
+      vector<MidiEvent*>  heapswitches;
+      vector<signed char> heapstates;
+      vector<_NoteNode>   heapnodes;
+
+      int*         heads;        // top node of each note-on stack
+      MidiEvent**  switches;     // last switch controller event
+      signed char* states;       // -1 = unset, 0 = off, 1 = on
+      _NoteNode*   nodes;        // node pool
+      int          capacity;     // size of node pool
+      int          used;         // nodes taken from pool so far
+      int          freenode;     // list of returned nodes
+
+      int newNode(void) {
+         if (freenode >= 0) {
+            int node = freenode;
+            freenode = nodes[node].below;
+            return node;
+         }
+         if (used >= capacity) {
+            heapnodes.resize(capacity * 2);
+            if (nodes == localnodes) {
+               copy(localnodes, localnodes + capacity, heapnodes.begin());
+            }
+            nodes = heapnodes.data();
+            capacity *= 2;
+         }
+         return used++;
+      }
+
+      static int getKeySlot(MidiEvent* mev) {
+         return mev->getChannel() * 128 + (mev->getKeyNumber() & 0x7f);
+      }
+
+      // The following General MIDI controller numbers are also monitored
+      // for linking within the track (but not between tracks).
+      // hex dec  name                                    range
+      // 40  64   Hold pedal (Sustain) on/off             0..63=off  64..127=on
+      // 41  65   Portamento on/off                       0..63=off  64..127=on
+      // 42  66   Sustenuto Pedal on/off                  0..63=off  64..127=on
+      // 43  67   Soft Pedal on/off                       0..63=off  64..127=on
+      // 44  68   Legato Pedal on/off                     0..63=off  64..127=on
+      // 45  69   Hold Pedal 2 on/off                     0..63=off  64..127=on
+      // 50  80   General Purpose Button                  0..63=off  64..127=on
+      // 51  81   General Purpose Button                  0..63=off  64..127=on
+      // 52  82   General Purpose Button                  0..63=off  64..127=on
+      // 53  83   General Purpose Button                  0..63=off  64..127=on
+      // 54  84   Undefined on/off                        0..63=off  64..127=on
+      // 55  85   Undefined on/off                        0..63=off  64..127=on
+      // 56  86   Undefined on/off                        0..63=off  64..127=on
+      // 57  87   Undefined on/off                        0..63=off  64..127=on
+      // 58  88   Undefined on/off                        0..63=off  64..127=on
+      // 59  89   Undefined on/off                        0..63=off  64..127=on
+      // 5A  90   Undefined on/off                        0..63=off  64..127=on
+      // 7A 122   Local Keyboard On/Off                   0..63=off  64..127=on
+      static int getSwitchSlot(int controller) {
+         if ((controller >= 64) && (controller <= 69)) {
+            return controller - 64;
+         } else if ((controller >= 80) && (controller <= 90)) {
+            return controller - 80 + 6;
+         } else if (controller == 122) {
+            return 17;
+         }
+         return -1;
+      }
+};
+
+
+
 //////////////////////////////
 //
 // MidiEventList::linkNotePairs -- Match note-ones and note-offs together
@@ -216,135 +441,39 @@ int MidiEventList::linkEventPairs(void) {
 
 
 int MidiEventList::linkNotePairs(void) {
-
-   // Note-on states:
-   // dimension 1: MIDI channel (0-15)
-   // dimension 2: MIDI key     (0-127)  (but 0 not used for note-ons)
-   // dimension 3: List of active note-ons or note-offs.
-   vector<vector<vector<MidiEvent*> > > noteons;
-   noteons.resize(16);
-   int i;
-   for (i=0; i<(int)noteons.size(); i++) {
-      noteons[i].resize(128);
+   _NoteLinker linker(1);
+   int counter = 0;
+   for (int i=0; i<getSize(); i++) {
+      counter += linker.process(list[i], 0);
    }
+   return counter;
+}
 
-   // Controller linking: The following General MIDI controller numbers are
-   // also monitored for linking within the track (but not between tracks).
-   // hex dec  name                                    range
-   // 40  64   Hold pedal (Sustain) on/off             0..63=off  64..127=on
-   // 41  65   Portamento on/off                       0..63=off  64..127=on
-   // 42  66   Sustenuto Pedal on/off                  0..63=off  64..127=on
-   // 43  67   Soft Pedal on/off                       0..63=off  64..127=on
-   // 44  68   Legato Pedal on/off                     0..63=off  64..127=on
-   // 45  69   Hold Pedal 2 on/off                     0..63=off  64..127=on
-   // 50  80   General Purpose Button                  0..63=off  64..127=on
-   // 51  81   General Purpose Button                  0..63=off  64..127=on
-   // 52  82   General Purpose Button                  0..63=off  64..127=on
-   // 53  83   General Purpose Button                  0..63=off  64..127=on
-   // 54  84   Undefined on/off                        0..63=off  64..127=on
-   // 55  85   Undefined on/off                        0..63=off  64..127=on
-   // 56  86   Undefined on/off                        0..63=off  64..127=on
-   // 57  87   Undefined on/off                        0..63=off  64..127=on
-   // 58  88   Undefined on/off                        0..63=off  64..127=on
-   // 59  89   Undefined on/off                        0..63=off  64..127=on
-   // 5A  90   Undefined on/off                        0..63=off  64..127=on
-   // 7A 122   Local Keyboard On/Off                   0..63=off  64..127=on
-
-   // first keep track of whether the controller is an on/off switch:
-   vector<pair<int, int> > contmap;
-   contmap.resize(128);
-   pair<int, int> zero(0, 0);
-   fill(contmap.begin(), contmap.end(), zero);
-   contmap[64].first  = 1;   contmap[64].second = 0;
-   contmap[65].first  = 1;   contmap[65].second = 1;
-   contmap[66].first  = 1;   contmap[66].second = 2;
-   contmap[67].first  = 1;   contmap[67].second = 3;
-   contmap[68].first  = 1;   contmap[68].second = 4;
-   contmap[69].first  = 1;   contmap[69].second = 5;
-   contmap[80].first  = 1;   contmap[80].second = 6;
-   contmap[81].first  = 1;   contmap[81].second = 7;
-   contmap[82].first  = 1;   contmap[82].second = 8;
-   contmap[83].first  = 1;   contmap[83].second = 9;
-   contmap[84].first  = 1;   contmap[84].second = 10;
-   contmap[85].first  = 1;   contmap[85].second = 11;
-   contmap[86].first  = 1;   contmap[86].second = 12;
-   contmap[87].first  = 1;   contmap[87].second = 13;
-   contmap[88].first  = 1;   contmap[88].second = 14;
-   contmap[89].first  = 1;   contmap[89].second = 15;
-   contmap[90].first  = 1;   contmap[90].second = 16;
-   contmap[122].first = 1;   contmap[122].second = 17;
-
-   // dimensions:
-   // 1: mapped controller (0 to 17)
-   // 2: channel (0 to 15)
-   vector<vector<MidiEvent*> > contevents;
-   contevents.resize(18);
-   vector<vector<int> > oldstates;
-   oldstates.resize(18);
-   for (int i=0; i<18; i++) {
-      contevents[i].resize(16);
-      fill(contevents[i].begin(), contevents[i].end(), nullptr);
-      oldstates[i].resize(16);
-      fill(oldstates[i].begin(), oldstates[i].end(), -1);
-   }
 
-   // Now iterate through the MidiEventList keeping track of note and
-   // select controller states and linking notes/controllers as needed.
-   int channel;
-   int key;
-   int contnum;
-   int contval;
-   int conti;
-   int contstate;
-   int counter = 0;
-   MidiEvent* mev;
-   MidiEvent* noteon;
+
+//////////////////////////////
+//
+// MidiEventList::linkNotePairsByTrack -- Link note-ons to note-offs in a
+//   list of joined tracks in a single pass, keeping separate note and
+//   controller states for each MidiEvent::track value.  This gives the
+//   same links as calling linkNotePairs() on each track before joining.
+//   Returns the number of linked note pairs.
+//
+
+int MidiEventList::linkNotePairsByTrack(void) {
+   int tracks = 1;
+   int i;
    for (i=0; i<getSize(); i++) {
-      mev = &getEvent(i);
-      mev->unlinkEvent();
-      if (mev->isNoteOn()) {
-         // store the note-on to pair later with a note-off message.
-         key = mev->getKeyNumber();
-         channel = mev->getChannel();
-         noteons[channel][key].push_back(mev);
-      } else if (mev->isNoteOff()) {
-         key = mev->getKeyNumber();
-         channel = mev->getChannel();
-         if (noteons[channel][key].size() > 0) {
-            noteon = noteons[channel][key].back();
-            noteons[channel][key].pop_back();
-            noteon->linkEvent(mev);
-            counter++;
-         }
-      } else if (mev->isController()) {
-         contnum = mev->getP1();
-         if (contmap[contnum].first) {
-            conti     = contmap[contnum].second;
-            channel   = mev->getChannel();
-            contval   = mev->getP2();
-            contstate = contval < 64 ? 0 : 1;
-            if ((oldstates[conti][channel] == -1) && contstate) {
-               // a newly initialized onstate was detected, so store for
-               // later linking to an off state.
-               contevents[conti][channel] = mev;
-               oldstates[conti][channel] = contstate;
-            } else if (oldstates[conti][channel] == contstate) {
-               // the controller state is redundant and will be ignored.
-            } else if ((oldstates[conti][channel] == 0) && contstate) {
-               // controller is currently off, so store on-state for next link
-               contevents[conti][channel] = mev;
-               oldstates[conti][channel] = contstate;
-            } else if ((oldstates[conti][channel] == 1) && (contstate == 0)) {
-               // controller has just been turned off, so link to
-               // stored on-message.
-               contevents[conti][channel]->linkEvent(mev);
-               oldstates[conti][channel] = contstate;
-               // not necessary, but maybe use for something later:
-               contevents[conti][channel] = mev;
-            }
-         }
+      if (list[i]->track >= tracks) {
+         tracks = list[i]->track + 1;
       }
    }
+   _NoteLinker linker(tracks);
+   int counter = 0;
+   for (i=0; i<getSize(); i++) {
+      counter += linker.process(list[i], list[i]->track < 0 ? 0 :
+            list[i]->track);
+   }
    return counter;
 }
 
@@ -368,6 +497,56 @@ void MidiEventList::clearLinks(void) {
 //
 
 
+//////////////////////////////
+//
+// MidiEventList::copyLinks -- Link the events of this list in the same
+//     way as the events at the same positions in another list, which
+//     this list is a copy of.  The partner of a note-on is nearly always
+//     a little way after it, so the next few events are checked first;
+//     a table of positions is only made for notes which are further
+//     apart.  Links to events outside of the other list are dropped.
+//     The other list is only read, so several copies of one list can be
+//     made at once.
+//
+
+#define LINK_COPY_WINDOW  256
+
+void MidiEventList::copyLinks(const MidiEventList& other) {
+   unordered_map<const MidiEvent*, int> position;
+   MidiEvent* const* events = other.list.data();
+   int count = (int)other.list.size();
+   int i, j;
+   for (i=0; i<count; i++) {
+      MidiEvent* partner = events[i]->getLinkedEvent();
+      if ((partner == NULL) || (list[i]->isLinked())) {
+         continue;
+      }
+      int end = min(count, i + 1 + LINK_COPY_WINDOW);
+      for (j=i+1; j<end; j++) {
+         if (events[j] == partner) {
+            break;
+         }
+      }
+      if (j == end) {
+         if (position.empty()) {
+            position.reserve(count);
+            for (j=0; j<count; j++) {
+               if (events[j]->isLinked()) {
+                  position[events[j]] = j;
+               }
+            }
+         }
+         auto found = position.find(partner);
+         j = (found == position.end()) ? -1 : found->second;
+      }
+      if (j > i) {
+         list[i]->linkEvent(list[j]);
+      }
+   }
+}
+
+
+
 //////////////////////////////
 //
 // MidiEventList::detach -- De-allocate any MidiEvents present in the list
@@ -402,6 +581,7 @@ int MidiEventList::push_back_no_copy(MidiEvent* event) {
 
 MidiEventList& MidiEventList::operator=(MidiEventList other) {
    list.swap(other.list);
+   std::swap(arena, other.arena);
    return *this;
 }
 
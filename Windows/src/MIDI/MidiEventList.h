@@ -2,6 +2,8 @@
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Feb 14 21:55:38 PST 2015
 // Last Modified: Sat Feb 14 21:55:40 PST 2015
+// Last Modified: Fri Oct 16 14:20:08 PDT 2026 Events may be owned by an arena.
+// Last Modified: Fri Oct 16 18:10:37 PDT 2026 Copies keep note links.
 // Filename:      midifile/include/MidiEventList.h
 // Website:       http://midifile.sapp.org
 // Syntax:        C++11
@@ -14,6 +16,7 @@
 #define _MIDIEVENTLIST_H_INCLUDED
 
 #include "MidiEvent.h"
+#include "MidiEventArena.h"
 #include <vector>
 
 using namespace std;
@@ -21,11 +24,14 @@ using namespace std;
 class MidiEventList {
    public:
                   MidiEventList    (void);
+                  MidiEventList    (MidiEventArena* anArena);
 
                  ~MidiEventList    ();
 
                  MidiEventList     (const MidiEventList& other);
                  MidiEventList     (MidiEventList&& other);
+                 MidiEventList     (const MidiEventList& other,
+                                    MidiEventArena* anArena);
 
       MidiEvent&  operator[]       (int index);
       const MidiEvent&  operator[] (int index) const;
@@ -37,15 +43,19 @@ class MidiEventList {
       int         getSize          (void) const;
       int         size             (void) const;
       int         linkNotePairs    (void);
+      int         linkNotePairsByTrack(void);
       int         linkEventPairs   (void);
       void        clearLinks       (void);
       MidiEvent** data             (void);
+      MidiEventArena* getArena     (void) const;
 
       int         push             (MidiEvent& event);
       int         push_back        (MidiEvent& event);
       int         append           (MidiEvent& event);
 
-      // careful when using these, intended for internal use in MidiFile class:
+      // careful when using these, intended for internal use in MidiFile class
+      // (events added without copying must come from the list's arena, or
+      // from new if the list has no arena):
       void        detach              (void);
       int         push_back_no_copy   (MidiEvent* event);
 
@@ -53,6 +63,9 @@ class MidiEventList {
 
    private:
       vector<MidiEvent*>     list;
+      MidiEventArena*        arena;     // owner of events, or NULL for heap
+
+      void        copyLinks        (const MidiEventList& other);
 
 };
 
@@ -0,0 +1,64 @@
+//
+// Creation Date: Fri Oct 16 17:41:26 PDT 2026
+// Last Modified: Fri Oct 16 17:41:26 PDT 2026
+// Filename:      midifile/include/MidiEventTable.h
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Columnar copy of the events of a MidiFile for analysis
+//                loops which only look at a few fields of each event.
+//                Each field is stored in its own contiguous array, so a
+//                loop over (say) the status bytes and ticks reads 5 bytes
+//                per event instead of following a pointer to each
+//                MidiEvent.  The table is a snapshot: later changes to
+//                the MidiFile are not reflected in it.
+//
+
+#ifndef _MIDIEVENTTABLE_H_INCLUDED
+#define _MIDIEVENTTABLE_H_INCLUDED
+
+#include "MidiFile.h"
+
+#include <vector>
+
+using namespace std;
+
+class MidiEventTable {
+   public:
+                  MidiEventTable        (void);
+                  MidiEventTable        (MidiFile& midifile);
+                 ~MidiEventTable        ();
+
+      int         build                 (MidiFile& midifile);
+      void        clear                 (void);
+      int         size                  (void) const;
+
+      // columns, each with size() entries:
+      const int*    getTicks            (void) const;
+      const double* getSeconds          (void) const;
+      const uchar*  getStatus           (void) const;
+      const uchar*  getData1            (void) const;
+      const uchar*  getData2            (void) const;
+      const ushort* getTracks           (void) const;
+      const int*    getLinks            (void) const;
+
+      // single-entry helpers:
+      int         isNoteOn              (int index) const;
+      int         isNoteOff             (int index) const;
+      double      getDurationInSeconds  (int index) const;
+
+   private:
+      vector<int>    ticks;        // absolute tick of event
+      vector<double> seconds;      // time of event in seconds
+      vector<uchar>  status;       // first byte (0xff for meta messages)
+      vector<uchar>  data1;        // second byte, or 0
+      vector<uchar>  data2;        // third byte, or 0
+      vector<ushort> tracks;       // track of event (MidiEvent::track)
+      vector<int>    links;        // table index of linked event, or -1
+};
+
+
+#endif /* _MIDIEVENTTABLE_H_INCLUDED */
+
+
+
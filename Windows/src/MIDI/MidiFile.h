@@ -15,6 +15,9 @@
 // Last Modified: Mon Nov 18 13:10:37 PST 2013 Added .printHex function.
 // Last Modified: Mon Feb  9 14:01:31 PST 2015 Removed FileIO dependency.
 // Last Modified: Sat Feb 14 22:35:25 PST 2015 Split out subclasses.
+// Last Modified: Fri Oct 16 10:12:40 PDT 2026 Added read from memory.
+// Last Modified: Fri Oct 16 14:20:08 PDT 2026 Events owned by an arena.
+// Last Modified: Fri Oct 16 15:48:30 PDT 2026 Tempo segment map.
 // Filename:      midifile/include/MidiFile.h
 // Website:       http://midifile.sapp.org
 // Syntax:        C++11
@@ -41,10 +44,35 @@ using namespace std;
 #define TRACK_STATE_SPLIT      0
 #define TRACK_STATE_JOINED     1
 
-class _TickTime {
+class _TempoSegment {
    public:
-      int    tick;
-      double seconds;
+      int    tick;              // tick at which the tempo takes effect
+      double seconds;           // time in seconds at that tick
+      double secondsPerTick;    // tempo until the next segment
+};
+
+
+// Read-only view of a whole file (memory-mapped when possible).
+class _MappedFile {
+   public:
+                   _MappedFile (const char* filename);
+                  ~_MappedFile ();
+
+      int          isOpen      (void) const { return openQ; }
+      const uchar* data        (void) const { return bytes; }
+      size_t       size        (void) const { return length; }
+
+   private:
+      int           openQ;
+      const uchar*  bytes;
+      size_t        length;
+      void*         view;
+      vector<uchar> buffer;
+
+      void          readBuffer  (const char* filename);
+
+                    _MappedFile (const _MappedFile&);
+      _MappedFile&  operator=   (const _MappedFile&);
 };
 
 
@@ -62,9 +90,11 @@ class MidiFile {
       int       read                      (const char* aFile);
       int       read                      (const string& aFile);
       int       read                      (istream& istream);
+      int       read                      (const uchar* data, size_t length);
       int       write                     (const char* aFile);
       int       write                     (const string& aFile);
       int       write                     (ostream& out);
+      int       write                     (vector<uchar>& out);
       int       writeHex                  (const char* aFile,   int width = 25);
       int       writeHex                  (const string& aFile, int width = 25);
       int       writeHex                  (ostream& out,        int width = 25);
@@ -75,6 +105,8 @@ class MidiFile {
       int       writeBinascWithComments   (const string& aFile);
       int       writeBinascWithComments   (ostream& out);
       int       status                    (void);
+      void      setReadThreads            (int count);
+      int       getReadThreads            (void);
 
       // track-related functions:
       MidiEventList& operator[]           (int aTrack);
@@ -82,6 +114,7 @@ class MidiFile {
       int       getTrackCount             (void) const;
       int       getNumTracks              (void) const;
       int       size                      (void) const;
+      const MidiEventArena& getArena      (void) const;
 
       // join/split track functionality:
       void      markSequence              (void);
@@ -127,7 +160,10 @@ class MidiFile {
       void      doTimeAnalysis            (void);
       double    getTimeInSeconds          (int aTrack, int anIndex);
       double    getTimeInSeconds          (int tickvalue);
+      void      getTimeInSeconds          (const vector<int>& ticks,
+                                           vector<double>& seconds);
       int       getAbsoluteTickTime       (double starttime);
+      int       getTempoSegmentCount      (void);
 
       double    getTotalTimeInSeconds     (void);
       int       getTotalTimeInTicks       (void);
@@ -194,6 +230,15 @@ class MidiFile {
       static uchar    readByte                (istream& input);
       static ushort   readLittleEndian2Bytes  (istream& input);
       static ulong    readLittleEndian4Bytes  (istream& input);
+      static ushort   readLittleEndian2Bytes  (const uchar* data);
+      static ulong    readLittleEndian4Bytes  (const uchar* data);
+      static int      readVLValue             (const uchar*& ptr,
+                                               const uchar* end,
+                                               ulong& value);
+      static int      extractMidiData         (const uchar*& ptr,
+                                               const uchar* end,
+                                               MidiMessage& array,
+                                               uchar& runningCommand);
       static ostream& writeLittleEndianUShort (ostream& out, ushort value);
       static ostream& writeBigEndianUShort    (ostream& out, ushort value);
       static ostream& writeLittleEndianShort  (ostream& out, short  value);
@@ -214,23 +259,32 @@ class MidiFile {
       int              theTrackState;            // joined or split
       int              theTimeState;             // absolute or delta
       vector<char>     readFileName;             // read file name
+      int              readThreads;              // track decoding threads
+      MidiEventArena*  arena;                    // owner of all events
 
-      int               timemapvalid;
-      vector<_TickTime> timemap;
-      int               rwstatus;                // read/write success flag
+      int                   timemapvalid;
+      vector<_TempoSegment> tempomap;
+      int                   rwstatus;            // read/write success flag
 
    private:
-      int        extractMidiData  (istream& inputfile, vector<uchar>& array,
-                                       uchar& runningCommand);
-      ulong      readVLValue      (istream& inputfile);
-      ulong      unpackVLV        (uchar a, uchar b, uchar c, uchar d, uchar e);
+      int        readTrack        (const uchar*& ptr, const uchar* end,
+                                   int track, MidiEventArena& eventArena);
+      int        readTracksParallel(const uchar* ptr, const uchar* end,
+                                   int tracks);
+      int        checkChunkId     (const uchar*& ptr, const uchar* end,
+                                   const char* id, const char* location);
+      static ulong unpackVLV      (uchar a, uchar b, uchar c, uchar d,
+                                   uchar e);
       void       writeVLValue     (long aValue, vector<uchar>& data);
+      static uchar* writeVLValue  (long aValue, uchar* ptr);
+      static int getVLValueSize   (long aValue);
+      size_t     getTrackDataSize (int track);
+      static uchar* writeBigEndian(uchar* ptr, ulong value, int count);
       int        makeVLV          (uchar *buffer, int number);
-      static int ticksearch       (const void* A, const void* B);
-      static int secondsearch     (const void* A, const void* B);
+      static int getSortKey       (const MidiEvent& event,
+                                   unsigned long long& key);
       void       buildTimeMap     (void);
-      int        linearTickInterpolationAtSecond  (double seconds);
-      double     linearSecondInterpolationAtTick  (int ticktime);
+      int        findTempoSegment (int tick, int hint);
 };
 
 
@@ -2,13 +2,17 @@
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Feb 14 20:36:32 PST 2015
 // Last Modified: Sun Feb 15 20:32:19 PST 2015
+// Last Modified: Fri Oct 16 13:05:51 PDT 2026 Inline storage for short messages.
 // Filename:      midifile/include/MidiMessage.h
 // Website:       http://midifile.sapp.org
 // Syntax:        C++11
 // vim:           ts=3 expandtab
 //
 // Description:   Storage for bytes of a MIDI message for use in MidiFile
-//                class.
+//                class.  Messages of up to eight bytes (all channel
+//                messages and the common meta messages) are stored inside
+//                of the object; only longer meta and sysex messages
+//                allocate separate storage on the heap.
 //
 
 #ifndef _MIDIMESSAGE_H_INCLUDED
@@ -23,13 +27,18 @@ typedef unsigned char  uchar;
 typedef unsigned short ushort;
 typedef unsigned long  ulong;
 
-class MidiMessage : public vector<uchar> {
+class MidiMessage {
 	public:
+      typedef uchar        value_type;
+      typedef uchar*       iterator;
+      typedef const uchar* const_iterator;
+
 		               MidiMessage          (void);
 		               MidiMessage          (int command);
 		               MidiMessage          (int command, int p1);
 		               MidiMessage          (int command, int p1, int p2);
                      MidiMessage          (const MidiMessage& message);
+                     MidiMessage          (MidiMessage&& message);
                      MidiMessage          (const vector<uchar>& message);
                      MidiMessage          (const vector<char>& message);
                      MidiMessage          (const vector<int>& message);
@@ -37,9 +46,34 @@ class MidiMessage : public vector<uchar> {
                     ~MidiMessage         ();
 
       MidiMessage&   operator=            (const MidiMessage& message);
+      MidiMessage&   operator=            (MidiMessage&& message);
       MidiMessage&   operator=            (const vector<uchar>& bytes);
       MidiMessage&   operator=            (const vector<char>& bytes);
       MidiMessage&   operator=            (const vector<int>& bytes);
+
+      // byte storage (same interface as vector<uchar>):
+      size_t         size                 (void) const { return bytecount; }
+      int            empty                (void) const { return bytecount == 0; }
+      size_t         capacity             (void) const;
+      void           resize               (size_t asize);
+      void           reserve              (size_t asize);
+      void           clear                (void) { bytecount = 0; }
+      uchar*         data                 (void) { return isInline() ? storage.local : storage.heap; }
+      const uchar*   data                 (void) const { return isInline() ? storage.local : storage.heap; }
+      uchar&         operator[]           (size_t index) { return data()[index]; }
+      const uchar&   operator[]           (size_t index) const { return data()[index]; }
+      iterator       begin                (void) { return data(); }
+      iterator       end                  (void) { return data() + bytecount; }
+      const_iterator begin                (void) const { return data(); }
+      const_iterator end                  (void) const { return data() + bytecount; }
+      uchar&         back                 (void) { return data()[bytecount-1]; }
+      const uchar&   back                 (void) const { return data()[bytecount-1]; }
+      void           push_back            (const uchar& value);
+      void           append               (const uchar* first, const uchar* last);
+      void           assign               (const uchar* first, const uchar* last);
+      int            isInline             (void) const { return bytecapacity <= INLINE_SIZE; }
+      void           setStorage           (uchar* buffer, size_t asize);
+
       void           setSize              (int asize);
       int            getSize              (void) const;
       int            setSizeToCommand     (void);
@@ -125,6 +159,18 @@ class MidiMessage : public vector<uchar> {
       void           setMetaTempo         (double tempo);
       int            isEndOfTrack         (void) const;
 
+   private:
+      enum { INLINE_SIZE = 8 };   // largest message stored in the object
+      union {
+         uchar  local[INLINE_SIZE];
+         uchar* heap;
+      } storage;
+      unsigned int   bytecount;          // number of bytes in message
+      unsigned int   bytecapacity : 31;  // INLINE_SIZE or size of heap block
+      unsigned int   borrowed     : 1;   // heap block is owned elsewhere
+
+      void           grow                 (size_t asize);
+
 };
 
 
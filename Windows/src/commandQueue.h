@@ -0,0 +1,139 @@
+/**
+ * File: commandQueue.h
+ * --------------------
+ * A fixed size ring of synthesizer
+ * commands with one writer and one
+ * reader. Neither side takes a lock or
+ * waits, so the GUI thread can hand
+ * notes to the audio thread freely.
+ */
+
+#pragma once
+#include <atomic>
+#include <stdint.h>
+
+// kinds of queued synth commands
+enum SynthCommandType {
+  SYNTH_NOTE_ON,
+  SYNTH_NOTE_OFF,
+  SYNTH_CONTROL,
+  SYNTH_PROGRAM,
+  SYNTH_PITCH_BEND,
+  SYNTH_GAIN
+};
+
+/**
+ * Type: SynthCommand
+ * ------------------
+ * One queued call. Bends are stored
+ * as the final 14 bit wheel value and
+ * gains in value. The capture time
+ * places the command within a block.
+ */
+struct SynthCommand {
+  uint8_t type;
+  uint8_t channel;
+  uint8_t dataOne; // key, controller or program
+  uint8_t dataTwo; // velocity or control value
+  float value; // bend or gain
+  int64_t time; // microseconds, 0 for right away
+};
+
+// single producer single consumer ring
+class CommandQueue {
+  public:
+    // must be a power of two
+    static const uint32_t CAPACITY = 1024;
+    // slots only note offs may fill
+    static const uint32_t RELEASE_RESERVE = 64;
+
+    CommandQueue() : head(0), tail(0), overflows(0), peak(0) {}
+
+    /**
+     * Function: push
+     * --------------
+     * Writer side. A full ring drops
+     * the command and counts it. The
+     * last reserve slots are left free.
+     */
+    bool push(const SynthCommand& command, uint32_t reserve = 0) {
+      uint32_t back = tail.load(std::memory_order_relaxed);
+      uint32_t depth = back - head.load(std::memory_order_acquire);
+
+      if (depth + reserve >= CAPACITY) {
+        overflows.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+
+      ring[back & (CAPACITY - 1)] = command;
+      tail.store(back + 1, std::memory_order_release);
+      if (depth + 1 > peak.load(std::memory_order_relaxed))
+        peak.store(depth + 1, std::memory_order_relaxed);
+      return true;
+    }
+
+    /**
+     * Function: push
+     * --------------
+     * Writes a whole batch and then
+     * publishes it at once, so the reader
+     * sees all of it or none of it. A
+     * batch that does not fit is dropped.
+     */
+    bool push(const SynthCommand* batch, uint32_t count, uint32_t reserve = 0) {
+      uint32_t back = tail.load(std::memory_order_relaxed);
+      uint32_t depth = back - head.load(std::memory_order_acquire);
+
+      if (depth + reserve + count > CAPACITY) {
+        overflows.fetch_add(count, std::memory_order_relaxed);
+        return false;
+      }
+
+      for (uint32_t i = 0; i < count; i += 1)
+        ring[(back + i) & (CAPACITY - 1)] = batch[i];
+      tail.store(back + count, std::memory_order_release);
+      if (depth + count > peak.load(std::memory_order_relaxed))
+        peak.store(depth + count, std::memory_order_relaxed);
+      return true;
+    }
+
+    /**
+     * Function: pop
+     * -------------
+     * Reader side. False once the
+     * ring is empty.
+     */
+    bool pop(SynthCommand& command) {
+      uint32_t front = head.load(std::memory_order_relaxed);
+      if (front == tail.load(std::memory_order_acquire)) return false;
+
+      command = ring[front & (CAPACITY - 1)];
+      head.store(front + 1, std::memory_order_release);
+      return true;
+    }
+
+    // counters readable from any thread
+    uint32_t depth() const {
+      uint32_t front = head.load(std::memory_order_acquire); // head first so
+      return tail.load(std::memory_order_acquire) - front; // this never wraps
+    }
+    uint32_t overflowCount() const { return overflows.load(std::memory_order_relaxed); }
+    uint32_t peakDepth() const { return peak.load(std::memory_order_relaxed); }
+
+  private:
+    SynthCommand ring[CAPACITY];
+
+    // each index on its own cache line [padded
+    // rather than aligned so new works in C++11]
+    char ringPad[64];
+    std::atomic<uint32_t> head; // next to read
+    char headPad[64];
+    std::atomic<uint32_t> tail; // next to write
+    char tailPad[64];
+    std::atomic<uint32_t> overflows;
+    std::atomic<uint32_t> peak; // written by the producer only
+
+    // shared between two threads
+    CommandQueue(const CommandQueue& other);
+    CommandQueue& operator=(const CommandQueue& other);
+};
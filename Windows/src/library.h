@@ -0,0 +1,68 @@
+/**
+ * File: library.h
+ * ---------------
+ * An index of the MIDI songs in a
+ * folder, saved to disk so a rescan
+ * only opens files that changed.
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+/**
+ * Type: SongInfo
+ * --------------
+ * What the index knows about
+ * a song without opening it.
+ */
+struct SongInfo {
+  string path;
+  uint64_t size;
+  int64_t mtime;
+  uint64_t hash; // same hash as the song cache
+
+  // extracted from the MIDI
+  double duration; // in seconds
+  int chordCount;
+  int lowNote;
+  int highNote;
+  int trackCount;
+};
+
+// fields songs can be sorted by
+enum SongField {
+  SONG_PATH,
+  SONG_DURATION,
+  SONG_CHORDS,
+  SONG_LOW_NOTE,
+  SONG_HIGH_NOTE,
+  SONG_TRACKS
+};
+
+// persistent song library
+class Library {
+  public:
+    // index file round trip
+    bool load(const string& indexName);
+    bool save(const string& indexName) const;
+
+    // returns number of songs examined
+    int scan(const string& dirName, int threads = 0);
+
+    // sorting and filtering by metadata
+    void sortSongs(SongField field, bool descending = false);
+    void getPaths(vector<string>& list) const;
+    void getPaths(vector<string>& list, bool (*keep)(const SongInfo&)) const;
+
+    const vector<SongInfo>& getSongs() const { return songs; }
+    int size() const { return songs.size(); }
+
+    static bool examine(SongInfo& info, const SongInfo* previous = NULL);
+
+  private:
+    vector<SongInfo> songs;
+};
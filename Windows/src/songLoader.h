@@ -0,0 +1,53 @@
+/**
+ * File: songLoader.h
+ * ------------------
+ * Builds the selected song and the
+ * next few in the playlist on a worker
+ * thread so starting a playthrough
+ * never parses on the GUI thread.
+ */
+
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "song.h"
+using namespace std;
+
+// background song prefetcher
+class SongLoader {
+  public:
+    SongLoader();
+    ~SongLoader();
+
+    // queue a selection and its successors
+    void select(const vector<string>& files, int index, int lookahead = 2);
+    bool take(const string& fileName, Song& song);
+    bool isReady(const string& fileName);
+
+  private:
+    void run();
+
+    // worker and its wakeups
+    thread worker;
+    mutex loaderLock;
+    condition_variable wake;
+    condition_variable finished;
+    bool stopping;
+
+    // songs to build, being built, and built
+    deque<string> pending;
+    string building;
+    set<string> wanted;
+    map<string, Song> ready;
+
+    // the worker holds pointers to this
+    SongLoader(const SongLoader& other);
+    SongLoader& operator=(const SongLoader& other);
+};
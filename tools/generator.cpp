@@ -0,0 +1,240 @@
+/**
+ * File: generator.cpp
+ * -------------------
+ * Builds synthetic songs through the
+ * MidiFile convenience functions: a
+ * conductor track with tempo changes
+ * and sysex, then note tracks that
+ * random walk over the keyboard with
+ * chords and controller sweeps. The
+ * random numbers come from our own
+ * generator so every platform makes
+ * identical files.
+ */
+
+#include "generator.h"
+#include <algorithm>
+#include <cstring>
+using namespace std;
+
+const GeneratorPreset generatorPresets[] = {
+  { "1k", 1000, 2 },
+  { "10k", 10000, 4 },
+  { "100k", 100000, 8 },
+  { "1M", 1000000, 16 },
+  { "10M", 10000000, 16 }
+};
+
+const int generatorPresetCount = sizeof(generatorPresets) / sizeof(generatorPresets[0]);
+
+/**
+ * Type: Random
+ * ------------
+ * Small xorshift generator, since
+ * rand differs between platforms.
+ */
+class Random {
+  public:
+    Random(uint32_t seed) : state(seed ? seed : 0x9e3779b9) {}
+
+    uint32_t next() {
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+      return state;
+    }
+
+    // in [low, high]
+    int range(int low, int high) {
+      return low + next() % (uint32_t) (high - low + 1);
+    }
+
+  private:
+    uint32_t state;
+};
+
+/**
+ * Function: getPreset
+ * -------------------
+ * Fills in settings for a named size,
+ * with the other knobs at defaults.
+ */
+bool getPreset(const string& name, GeneratorSettings& settings) {
+  for (int i = 0; i < generatorPresetCount; i += 1) {
+    if (name != generatorPresets[i].name) continue;
+
+    settings.seed = 1;
+    settings.events = generatorPresets[i].events;
+    settings.tracks = generatorPresets[i].tracks;
+    settings.tpq = 480;
+    settings.density = 4;
+    settings.tempoChanges = max(settings.events / 1000, 1);
+    settings.controllerEvery = 16;
+    settings.sysexCount = 4;
+    settings.runningStatus = false;
+    return true;
+  }
+
+  return false;
+}
+
+/**
+ * Function: generateMidi
+ * ----------------------
+ * Replaces the contents of midi with
+ * a synthetic song. Tracks come out
+ * sorted and in absolute ticks.
+ */
+void generateMidi(MidiFile& midi, const GeneratorSettings& settings) {
+  Random random(settings.seed);
+  int tracks = max(settings.tracks, 2);
+  int noteTracks = tracks - 1;
+
+  midi.clear();
+  midi.absoluteTicks();
+  midi.setTicksPerQuarterNote(settings.tpq);
+  midi.addTrack(noteTracks);
+
+  // each note is an on and an off, plus the odd controller
+  double perNote = 2.0 + (settings.controllerEvery ? 1.0 / settings.controllerEvery : 0.0);
+  int budget = settings.events - settings.tempoChanges - settings.sysexCount;
+  int notesPerTrack = max((int) (budget / perNote / noteTracks), 1);
+
+  // chords land on a grid, so the song length follows from the density
+  int step = max(settings.tpq / max(settings.density, 1), 1);
+  int lastTick = 0;
+
+  for (int track = 1; track <= noteTracks; track += 1) {
+    int channel = (track - 1) % 16;
+    int key = random.range(48, 72);
+    int tick = 0;
+
+    for (int note = 0; note < notesPerTrack; ) {
+      // most onsets are single notes, some are chords
+      int chordSize = (random.next() % 4 == 0) ? random.range(2, 4) : 1;
+      for (int i = 0; i < chordSize && note < notesPerTrack; i += 1, note += 1) {
+        key = min(max(key + random.range(-5, 5), 21), 108);
+        int length = step * random.range(1, 4) - 1;
+        midi.addNoteOn(track, tick, channel, key, random.range(40, 110));
+        if (settings.runningStatus) midi.addNoteOff(track, tick + length, channel, key);
+        else midi.addNoteOff(track, tick + length, channel, key, 64);
+
+        if (settings.controllerEvery && (note + 1) % settings.controllerEvery == 0)
+          midi.addController(track, tick, channel, (note & 1) ? 7 : 11, random.range(0, 127));
+      }
+
+      lastTick = max(lastTick, tick + 4 * step);
+      tick += step * random.range(1, 2);
+    }
+  }
+
+  // conductor track spreads tempo changes and sysex over the song
+  for (int i = 0; i < settings.tempoChanges; i += 1)
+    midi.addTempo(0, (long long) lastTick * i / settings.tempoChanges, random.range(60, 180));
+
+  for (int i = 0; i < settings.sysexCount; i += 1) {
+    vector<uchar> sysex;
+    sysex.push_back(0xf0);
+    sysex.push_back(0x7d); // non-commercial id
+    for (int j = random.range(2, 32); j > 0; j -= 1)
+      sysex.push_back(random.range(0, 127));
+    sysex.push_back(0xf7);
+    midi.addEvent(0, (long long) lastTick * i / max(settings.sysexCount, 1), sysex);
+  }
+
+  midi.sortTracks();
+}
+
+/**
+ * Function: writeGenerated
+ * ------------------------
+ * Writes a generated song to bytes,
+ * packing running status if asked to.
+ */
+bool writeGenerated(MidiFile& midi, const GeneratorSettings& settings, vector<uchar>& bytes) {
+  if (!midi.write(bytes)) return false;
+  if (settings.runningStatus) packRunningStatus(bytes);
+  return true;
+}
+
+/**
+ * Function: copyVLV
+ * -----------------
+ * Copies a variable length value and
+ * returns it, or -1 past the end.
+ */
+static long copyVLV(const uchar*& in, const uchar* end, uchar*& out) {
+  long value = 0;
+  for (int i = 0; i < 5 && in < end; i += 1) {
+    uchar byte = *in++;
+    *out++ = byte;
+    value = (value << 7) | (byte & 0x7f);
+    if (!(byte & 0x80)) return value;
+  }
+
+  return -1;
+}
+
+/**
+ * Function: packRunningStatus
+ * ---------------------------
+ * The MidiFile writer always spells out
+ * status bytes. This drops repeated
+ * channel status bytes from every track
+ * in place, as most sequencers do, and
+ * returns the number of bytes saved.
+ * Sysex and meta messages cancel the
+ * running status.
+ */
+size_t packRunningStatus(vector<uchar>& bytes) {
+  if (bytes.size() < 14) return 0;
+  const uchar* in = bytes.data() + 14;
+  const uchar* fileEnd = bytes.data() + bytes.size();
+  uchar* out = bytes.data() + 14;
+
+  while (in + 8 <= fileEnd) {
+    size_t length = ((size_t) in[4] << 24) | (in[5] << 16) | (in[6] << 8) | in[7];
+    if (in + 8 + length > fileEnd) break;
+
+    uchar* chunk = out;
+    memmove(out, in, 8);
+    in += 8;
+    out += 8;
+
+    const uchar* end = in + length;
+    uchar running = 0;
+    while (in < end) {
+      if (copyVLV(in, end, out) < 0 || in >= end) break;
+      uchar command = *in++;
+
+      if (command == 0xff || command == 0xf0 || command == 0xf7) {
+        *out++ = command;
+        if (command == 0xff && in < end) *out++ = *in++; // meta type
+        long size = copyVLV(in, end, out);
+        if (size < 0 || in + size > end) break;
+        memmove(out, in, size);
+        in += size;
+        out += size;
+        running = 0;
+        continue;
+      }
+
+      int dataBytes = ((command & 0xf0) == 0xc0 || (command & 0xf0) == 0xd0) ? 1 : 2;
+      if (command != running) *out++ = command;
+      running = command;
+      for (int i = 0; i < dataBytes && in < end; i += 1)
+        *out++ = *in++;
+    }
+
+    in = end;
+    size_t packed = out - chunk - 8;
+    chunk[4] = (packed >> 24) & 0xff;
+    chunk[5] = (packed >> 16) & 0xff;
+    chunk[6] = (packed >> 8) & 0xff;
+    chunk[7] = packed & 0xff;
+  }
+
+  size_t saved = bytes.size() - (out - bytes.data());
+  bytes.resize(out - bytes.data());
+  return saved;
+}
@@ -0,0 +1,53 @@
+/**
+ * File: generator.h
+ * -----------------
+ * Deterministic synthetic MIDI files
+ * for measuring the MIDI library at
+ * sizes the bundled songs never reach.
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "MIDI/MidiFile.h"
+using namespace std;
+
+/**
+ * Type: GeneratorSettings
+ * -----------------------
+ * Shape of a generated file. The same
+ * settings always give the same bytes.
+ */
+struct GeneratorSettings {
+  uint32_t seed;
+  int events; // roughly, across all tracks
+  int tracks; // track 0 is the conductor track
+  int tpq; // ticks per quarter note
+  int density; // note ons per quarter note per track
+  int tempoChanges;
+  int controllerEvery; // notes between controllers, 0 for none
+  int sysexCount;
+  bool runningStatus; // note offs as zero velocity note ons, packed
+};
+
+/**
+ * Type: GeneratorPreset
+ * ---------------------
+ * A named size for benchmarks.
+ */
+struct GeneratorPreset {
+  const char* name;
+  int events;
+  int tracks;
+};
+
+// presets from 1k to 10M events
+extern const GeneratorPreset generatorPresets[];
+extern const int generatorPresetCount;
+
+bool getPreset(const string& name, GeneratorSettings& settings);
+void generateMidi(MidiFile& midi, const GeneratorSettings& settings);
+bool writeGenerated(MidiFile& midi, const GeneratorSettings& settings, vector<uchar>& bytes);
+size_t packRunningStatus(vector<uchar>& bytes);
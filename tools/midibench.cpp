@@ -0,0 +1,427 @@
+/**
+ * File: midibench.cpp
+ * -------------------
+ * Times every MidiFile stage on the
+ * synthetic presets and records the
+ * peak memory of the process after
+ * each one. Each preset runs in its
+ * own child process where fork is
+ * available, so peaks do not carry
+ * over from larger presets. Given MIDI
+ * files instead, it times reading them
+ * on one thread and on several, and
+ * writing them with the current writer
+ * and the per-event stream writer it
+ * replaced.
+ *
+ * Not part of the app. Build it from
+ * this folder with the MIDI library:
+ *   g++ -std=c++11 -O2 -pthread -I../OSX/src -o midibench
+ *     midibench.cpp generator.cpp ../OSX/src/MIDI/[A-Z]*.cpp
+ *
+ * Usage
+ *   midibench [-p 1k,10k,...|all] [-r repeats] [-j read threads] [--tsv]
+ *   midibench [-r repeats] [-j read threads] [--tsv] files.mid...
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "generator.h"
+#include "MIDI/Options.h"
+using namespace std;
+using namespace std::chrono;
+
+/**
+ * Function: getPeakMemory
+ * -----------------------
+ * Peak resident size of this
+ * process in megabytes.
+ */
+static double getPeakMemory() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0.0;
+  return counters.PeakWorkingSetSize / 1048576.0;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0.0;
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1048576.0; // bytes
+#else
+  return usage.ru_maxrss / 1024.0; // kilobytes
+#endif
+#endif
+}
+
+/**
+ * Type: Bench
+ * -----------
+ * Settings shared by every stage.
+ */
+struct Bench {
+  int repeats;
+  bool tsv;
+  string preset;
+  int width; // of the preset column
+  int events;
+};
+
+/**
+ * Function: report
+ * ----------------
+ * Prints one stage's row.
+ */
+static void report(const Bench& bench, const string& stage, double milliseconds) {
+  double rate = milliseconds > 0.0 ? bench.events / milliseconds / 1000.0 : 0.0;
+  if (bench.tsv) {
+    cout << bench.preset << "\t" << stage << "\t" << fixed << setprecision(3)
+      << milliseconds << "\t" << rate << "\t" << getPeakMemory() << endl;
+    return;
+  }
+
+  cout << setw(bench.width) << bench.preset << "  " << left << setw(20) << stage << right
+    << fixed << setprecision(3) << setw(12) << milliseconds << " ms"
+    << setprecision(2) << setw(10) << rate << " M events/s"
+    << setprecision(1) << setw(10) << getPeakMemory() << " MB peak" << endl;
+}
+
+/**
+ * Function: timeStage
+ * -------------------
+ * Runs a stage the requested number of
+ * times and reports the fastest run.
+ * The setup step prepares fresh input
+ * before each run and is not timed.
+ */
+template <typename Setup, typename Stage>
+static void timeStage(const Bench& bench, const string& name, Setup setup, Stage stage) {
+  double best = -1.0;
+  for (int i = 0; i < bench.repeats; i += 1) {
+    setup();
+    steady_clock::time_point start = steady_clock::now();
+    stage();
+    double elapsed = duration<double, milli>(steady_clock::now() - start).count();
+    if (best < 0.0 || elapsed < best) best = elapsed;
+  }
+
+  report(bench, name, best);
+}
+
+/**
+ * Function: appendVLV
+ * -------------------
+ * Variable length value as the
+ * previous writer encoded it.
+ */
+static void appendVLV(ulong value, vector<uchar>& data) {
+  uchar bytes[5];
+  bytes[0] = (value >> 28) & 0x7f;
+  bytes[1] = (value >> 21) & 0x7f;
+  bytes[2] = (value >> 14) & 0x7f;
+  bytes[3] = (value >> 7) & 0x7f;
+  bytes[4] = value & 0x7f;
+
+  int start = 0;
+  while (start < 5 && bytes[start] == 0) start += 1;
+  for (int i = start; i < 4; i += 1) data.push_back(bytes[i] | 0x80);
+  data.push_back(bytes[4]);
+}
+
+/**
+ * Function: writeByEvent
+ * ----------------------
+ * The writer MidiFile had before it
+ * encoded into one buffer: each track
+ * is pushed into a scratch vector byte
+ * by byte after switching the file to
+ * delta ticks, and the header fields go
+ * out through the stream one character
+ * at a time. Kept to measure against.
+ */
+static void writeByEvent(MidiFile& midi, ostream& out) {
+  bool absolute = midi.getTickState() == TIME_STATE_ABSOLUTE;
+  if (absolute) midi.deltaTicks();
+
+  int tracks = midi.getNumTracks();
+  out << 'M' << 'T' << 'h' << 'd';
+  MidiFile::writeBigEndianULong(out, 6);
+  MidiFile::writeBigEndianUShort(out, tracks == 1 ? 0 : 1);
+  MidiFile::writeBigEndianUShort(out, tracks);
+  MidiFile::writeBigEndianUShort(out, midi.getTicksPerQuarterNote());
+
+  vector<uchar> data;
+  for (int track = 0; track < tracks; track += 1) {
+    data.reserve(123456);
+    data.clear();
+    for (int i = 0; i < midi[track].size(); i += 1) {
+      const MidiEvent& event = midi[track][i];
+      if (event.isEndOfTrack()) continue;
+
+      appendVLV(event.tick, data);
+      int command = event.getCommandByte();
+      int size = (int) event.size();
+      if (command == 0xf0 || command == 0xf7) {
+        data.push_back(event[0]);
+        appendVLV(size - 1, data);
+        for (int k = 1; k < size; k += 1) data.push_back(event[k]);
+      } else {
+        for (int k = 0; k < size; k += 1) data.push_back(event[k]);
+      }
+    }
+
+    int size = (int) data.size();
+    if (size < 3 || data[size - 3] != 0xff || data[size - 2] != 0x2f) {
+      data.push_back(0x00);
+      data.push_back(0xff);
+      data.push_back(0x2f);
+      data.push_back(0x00);
+    }
+
+    out << 'M' << 'T' << 'r' << 'k';
+    MidiFile::writeBigEndianULong(out, data.size());
+    out.write((const char*) data.data(), data.size());
+  }
+
+  if (absolute) midi.absoluteTicks();
+}
+
+/**
+ * Function: timeWriters
+ * ---------------------
+ * Times the current and previous
+ * writers into a string stream, the
+ * way files are exported. False if
+ * their bytes differ.
+ */
+static bool timeWriters(const Bench& bench, MidiFile& midi) {
+  ostringstream current, previous;
+  timeStage(bench, "write stream", [&] { current.str(""); }, [&] { midi.write(current); });
+  timeStage(bench, "write by event", [&] { previous.str(""); },
+    [&] { writeByEvent(midi, previous); });
+  return current.str() == previous.str();
+}
+
+/**
+ * Function: runPreset
+ * -------------------
+ * Benchmarks one preset from generation
+ * through reading, analysis, joining,
+ * splitting and writing.
+ */
+static void runPreset(Bench& bench, int readThreads) {
+  GeneratorSettings settings;
+  getPreset(bench.preset, settings);
+  auto nothing = [] {};
+
+  // count the events once so every stage reports a rate
+  MidiFile midi;
+  generateMidi(midi, settings);
+  bench.events = 0;
+  for (int track = 0; track < midi.getTrackCount(); track += 1)
+    bench.events += midi.getEventCount(track);
+
+  timeStage(bench, "generate", nothing, [&] { generateMidi(midi, settings); });
+
+  vector<uchar> bytes;
+  timeStage(bench, "write", [&] { bytes.clear(); }, [&] { midi.write(bytes); });
+  if (!timeWriters(bench, midi)) cerr << "Previous writer output differs." << endl;
+
+  vector<uchar> packed;
+  GeneratorSettings running = settings;
+  running.runningStatus = true;
+  MidiFile runningMIDI;
+  generateMidi(runningMIDI, running);
+  writeGenerated(runningMIDI, running, packed);
+  runningMIDI.clear();
+
+  MidiFile loaded;
+  timeStage(bench, "read", nothing, [&] { loaded.read(bytes.data(), bytes.size()); });
+  timeStage(bench, "read running status", nothing,
+    [&] { loaded.read(packed.data(), packed.size()); });
+
+  if (readThreads > 1) {
+    ostringstream name;
+    name << "read " << readThreads << " threads";
+    loaded.setReadThreads(readThreads);
+    timeStage(bench, name.str(), nothing, [&] { loaded.read(bytes.data(), bytes.size()); });
+    loaded.setReadThreads(1);
+  }
+
+  // later stages each start from a freshly read file
+  auto fresh = [&] { loaded.read(bytes.data(), bytes.size()); };
+  timeStage(bench, "linkNotePairs", fresh, [&] { loaded.linkNotePairs(); });
+  timeStage(bench, "doTimeAnalysis", fresh, [&] { loaded.doTimeAnalysis(); });
+  timeStage(bench, "joinTracks", fresh, [&] { loaded.joinTracks(); });
+  timeStage(bench, "splitTracks", [&] { fresh(); loaded.joinTracks(); },
+    [&] { loaded.splitTracks(); });
+  timeStage(bench, "write after join", [&] { fresh(); loaded.joinTracks(); bytes.clear(); },
+    [&] { loaded.write(bytes); });
+}
+
+/**
+ * Function: runCorpus
+ * -------------------
+ * Times reading each file serially and
+ * with its tracks decoded on several
+ * threads, then the whole set. Both
+ * reads must write back the same bytes,
+ * as must the two writers.
+ */
+static bool runCorpus(Bench& bench, const vector<string>& files, int readThreads) {
+  if (readThreads <= 0) readThreads = max((int) thread::hardware_concurrency(), 1);
+  ostringstream threaded;
+  threaded << "read " << readThreads << " threads";
+
+  // rows are labelled without the folder
+  vector<string> names(files.size());
+  for (int i = 0; i < (int) files.size(); i += 1) {
+    size_t slash = files[i].find_last_of("/\\");
+    names[i] = slash == string::npos ? files[i] : files[i].substr(slash + 1);
+    bench.width = max(bench.width, (int) names[i].size());
+  }
+
+  vector<vector<uchar> > contents(files.size());
+  int totalEvents = 0;
+  for (int i = 0; i < (int) files.size(); i += 1) {
+    ifstream input(files[i].c_str(), ios::binary);
+    contents[i].assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+
+    MidiFile serial, parallel;
+    parallel.setReadThreads(readThreads);
+    vector<uchar> serialBytes, parallelBytes;
+    if (!serial.read(contents[i].data(), contents[i].size()) ||
+        !parallel.read(contents[i].data(), contents[i].size())) {
+      cerr << "Could not read " << files[i] << "." << endl;
+      return false;
+    }
+
+    serial.write(serialBytes);
+    parallel.write(parallelBytes);
+    if (serialBytes != parallelBytes) {
+      cerr << "Threaded read of " << files[i] << " differs." << endl;
+      return false;
+    }
+
+    bench.preset = names[i];
+    bench.events = 0;
+    for (int track = 0; track < serial.getTrackCount(); track += 1)
+      bench.events += serial.getEventCount(track);
+    totalEvents += bench.events;
+
+    auto nothing = [] {};
+    timeStage(bench, "read", nothing,
+      [&] { serial.read(contents[i].data(), contents[i].size()); });
+    timeStage(bench, threaded.str(), nothing,
+      [&] { parallel.read(contents[i].data(), contents[i].size()); });
+    if (!timeWriters(bench, serial)) {
+      cerr << "Previous writer output of " << files[i] << " differs." << endl;
+      return false;
+    }
+  }
+
+  // the set as a library scan would load it
+  MidiFile serial, parallel;
+  parallel.setReadThreads(readThreads);
+  bench.preset = "all";
+  bench.events = totalEvents;
+  timeStage(bench, "read", [] {}, [&] {
+    for (int i = 0; i < (int) contents.size(); i += 1)
+      serial.read(contents[i].data(), contents[i].size());
+  });
+  timeStage(bench, threaded.str(), [] {}, [&] {
+    for (int i = 0; i < (int) contents.size(); i += 1)
+      parallel.read(contents[i].data(), contents[i].size());
+  });
+  return true;
+}
+
+/**
+ * Function: main
+ * --------------
+ * Runs the chosen presets in order
+ * of size.
+ */
+int main(int argc, char** argv) {
+  Options options;
+  options.define("p|presets=s:1k,10k,100k,1M", "comma separated presets, or all");
+  options.define("r|repeats=i:3", "runs per stage, the fastest is kept");
+  options.define("j|read-threads=i:0", "also time reading on this many threads");
+  options.define("tsv=b", "tab separated output");
+  options.process(argc, argv);
+
+  vector<string> presets;
+  string list = options.getString("presets");
+  if (list == "all") {
+    for (int i = 0; i < generatorPresetCount; i += 1)
+      presets.push_back(generatorPresets[i].name);
+  } else {
+    stringstream names(list);
+    string name;
+    while (getline(names, name, ','))
+      if (name.size()) presets.push_back(name);
+  }
+
+  Bench bench;
+  bench.repeats = max(options.getInteger("repeats"), 1);
+  bench.tsv = options.getBoolean("tsv");
+  bench.width = 6;
+  bench.events = 0;
+
+  if (options.getArgCount() > 0) {
+    vector<string> files;
+    for (int i = 1; i <= options.getArgCount(); i += 1)
+      files.push_back(options.getArg(i));
+    if (bench.tsv) cout << "file\tstage\tms\tMevents/s\tpeakMB" << endl;
+    return runCorpus(bench, files, options.getInteger("read-threads")) ? 0 : 1;
+  }
+
+  GeneratorSettings settings;
+  for (int i = 0; i < (int) presets.size(); i += 1) {
+    if (!getPreset(presets[i], settings)) {
+      cerr << "Unknown preset " << presets[i] << "." << endl;
+      return 2;
+    }
+  }
+
+  if (bench.tsv) cout << "preset\tstage\tms\tMevents/s\tpeakMB" << endl;
+  for (int i = 0; i < (int) presets.size(); i += 1) {
+    bench.preset = presets[i];
+#ifdef _WIN32
+    runPreset(bench, options.getInteger("read-threads"));
+#else
+    cout.flush();
+    pid_t child = fork();
+    if (child == 0) {
+      runPreset(bench, options.getInteger("read-threads"));
+      cout.flush();
+      _exit(0);
+    }
+
+    int status = 0;
+    if (child < 0 || waitpid(child, &status, 0) < 0 || !WIFEXITED(status)) {
+      cerr << "Preset " << presets[i] << " did not finish." << endl;
+      return 1;
+    }
+#endif
+  }
+
+  return 0;
+}
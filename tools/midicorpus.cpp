@@ -0,0 +1,445 @@
+/**
+ * File: midicorpus.cpp
+ * --------------------
+ * Headless tool that runs a whole
+ * folder of MIDI files through the
+ * song pipeline on a work stealing
+ * thread pool. Each file is parsed,
+ * linked and time analyzed, and then
+ * its stats are printed, it is checked
+ * for problems, or its compiled song
+ * is written next to it.
+ *
+ * Not part of the app. Build it from
+ * this folder with song.cpp and every
+ * file in the MIDI library:
+ *   g++ -std=c++11 -O2 -pthread -I../OSX/src -o midicorpus
+ *     midicorpus.cpp ../OSX/src/song.cpp ../OSX/src/MIDI/[A-Z]*.cpp
+ *
+ * Usage
+ *   midicorpus [-j jobs] [-r] [-q] stats|validate|compile paths...
+ * where paths are MIDI files, folders, or quoted glob patterns.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifndef _WIN32
+#include <glob.h>
+#endif
+
+#include "song.h"
+#include "MIDI/MidiFile.h"
+#include "MIDI/Options.h"
+using namespace std;
+using namespace std::chrono;
+
+// what to do with each file
+enum CorpusCommand {
+  COMMAND_STATS,
+  COMMAND_VALIDATE,
+  COMMAND_COMPILE
+};
+
+/**
+ * Type: FileResult
+ * ----------------
+ * Everything learned about one
+ * file, filled in by a worker.
+ */
+struct FileResult {
+  bool ok;
+  string problems; // why it failed, or warnings
+
+  double milliseconds;
+  int tracks;
+  int events;
+  int notes;
+  int chords;
+  double duration; // in seconds
+};
+
+/**
+ * Type: WorkPool
+ * --------------
+ * Fixed set of jobs dealt out to one
+ * queue per worker. Workers take from
+ * the back of their own queue and steal
+ * from the front of the others when it
+ * runs dry, so a few huge files do not
+ * leave the other threads idle.
+ */
+class WorkPool {
+  public:
+    WorkPool(int threads, int jobs);
+    void run(void (*job)(int, void*), void* context);
+
+  private:
+    struct WorkQueue {
+      mutex queueLock;
+      deque<int> jobs;
+    };
+
+    bool pop(int worker, int& job);
+    bool steal(int worker, int& job);
+    vector<WorkQueue> queues;
+};
+
+/**
+ * Constructor: WorkPool
+ * ---------------------
+ * Deals the jobs out round robin so
+ * neighbouring files, which tend to be
+ * alike, land on different workers.
+ */
+WorkPool::WorkPool(int threads, int jobs) : queues(max(threads, 1)) {
+  for (int i = 0; i < jobs; i += 1)
+    queues[i % queues.size()].jobs.push_back(i);
+}
+
+/**
+ * Function: run
+ * -------------
+ * Runs every job and returns once the
+ * last one is done. The calling thread
+ * is one of the workers.
+ */
+void WorkPool::run(void (*job)(int, void*), void* context) {
+  auto work = [this, job, context](int worker) {
+    int next;
+    while (pop(worker, next) || steal(worker, next))
+      job(next, context);
+  };
+
+  vector<thread> workers;
+  for (int i = 1; i < (int) queues.size(); i += 1)
+    workers.push_back(thread(work, i));
+  work(0);
+
+  for (int i = 0; i < (int) workers.size(); i += 1)
+    workers[i].join();
+}
+
+/**
+ * Function: pop
+ * -------------
+ * Takes the newest job of a
+ * worker's own queue.
+ */
+bool WorkPool::pop(int worker, int& job) {
+  WorkQueue& queue = queues[worker];
+  lock_guard<mutex> lock(queue.queueLock);
+  if (queue.jobs.empty()) return false;
+
+  job = queue.jobs.back();
+  queue.jobs.pop_back();
+  return true;
+}
+
+/**
+ * Function: steal
+ * ---------------
+ * Takes the oldest job of the first
+ * other queue that has one. No jobs are
+ * added after the start, so finding
+ * every queue empty means we are done.
+ */
+bool WorkPool::steal(int worker, int& job) {
+  for (int i = 1; i < (int) queues.size(); i += 1) {
+    WorkQueue& queue = queues[(worker + i) % queues.size()];
+    lock_guard<mutex> lock(queue.queueLock);
+    if (queue.jobs.empty()) continue;
+
+    job = queue.jobs.front();
+    queue.jobs.pop_front();
+    return true;
+  }
+
+  return false;
+}
+
+/**
+ * Type: Corpus
+ * ------------
+ * Shared state handed to the jobs.
+ */
+struct Corpus {
+  CorpusCommand command;
+  vector<string> files;
+  vector<FileResult> results;
+};
+
+/**
+ * Function: hasExtension
+ * ----------------------
+ * Whether a file name ends in .mid.
+ */
+static bool hasExtension(const string& name) {
+  return name.size() > 4 && name.compare(name.size() - 4, 4, ".mid") == 0;
+}
+
+/**
+ * Function: addFolder
+ * -------------------
+ * Lists the MIDI files in a folder,
+ * optionally descending into others.
+ */
+static void addFolder(const string& dirName, bool recursive, vector<string>& files) {
+  DIR *dir; struct dirent *ent;
+  if ((dir = opendir(dirName.c_str())) == NULL) {
+    cerr << "Could not open folder " << dirName << "." << endl;
+    return;
+  }
+
+  while ((ent = readdir(dir)) != NULL) {
+    string name = ent -> d_name;
+    if (name == "." || name == "..") continue;
+
+    string path = dirName + "/" + name;
+    struct stat status;
+    if (stat(path.c_str(), &status) != 0) continue;
+
+    if (S_ISDIR(status.st_mode)) {
+      if (recursive) addFolder(path, recursive, files);
+    } else if (hasExtension(name)) files.push_back(path);
+  }
+
+  closedir(dir);
+}
+
+/**
+ * Function: addPath
+ * -----------------
+ * Expands a command line path, which
+ * may be a file, a folder, or a glob
+ * pattern the shell left alone.
+ */
+static void addPath(const string& path, bool recursive, vector<string>& files) {
+  struct stat status;
+  if (stat(path.c_str(), &status) == 0) {
+    if (S_ISDIR(status.st_mode)) addFolder(path, recursive, files);
+    else files.push_back(path);
+    return;
+  }
+
+#ifndef _WIN32
+  glob_t matches;
+  if (glob(path.c_str(), 0, NULL, &matches) == 0) {
+    for (size_t i = 0; i < matches.gl_pathc; i += 1)
+      addPath(matches.gl_pathv[i], recursive, files);
+    globfree(&matches);
+    return;
+  }
+
+  globfree(&matches);
+#endif
+  cerr << "Nothing matches " << path << "." << endl;
+}
+
+/**
+ * Function: validate
+ * ------------------
+ * Looks for things the song pipeline
+ * quietly tolerates: events out of
+ * order, missing end of track markers,
+ * bad data bytes and unpaired notes.
+ */
+static string validate(MidiFile& songMIDI) {
+  ostringstream problems;
+  int unpaired = 0;
+
+  for (int track = 0; track < songMIDI.getTrackCount(); track += 1) {
+    MidiEventList& events = songMIDI[track];
+    bool ended = false;
+
+    for (int evIdx = 0; evIdx < events.size(); evIdx += 1) {
+      MidiEvent& event = events[evIdx];
+      if (evIdx > 0 && event.tick < events[evIdx - 1].tick) {
+        problems << "track " << track << " goes back in time at event " << evIdx << "; ";
+        break;
+      }
+
+      if (ended) {
+        problems << "track " << track << " continues past its end; ";
+        break;
+      }
+
+      ended = event.isEndOfTrack();
+      int command = event.getCommandByte();
+      if (command >= 0x80 && command < 0xf0) {
+        for (int i = 1; i < (int) event.size(); i += 1)
+          if (event[i] > 0x7f) {
+            problems << "track " << track << " has a bad data byte at event " << evIdx << "; ";
+            break;
+          }
+      }
+
+      if ((event.isNoteOn() || event.isNoteOff()) && !event.isLinked()) unpaired += 1;
+    }
+
+    if (!ended) problems << "track " << track << " has no end of track; ";
+  }
+
+  if (unpaired) problems << unpaired << " unpaired note messages; ";
+
+  string text = problems.str();
+  if (text.size()) text.resize(text.size() - 2);
+  return text;
+}
+
+/**
+ * Function: processFile
+ * ---------------------
+ * Job run on the pool for each file.
+ */
+static void processFile(int index, void* context) {
+  Corpus& corpus = *(Corpus*) context;
+  const string& fileName = corpus.files[index];
+  FileResult& result = corpus.results[index];
+  steady_clock::time_point start = steady_clock::now();
+
+  result.ok = false;
+  result.tracks = result.events = result.notes = result.chords = 0;
+  result.duration = 0.0;
+
+  _MappedFile source(fileName.c_str());
+  MidiFile songMIDI; // from Midifile library
+  if (!source.isOpen()) result.problems = "could not open file";
+  else if (!songMIDI.read(source.data(), source.size())) result.problems = "not a MIDI file";
+  else {
+    songMIDI.linkNotePairs();
+    songMIDI.doTimeAnalysis();
+
+    result.ok = true;
+    result.tracks = songMIDI.getTrackCount();
+    result.duration = songMIDI.getTotalTimeInSeconds();
+    for (int track = 0; track < result.tracks; track += 1) {
+      MidiEventList& events = songMIDI[track];
+      result.events += events.size();
+      for (int evIdx = 0; evIdx < events.size(); evIdx += 1)
+        if (events[evIdx].isNoteOn()) result.notes += 1;
+    }
+
+    if (corpus.command == COMMAND_VALIDATE) {
+      result.problems = validate(songMIDI);
+      result.ok = result.problems.empty();
+    } else if (corpus.command == COMMAND_COMPILE) {
+      Song song;
+      uint64_t hash = Song::hashBytes(source.data(), source.size());
+      if (!song.compile(songMIDI, hash, source.size())) {
+        result.ok = false;
+        result.problems = "could not compile";
+      } else if (!song.save(fileName)) {
+        result.ok = false;
+        result.problems = "could not write " + Song::getCacheName(fileName);
+      } else result.chords = song.size();
+    }
+  }
+
+  result.milliseconds = duration<double, milli>(steady_clock::now() - start).count();
+}
+
+/**
+ * Function: printResult
+ * ---------------------
+ * One line per file, with the columns
+ * that matter for the command.
+ */
+static void printResult(const string& fileName, const FileResult& result, CorpusCommand command) {
+  cout << fixed << setprecision(3) << setw(10) << result.milliseconds << " ms  ";
+  if (!result.ok) {
+    cout << "FAIL " << fileName << ": " << result.problems << "\n";
+    return;
+  }
+
+  if (command == COMMAND_VALIDATE) cout << "ok   ";
+  cout << fileName << "  tracks " << result.tracks << "  events " << result.events
+    << "  notes " << result.notes << "  seconds " << setprecision(1) << result.duration;
+  if (command == COMMAND_COMPILE) cout << "  chords " << result.chords;
+  cout << "\n";
+}
+
+/**
+ * Function: main
+ * --------------
+ * Parses the options, gathers the
+ * files, runs the pool, and reports
+ * per file and overall numbers.
+ */
+int main(int argc, char** argv) {
+  Options options;
+  options.define("j|jobs=i:0", "worker threads, 0 for one per core");
+  options.define("r|recursive=b", "descend into subfolders");
+  options.define("q|quiet=b", "only print the summary and failures");
+  options.process(argc, argv);
+
+  if (options.getArgCount() < 2) {
+    cerr << "Usage: " << options.getCommand()
+      << " [-j jobs] [-r] [-q] stats|validate|compile paths..." << endl;
+    return 2;
+  }
+
+  Corpus corpus;
+  string command = options.getArg(1);
+  if (command == "stats") corpus.command = COMMAND_STATS;
+  else if (command == "validate") corpus.command = COMMAND_VALIDATE;
+  else if (command == "compile") corpus.command = COMMAND_COMPILE;
+  else {
+    cerr << "Unknown command " << command << "." << endl;
+    return 2;
+  }
+
+  bool recursive = options.getBoolean("recursive");
+  for (int i = 2; i <= options.getArgCount(); i += 1)
+    addPath(options.getArg(i), recursive, corpus.files);
+
+  // the same file named twice is processed once
+  sort(corpus.files.begin(), corpus.files.end());
+  corpus.files.erase(unique(corpus.files.begin(), corpus.files.end()), corpus.files.end());
+  corpus.results.resize(corpus.files.size());
+
+  int threads = options.getInteger("jobs");
+  if (threads <= 0) threads = max((int) thread::hardware_concurrency(), 1);
+  threads = max(min(threads, (int) corpus.files.size()), 1);
+
+  steady_clock::time_point start = steady_clock::now();
+  WorkPool pool(threads, corpus.files.size());
+  pool.run(processFile, &corpus);
+  double seconds = duration<double>(steady_clock::now() - start).count();
+
+  // totals across the corpus
+  int failed = 0;
+  long long events = 0;
+  double busy = 0.0;
+  for (int i = 0; i < (int) corpus.files.size(); i += 1) {
+    const FileResult& result = corpus.results[i];
+    if (!result.ok) failed += 1;
+    events += result.events;
+    busy += result.milliseconds;
+
+    if (!options.getBoolean("quiet") || !result.ok)
+      printResult(corpus.files[i], result, corpus.command);
+  }
+
+  double rate = (seconds > 0.0) ? 1.0 / seconds : 0.0;
+  cout << fixed << setprecision(3) << corpus.files.size() << " files, " << failed << " failed, "
+    << events << " events in " << seconds << " s on " << threads << " threads\n"
+    << setprecision(1) << corpus.files.size() * rate << " files/s, " << events * rate
+    << " events/s, " << setprecision(3) << busy / max((int) corpus.files.size(), 1)
+    << " ms per file" << endl;
+
+  return failed ? 1 : 0;
+}
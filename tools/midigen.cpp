@@ -0,0 +1,83 @@
+/**
+ * File: midigen.cpp
+ * -----------------
+ * Writes a deterministic synthetic
+ * MIDI file, either one of the size
+ * presets or a custom shape.
+ *
+ * Not part of the app. Build it from
+ * this folder with the MIDI library:
+ *   g++ -std=c++11 -O2 -I../OSX/src -o midigen
+ *     midigen.cpp generator.cpp ../OSX/src/MIDI/[A-Z]*.cpp
+ *
+ * Usage
+ *   midigen [-p 1k|10k|100k|1M|10M] [options] out.mid
+ */
+
+#include <iostream>
+#include <fstream>
+
+#include "generator.h"
+#include "MIDI/Options.h"
+using namespace std;
+
+/**
+ * Function: main
+ * --------------
+ * Starts from the preset and lets any
+ * option given override it.
+ */
+int main(int argc, char** argv) {
+  Options options;
+  options.define("p|preset=s:10k", "size preset: 1k, 10k, 100k, 1M or 10M");
+  options.define("e|events=i:0", "approximate total events");
+  options.define("t|tracks=i:0", "tracks including the conductor track");
+  options.define("d|density=i:0", "note onsets per quarter note per track");
+  options.define("tempos=i:0", "tempo changes");
+  options.define("controllers=i:0", "notes between controllers, 0 for none");
+  options.define("sysex=i:0", "sysex messages");
+  options.define("tpq=i:0", "ticks per quarter note");
+  options.define("seed=i:1", "random seed");
+  options.define("s|running-status=b", "pack running status");
+  options.process(argc, argv);
+
+  GeneratorSettings settings;
+  if (options.getArgCount() != 1 || !getPreset(options.getString("preset"), settings)) {
+    cerr << "Usage: " << options.getCommand() << " [-p preset] [-e events] [-t tracks]"
+      << " [-d density] [--tempos n] [--controllers n] [--sysex n] [--tpq n] [--seed n]"
+      << " [-s] out.mid" << endl;
+    return 2;
+  }
+
+  if (options.getBoolean("events")) settings.events = options.getInteger("events");
+  if (options.getBoolean("tracks")) settings.tracks = options.getInteger("tracks");
+  if (options.getBoolean("density")) settings.density = options.getInteger("density");
+  if (options.getBoolean("tempos")) settings.tempoChanges = options.getInteger("tempos");
+  if (options.getBoolean("controllers")) settings.controllerEvery = options.getInteger("controllers");
+  if (options.getBoolean("sysex")) settings.sysexCount = options.getInteger("sysex");
+  if (options.getBoolean("tpq")) settings.tpq = options.getInteger("tpq");
+  if (options.getBoolean("seed")) settings.seed = options.getInteger("seed");
+  settings.runningStatus = options.getBoolean("running-status");
+
+  MidiFile midi;
+  generateMidi(midi, settings);
+
+  vector<uchar> bytes;
+  if (!writeGenerated(midi, settings, bytes)) return 1;
+
+  string fileName = options.getArg(1);
+  ofstream output(fileName.c_str(), ios::binary | ios::trunc);
+  output.write((const char*) bytes.data(), bytes.size());
+  output.close();
+  if (!output) {
+    cerr << "Could not write " << fileName << "." << endl;
+    return 1;
+  }
+
+  int events = 0;
+  for (int track = 0; track < midi.getTrackCount(); track += 1)
+    events += midi.getEventCount(track);
+  cout << fileName << ": " << midi.getTrackCount() << " tracks, " << events
+    << " events, " << bytes.size() << " bytes" << endl;
+  return 0;
+}
@@ -0,0 +1,162 @@
+/**
+ * File: midijoin.cpp
+ * ------------------
+ * Regression check for joinTracks. Each
+ * file is joined by the library and also
+ * the way the original library did it,
+ * by concatenating the tracks and running
+ * qsort with its event comparison. The
+ * two orders must match event for event.
+ * Both joins are timed as well.
+ *
+ * Not part of the app. Build it from
+ * this folder with the MIDI library:
+ *   g++ -std=c++11 -O2 -pthread -I../OSX/src -o midijoin
+ *     midijoin.cpp ../OSX/src/MIDI/[A-Z]*.cpp
+ *
+ * Usage
+ *   midijoin [-r repeats] files.mid...
+ * The exit status is 1 if any order differs.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "MIDI/MidiFile.h"
+#include "MIDI/Options.h"
+using namespace std;
+using namespace std::chrono;
+
+/**
+ * Function: compareEvents
+ * -----------------------
+ * The qsort comparison the library
+ * used before joinTracks changed:
+ * by tick, then sequence, then end of
+ * track last, metas first, note offs
+ * and then note ons after the rest.
+ */
+static int compareEvents(const void* a, const void* b) {
+  const MidiEvent& first = **((MidiEvent**) a);
+  const MidiEvent& second = **((MidiEvent**) b);
+
+  if (first.tick != second.tick) return first.tick > second.tick ? 1 : -1;
+  if (first.seq != second.seq) return first.seq > second.seq ? 1 : -1;
+  if (first[0] == 0xff && first[1] == 0x2f) return 1;
+  if (second[0] == 0xff && second[1] == 0x2f) return -1;
+  if (first[0] == 0xff && second[0] != 0xff) return -1;
+  if (first[0] != 0xff && second[0] == 0xff) return 1;
+  if ((first[0] & 0xf0) == 0x90 && first[2] != 0) return 1;
+  if ((second[0] & 0xf0) == 0x90 && second[2] != 0) return -1;
+  if ((first[0] & 0xf0) == 0x90 || (first[0] & 0xf0) == 0x80) return 1;
+  if ((second[0] & 0xf0) == 0x90 || (second[0] & 0xf0) == 0x80) return -1;
+  return 0;
+}
+
+/**
+ * Function: joinBySorting
+ * -----------------------
+ * Lists every event of the split file
+ * in the order the original joinTracks
+ * gave them.
+ */
+static void joinBySorting(MidiFile& midi, vector<MidiEvent*>& joined) {
+  joined.clear();
+  midi.absoluteTicks();
+  for (int track = 0; track < midi.getTrackCount(); track += 1)
+    for (int i = 0; i < midi[track].size(); i += 1)
+      joined.push_back(&midi[track][i]);
+  qsort(joined.data(), joined.size(), sizeof(MidiEvent*), compareEvents);
+}
+
+/**
+ * Function: sameEvent
+ * -------------------
+ * True if two events are at the same
+ * tick, from the same track, with the
+ * same bytes.
+ */
+static bool sameEvent(const MidiEvent& first, const MidiEvent& second) {
+  if (first.tick != second.tick || first.track != second.track) return false;
+  if (first.size() != second.size()) return false;
+  for (int i = 0; i < (int) first.size(); i += 1)
+    if (first[i] != second[i]) return false;
+  return true;
+}
+
+/**
+ * Function: timeBest
+ * ------------------
+ * Fastest of several runs in
+ * milliseconds. Setup is not timed.
+ */
+template <typename Setup, typename Run>
+static double timeBest(int repeats, Setup setup, Run run) {
+  double best = -1.0;
+  for (int i = 0; i < repeats; i += 1) {
+    setup();
+    steady_clock::time_point start = steady_clock::now();
+    run();
+    double elapsed = duration<double, milli>(steady_clock::now() - start).count();
+    if (best < 0.0 || elapsed < best) best = elapsed;
+  }
+  return best;
+}
+
+/**
+ * Function: main
+ * --------------
+ * Checks and times every file, one
+ * line each.
+ */
+int main(int argc, char** argv) {
+  Options options;
+  options.define("r|repeats=i:5", "timed runs per join, the fastest is kept");
+  options.process(argc, argv);
+
+  if (options.getArgCount() < 1) {
+    cerr << "Usage: " << options.getCommand() << " [-r repeats] files.mid..." << endl;
+    return 2;
+  }
+
+  int repeats = max(options.getInteger("repeats"), 1);
+  int failures = 0;
+  for (int file = 1; file <= options.getArgCount(); file += 1) {
+    string name = options.getArg(file);
+    MidiFile joined, sorted;
+    if (!joined.read(name) || !sorted.read(name)) {
+      cerr << "Could not read " << name << "." << endl;
+      return 1;
+    }
+
+    vector<MidiEvent*> expected;
+    joinBySorting(sorted, expected);
+    joined.joinTracks();
+
+    // first event out of place, or the count
+    int mismatch = -1;
+    if (joined[0].size() != (int) expected.size()) mismatch = min(joined[0].size(), (int) expected.size());
+    for (int i = 0; mismatch < 0 && i < (int) expected.size(); i += 1)
+      if (!sameEvent(joined[0][i], *expected[i])) mismatch = i;
+
+    double joinTime = timeBest(repeats, [&] { joined.read(name); },
+      [&] { joined.joinTracks(); });
+    double sortTime = timeBest(repeats, [&] { sorted.read(name); },
+      [&] { joinBySorting(sorted, expected); });
+
+    cout << name << ": " << expected.size() << " events in " << sorted.getTrackCount()
+      << " tracks, " << fixed << setprecision(3)
+      << joinTime << " ms joinTracks, " << sortTime << " ms qsort, ";
+    if (mismatch < 0) cout << "same order" << endl;
+    else {
+      cout << "differs at event " << mismatch << endl;
+      failures += 1;
+    }
+  }
+
+  return failures ? 1 : 0;
+}
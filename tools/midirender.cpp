@@ -0,0 +1,238 @@
+/**
+ * File: midirender.cpp
+ * --------------------
+ * Headless tool that renders a MIDI
+ * file, or the compiled song made from
+ * it, to a WAV file through a non-live
+ * Synthesizer and reports how many
+ * times faster than realtime it ran.
+ * Used to pre-render backing tracks
+ * and to compare audio between builds.
+ * With several jobs, channels or tracks
+ * are split across synthesizers that
+ * render on their own threads, either
+ * mixed into one file or as one file
+ * each. Every thread loads its own copy
+ * of the font, since FluidSynth counts
+ * sample users without locking.
+ *
+ * Not part of the app. Build it from
+ * this folder with the synthesizer,
+ * song.cpp and the MIDI library:
+ *   g++ -std=c++11 -O2 -pthread -I../OSX/src -I../FluidSynth/include
+ *     -o midirender midirender.cpp renderer.cpp ../OSX/src/synthesizer.cpp
+ *     ../OSX/src/song.cpp ../OSX/src/MIDI/[A-Z]*.cpp -lfluidsynth
+ *
+ * Usage
+ *   midirender [-s] [-f] [-r rate] [-b frames] [-g gain] [-t tail]
+ *     [--program n] [-j jobs] [--by channel|track] [--stems]
+ *     font.sf2 input.mid output.wav
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "renderer.h"
+#include "MIDI/Options.h"
+using namespace std;
+using namespace std::chrono;
+
+/**
+ * Function: getStemName
+ * ---------------------
+ * Names a stem file after the output,
+ * as in song.ch10.wav or song.tr3.wav.
+ */
+static string getStemName(const string& outputName, StemSplit split, int key) {
+  string base(outputName);
+  size_t dot = base.find_last_of('.');
+  size_t slash = base.find_last_of("/\\");
+  if (dot != string::npos && (slash == string::npos || slash < dot)) base.erase(dot);
+
+  char suffix[32];
+  if (split == STEM_BY_TRACK) snprintf(suffix, sizeof(suffix), ".tr%d.wav", key);
+  else snprintf(suffix, sizeof(suffix), ".ch%02d.wav", key + 1);
+  return base + suffix;
+}
+
+/**
+ * Function: makeSynth
+ * -------------------
+ * A non-live synth that loads the font,
+ * or plays off the fonts of an owner
+ * rendering on the same thread.
+ */
+static Synthesizer* makeSynth(const string& fontName, Synthesizer* owner,
+    int rate, double gain, int program) {
+  Synthesizer* synth = new Synthesizer();
+  if (!synth -> init(rate, 256, gain, false) ||
+      !(owner ? synth -> share(*owner) : synth -> load(fontName.c_str()))) {
+    delete synth;
+    return NULL;
+  }
+
+  synth -> setInstrument(1, program);
+  return synth;
+}
+
+/**
+ * Function: main
+ * --------------
+ * Loads, renders, and prints one
+ * line of timing.
+ */
+int main(int argc, char** argv) {
+  Options options;
+  options.define("s|song=b", "render the compiled song instead of the MIDI events");
+  options.define("f|float=b", "write 32 bit float samples");
+  options.define("r|rate=i:44100", "sample rate");
+  options.define("b|block=i:512", "largest block in frames");
+  options.define("g|gain=d:0.5", "synthesizer gain");
+  options.define("t|tail=d:2.0", "seconds rendered after the last event");
+  options.define("program=i:21", "program on channel 1 before the first event");
+  options.define("j|jobs=i:0", "synthesizers rendering at once, 0 for one per core");
+  options.define("by=s:channel", "split notes between synthesizers by channel or track");
+  options.define("stems=b", "write a file per channel or track instead of a mix");
+  options.process(argc, argv);
+
+  if (options.getArgCount() != 3) {
+    cerr << "Usage: " << options.getCommand() << " [-s] [-f] [-r rate] [-b frames]"
+      << " [-g gain] [-t tail] [--program n] [-j jobs] [--by channel|track] [--stems]"
+      << " font.sf2 input.mid output.wav" << endl;
+    return 2;
+  }
+
+  int rate = options.getInteger("rate");
+  string fontName = options.getArg(1);
+  string inputName = options.getArg(2);
+  string outputName = options.getArg(3);
+
+  // build the timeline first so it is not timed
+  Timeline timeline;
+  if (options.getBoolean("song")) {
+    Song song;
+    if (!song.load(inputName)) {
+      cerr << "Could not load " << inputName << "." << endl;
+      return 1;
+    }
+    collectSong(song, rate, 1, timeline);
+  } else {
+    MidiFile midi;
+    if (!midi.read(inputName)) {
+      cerr << "Could not read " << inputName << "." << endl;
+      return 1;
+    }
+    collectMidi(midi, rate, timeline);
+  }
+
+  // the first synth owns the font
+  double gain = options.getDouble("gain");
+  int program = options.getInteger("program");
+  Synthesizer synth;
+  if (!synth.init(rate, 256, gain, false) ||
+      !synth.load(fontName.c_str())) return 1;
+  synth.setInstrument(1, program);
+
+  int jobs = options.getInteger("jobs");
+  if (jobs <= 0) jobs = max((int) thread::hardware_concurrency(), 1);
+  StemSplit split = options.getString("by") == "track" ? STEM_BY_TRACK : STEM_BY_CHANNEL;
+  bool stems = options.getBoolean("stems");
+  bool floatSamples = options.getBoolean("float");
+  int blockFrames = options.getInteger("block");
+
+  // parts are stems, or up to one per job
+  vector<int> partOf;
+  vector<Timeline> parts;
+  int partCount = assignParts(timeline, split, stems ? 0 : jobs, partOf);
+  if (!stems && partCount > 1) splitTimeline(timeline, split, partOf, partCount, parts);
+
+  vector<Synthesizer*> synths(1, &synth);
+  for (int i = 1; !stems && i < (int) parts.size(); i += 1) {
+    Synthesizer* extra = makeSynth(fontName, NULL, rate, gain, program);
+    if (extra == NULL) break;
+    synths.push_back(extra);
+  }
+
+  // could not load the font again: render alone
+  if (synths.size() < parts.size()) {
+    cerr << "Could not load " << fontName << " for every part, rendering on one synth." << endl;
+    for (int i = 1; i < (int) synths.size(); i += 1) delete synths[i];
+    synths.resize(1);
+  }
+
+  int64_t endFrame = timeline.lastFrame() + (int64_t) (options.getDouble("tail") * rate);
+  steady_clock::time_point start = steady_clock::now();
+  int64_t frames = endFrame;
+  bool written = true;
+
+  if (stems) {
+    splitTimeline(timeline, split, partOf, partCount, parts);
+    vector<int> keys(partCount);
+    for (int key = 0; key < (int) partOf.size(); key += 1)
+      if (partOf[key] >= 0) keys[partOf[key]] = key;
+
+    // each worker takes the next stem, with a
+    // font loaded on its own thread [the main
+    // thread has one already]
+    atomic<int> next(0);
+    atomic<bool> failed(false);
+    auto work = [&](bool mainThread) {
+      Synthesizer* fonts = mainThread ? &synth : NULL;
+      for (int part = next++; part < partCount; part = next++) {
+        if (fonts == NULL) fonts = makeSynth(fontName, NULL, rate, gain, program);
+        Synthesizer* stemSynth = fonts ? makeSynth(fontName, fonts, rate, gain, program) : NULL;
+        string stemName = getStemName(outputName, split, keys[part]);
+        WavWriter stemOutput;
+
+        if (stemSynth == NULL || !stemOutput.open(stemName, rate, floatSamples) ||
+            renderTimeline(*stemSynth, parts[part], endFrame, blockFrames, stemOutput) < 0 ||
+            !stemOutput.close()) {
+          cerr << "Could not write " << stemName << "." << endl;
+          failed = true;
+        }
+
+        delete stemSynth;
+      }
+      if (!mainThread) delete fonts;
+    };
+
+    vector<thread> workers;
+    for (int i = 1; i < min(jobs, partCount); i += 1)
+      workers.push_back(thread(work, false));
+    work(true); // this thread renders stems too
+
+    for (int i = 0; i < (int) workers.size(); i += 1)
+      workers[i].join();
+    written = !failed;
+  }
+
+  else {
+    WavWriter output;
+    if (!output.open(outputName, rate, floatSamples)) {
+      cerr << "Could not write " << outputName << "." << endl;
+      return 1;
+    }
+
+    if (synths.size() > 1) frames = renderMixed(synths, parts, endFrame, blockFrames, output);
+    else frames = renderTimeline(synth, timeline, endFrame, blockFrames, output);
+    written = output.close() && frames >= 0;
+    if (!written) cerr << "Could not write " << outputName << "." << endl;
+  }
+
+  double seconds = duration<double>(steady_clock::now() - start).count();
+  for (int i = 1; i < (int) synths.size(); i += 1) delete synths[i];
+  if (!written) return 1;
+
+  double audio = (double) frames / rate;
+  cout << outputName << ": " << fixed << setprecision(2) << audio << " s of audio in "
+    << seconds << " s, " << setprecision(1) << audio / max(seconds, 1e-9)
+    << "x realtime, " << timeline.frames.size() << " events, "
+    << (stems ? partCount : (int) synths.size()) << (stems ? " stems" : " synths") << endl;
+  return 0;
+}
@@ -0,0 +1,490 @@
+/**
+ * File: renderer.cpp
+ * ------------------
+ * Turns MIDI files and compiled songs
+ * into frame stamped synth commands
+ * and renders them block by block. A
+ * block is cut short wherever a command
+ * is due, so each command reaches the
+ * synth at its frame. FluidSynth 1.x
+ * only applies it at the start of its
+ * next 64 frame step, though, so notes
+ * sound up to 63 frames late, 1.4 ms
+ * at 44.1 kHz. Big songs can be split
+ * by channel or track across
+ * synthesizers that render in parallel.
+ */
+
+#include "renderer.h"
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+using namespace std;
+
+// stdio buffer for rendered audio
+static const size_t WAV_BUFFER_SIZE = 4 << 20;
+
+// frames each part renders between mixes
+static const int MIX_CHUNK_FRAMES = 32768;
+
+/**
+ * Function: add
+ * -------------
+ * Appends one command.
+ */
+void Timeline::add(int64_t frame, const SynthCommand& command, int track) {
+  frames.push_back(frame);
+  commands.push_back(command);
+  tracks.push_back(track);
+}
+
+/**
+ * Function: sort
+ * --------------
+ * Orders commands by frame, keeping
+ * the order they were added in for
+ * commands on the same frame.
+ */
+void Timeline::sort() {
+  vector<int> order(frames.size());
+  for (int i = 0; i < (int) order.size(); i += 1) order[i] = i;
+  stable_sort(order.begin(), order.end(),
+    [this](int a, int b) { return frames[a] < frames[b]; });
+
+  vector<int64_t> sortedFrames(order.size());
+  vector<SynthCommand> sortedCommands(order.size());
+  vector<int> sortedTracks(order.size());
+  for (int i = 0; i < (int) order.size(); i += 1) {
+    sortedFrames[i] = frames[order[i]];
+    sortedCommands[i] = commands[order[i]];
+    sortedTracks[i] = tracks[order[i]];
+  }
+
+  frames.swap(sortedFrames);
+  commands.swap(sortedCommands);
+  tracks.swap(sortedTracks);
+}
+
+/**
+ * Function: makeCommand
+ * ---------------------
+ * Fills in a command record.
+ */
+static SynthCommand makeCommand(int type, int channel, int dataOne, int dataTwo, float value) {
+  SynthCommand command;
+  command.type = type;
+  command.channel = channel;
+  command.dataOne = dataOne;
+  command.dataTwo = dataTwo;
+  command.value = value;
+  command.time = 0; // placed by frame instead
+  return command;
+}
+
+/**
+ * Function: collectMidi
+ * ---------------------
+ * Every note, controller, program and
+ * bend in a MIDI file, stamped at the
+ * given sample rate. Joins the tracks
+ * of the file as a side effect.
+ */
+void collectMidi(MidiFile& midi, int rate, Timeline& timeline) {
+  midi.doTimeAnalysis();
+  midi.joinTracks();
+
+  MidiEventList& events = midi[0];
+  for (int evIdx = 0; evIdx < events.size(); evIdx += 1) {
+    MidiEvent& event = events[evIdx];
+    int64_t frame = llround(event.seconds * rate);
+    int channel = event.getChannel();
+    int track = event.track;
+
+    if (event.getSize() >= 3 && event.isNoteOn())
+      timeline.add(frame, makeCommand(SYNTH_NOTE_ON, channel, event[1], event[2], 0), track);
+    else if (event.getSize() >= 3 && event.isNoteOff())
+      timeline.add(frame, makeCommand(SYNTH_NOTE_OFF, channel, event[1], 0, 0), track);
+    else if (event.getSize() >= 3 && event.isController())
+      timeline.add(frame, makeCommand(SYNTH_CONTROL, channel, event[1], event[2], 0), track);
+    else if (event.getSize() >= 2 && event.isPatchChange())
+      timeline.add(frame, makeCommand(SYNTH_PROGRAM, channel, event[1], 0, 0), track);
+    else if (event.getSize() >= 3 && event.isPitchbend())
+      timeline.add(frame, makeCommand(SYNTH_PITCH_BEND, channel, 0, 0,
+        (event[1] & 0x7f) | ((event[2] & 0x7f) << 7)), track);
+  }
+}
+
+/**
+ * Function: collectSong
+ * ---------------------
+ * Plays a compiled song the way a
+ * steady player would: each chord as
+ * soon as the longest note of the one
+ * before it ends.
+ */
+void collectSong(const Song& song, int rate, int channel, Timeline& timeline) {
+  double start = 0.0; // in seconds
+  for (int chord = 0; chord < song.size(); chord += 1) {
+    double longest = 0.0;
+    int64_t onFrame = llround(start * rate);
+
+    for (int i = 0; i < song.chordSize(chord); i += 1) {
+      double duration = song.getDuration(chord, i);
+      int note = song.getNote(chord, i);
+      longest = max(longest, duration);
+
+      timeline.add(onFrame, makeCommand(SYNTH_NOTE_ON, channel, note, 127, 0));
+      timeline.add(llround((start + duration) * rate),
+        makeCommand(SYNTH_NOTE_OFF, channel, note, 0, 0));
+    }
+
+    start += longest;
+  }
+
+  timeline.sort();
+}
+
+/**
+ * Function: getStemKey
+ * --------------------
+ * Which stem a note belongs to, or
+ * -1 for commands every stem needs.
+ */
+int getStemKey(const Timeline& timeline, int index, StemSplit split) {
+  const SynthCommand& command = timeline.commands[index];
+  if (command.type != SYNTH_NOTE_ON && command.type != SYNTH_NOTE_OFF) return -1;
+  return split == STEM_BY_TRACK ? timeline.tracks[index] : command.channel;
+}
+
+/**
+ * Function: assignParts
+ * ---------------------
+ * Maps each stem key to a part. With
+ * parts <= 0 every key with notes gets
+ * a part of its own; otherwise the
+ * keys are dealt out busiest first to
+ * the part with the fewest notes so
+ * far. Returns the number of parts.
+ */
+int assignParts(const Timeline& timeline, StemSplit split, int parts, vector<int>& partOf) {
+  map<int, int> notes; // per key
+  for (int i = 0; i < (int) timeline.commands.size(); i += 1) {
+    int key = getStemKey(timeline, i, split);
+    if (key >= 0 && timeline.commands[i].type == SYNTH_NOTE_ON) notes[key] += 1;
+  }
+
+  int largest = notes.empty() ? 0 : notes.rbegin() -> first;
+  partOf.assign(largest + 1, -1);
+
+  if (parts <= 0) {
+    parts = 0;
+    for (map<int, int>::iterator it = notes.begin(); it != notes.end(); ++it)
+      partOf[it -> first] = parts++;
+    return parts;
+  }
+
+  vector<pair<int, int> > busiest; // notes and key
+  for (map<int, int>::iterator it = notes.begin(); it != notes.end(); ++it)
+    busiest.push_back(make_pair(-it -> second, it -> first));
+  std::sort(busiest.begin(), busiest.end());
+
+  parts = min(parts, max((int) busiest.size(), 1));
+  vector<int> load(parts, 0);
+  for (int i = 0; i < (int) busiest.size(); i += 1) {
+    int part = min_element(load.begin(), load.end()) - load.begin();
+    partOf[busiest[i].second] = part;
+    load[part] -= busiest[i].first;
+  }
+
+  return parts;
+}
+
+/**
+ * Function: splitTimeline
+ * -----------------------
+ * Deals notes out to their parts and
+ * copies every other command to all
+ * of them, so each part keeps the full
+ * channel state. Order is preserved.
+ */
+void splitTimeline(const Timeline& timeline, StemSplit split,
+    const vector<int>& partOf, int parts, vector<Timeline>& out) {
+  out.assign(parts, Timeline());
+
+  for (int i = 0; i < (int) timeline.commands.size(); i += 1) {
+    int key = getStemKey(timeline, i, split);
+    const SynthCommand& command = timeline.commands[i];
+
+    if (key < 0) {
+      for (int part = 0; part < parts; part += 1)
+        out[part].add(timeline.frames[i], command, timeline.tracks[i]);
+    } else if (key < (int) partOf.size() && partOf[key] >= 0) {
+      out[partOf[key]].add(timeline.frames[i], command, timeline.tracks[i]);
+    }
+  }
+}
+
+/**
+ * Function: renderSpan
+ * --------------------
+ * Renders frames [from, to) into an
+ * interleaved buffer. Commands due on
+ * the same frame go to the synth as one
+ * batch, and blocks stop early at the
+ * next due frame. The synth still starts
+ * them on its own 64 frame grid.
+ */
+void renderSpan(Synthesizer& synth, const Timeline& timeline, size_t& next,
+    int64_t from, int64_t to, int blockFrames, float* out) {
+  size_t total = timeline.frames.size();
+  int64_t frame = from;
+
+  while (frame < to) {
+    size_t first = next;
+    while (next < total && timeline.frames[next] <= frame) next += 1;
+    if (next > first) synth.submit(&timeline.commands[first], next - first);
+
+    int64_t stop = min(frame + blockFrames, to);
+    if (next < total && timeline.frames[next] < stop) stop = timeline.frames[next];
+
+    synth.synthesize(out + (frame - from) * 2, stop - frame);
+    frame = stop;
+  }
+}
+
+/**
+ * Function: renderTimeline
+ * ------------------------
+ * Renders until endFrame on this
+ * thread, one block at a time.
+ */
+int64_t renderTimeline(Synthesizer& synth, const Timeline& timeline,
+    int64_t endFrame, int blockFrames, WavWriter& output) {
+  if (blockFrames <= 0) blockFrames = 512;
+  vector<float> block(blockFrames * 2);
+
+  int64_t frame = 0;
+  size_t next = 0;
+
+  while (frame < endFrame) {
+    int64_t stop = min(frame + blockFrames, endFrame);
+    renderSpan(synth, timeline, next, frame, stop, blockFrames, block.data());
+    if (!output.write(block.data(), stop - frame)) return -1;
+    frame = stop;
+  }
+
+  return frame;
+}
+
+/**
+ * Function: renderMixed
+ * ---------------------
+ * Renders each part on its own synth
+ * and thread a chunk at a time, then
+ * sums the chunks into the output. The
+ * workers start once and wait for each
+ * chunk in turn, so every synth stays
+ * on one thread. The mix is a flat loop
+ * over contiguous floats, which the
+ * compiler vectorizes.
+ */
+int64_t renderMixed(const vector<Synthesizer*>& synths, const vector<Timeline>& parts,
+    int64_t endFrame, int blockFrames, WavWriter& output) {
+  if (blockFrames <= 0) blockFrames = 512;
+  int count = (int) min(synths.size(), parts.size());
+  if (count <= 0) return -1;
+
+  vector<vector<float> > chunks(count, vector<float>(MIX_CHUNK_FRAMES * 2));
+  vector<size_t> next(count, 0);
+
+  // the chunk being rendered, guarded by lock
+  mutex lock;
+  condition_variable started, finished;
+  int64_t chunkStart = 0, chunkStop = 0;
+  int round = 0, pending = 0;
+  bool done = false;
+
+  auto render = [&](int part, int64_t from, int64_t to) {
+    renderSpan(*synths[part], parts[part], next[part], from, to, blockFrames,
+      chunks[part].data());
+  };
+
+  auto work = [&](int part) {
+    for (int seen = 0; ; seen += 1) {
+      int64_t from, to;
+      {
+        unique_lock<mutex> guard(lock);
+        started.wait(guard, [&] { return done || round > seen; });
+        if (done) return;
+        from = chunkStart;
+        to = chunkStop;
+      }
+
+      render(part, from, to);
+      lock_guard<mutex> guard(lock);
+      if (--pending == 0) finished.notify_one();
+    }
+  };
+
+  vector<thread> workers;
+  for (int part = 1; part < count; part += 1)
+    workers.push_back(thread(work, part));
+
+  int64_t frame = 0;
+  while (frame < endFrame) {
+    int64_t stop = min(frame + MIX_CHUNK_FRAMES, endFrame);
+    {
+      lock_guard<mutex> guard(lock);
+      chunkStart = frame;
+      chunkStop = stop;
+      pending = count - 1;
+      round += 1;
+    }
+    started.notify_all();
+    render(0, frame, stop); // this thread renders a part too
+
+    {
+      unique_lock<mutex> guard(lock);
+      finished.wait(guard, [&] { return pending == 0; });
+    }
+
+    // sum every part into the first
+    float* mix = chunks[0].data();
+    size_t samples = (stop - frame) * 2;
+    for (int part = 1; part < count; part += 1) {
+      const float* source = chunks[part].data();
+      for (size_t i = 0; i < samples; i += 1) mix[i] += source[i];
+    }
+
+    if (!output.write(mix, stop - frame)) break;
+    frame = stop;
+  }
+
+  {
+    lock_guard<mutex> guard(lock);
+    done = true;
+  }
+  started.notify_all();
+  for (int i = 0; i < (int) workers.size(); i += 1)
+    workers[i].join();
+
+  return frame < endFrame ? -1 : frame;
+}
+
+/**
+ * Constructor: WavWriter
+ * ----------------------
+ * Starts with no file open.
+ */
+WavWriter::WavWriter()
+  : file(NULL), floatSamples(false), rate(0), frameCount(0), failed(false) {}
+
+/**
+ * Destructor: WavWriter
+ * ---------------------
+ * Finishes any open file.
+ */
+WavWriter::~WavWriter() {
+  close();
+}
+
+/**
+ * Function: open
+ * --------------
+ * Creates the file and writes a header
+ * with placeholder sizes.
+ */
+bool WavWriter::open(const string& fileName, int rate, bool floatSamples) {
+  close();
+  file = fopen(fileName.c_str(), "wb");
+  if (file == NULL) return false;
+
+  buffer.resize(WAV_BUFFER_SIZE);
+  setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+
+  this -> floatSamples = floatSamples;
+  this -> rate = rate;
+  frameCount = 0;
+  failed = !writeHeader(0);
+  return !failed;
+}
+
+/**
+ * Function: write
+ * ---------------
+ * Appends interleaved stereo frames.
+ * Integer files are clipped.
+ */
+bool WavWriter::write(const float* samples, int frames) {
+  if (file == NULL || failed) return false;
+  size_t count = frames * 2;
+
+  if (floatSamples) {
+    failed = fwrite(samples, sizeof(float), count, file) != count;
+  } else {
+    converted.resize(count);
+    for (size_t i = 0; i < count; i += 1) {
+      float sample = samples[i] * 32767.0f;
+      if (sample > 32767.0f) sample = 32767.0f;
+      else if (sample < -32768.0f) sample = -32768.0f;
+      converted[i] = (int16_t) lrintf(sample);
+    }
+    failed = fwrite(converted.data(), sizeof(int16_t), count, file) != count;
+  }
+
+  frameCount += frames;
+  return !failed;
+}
+
+/**
+ * Function: close
+ * ---------------
+ * Patches the sizes in the header and
+ * closes the file.
+ */
+bool WavWriter::close() {
+  if (file == NULL) return false;
+
+  int sampleBytes = floatSamples ? 4 : 2;
+  uint64_t dataBytes = frameCount * 2 * sampleBytes;
+  if (dataBytes > 0xffffffffu - 36) failed = true; // too long for WAV
+
+  fseek(file, 0, SEEK_SET);
+  if (!writeHeader(dataBytes)) failed = true;
+  if (fclose(file) != 0) failed = true;
+
+  file = NULL;
+  return !failed;
+}
+
+/**
+ * Function: writeHeader
+ * ---------------------
+ * The 44 byte RIFF header, written
+ * little endian on any host.
+ */
+bool WavWriter::writeHeader(uint32_t dataBytes) {
+  int sampleBytes = floatSamples ? 4 : 2;
+  uint32_t fields[] = {
+    36 + dataBytes, // RIFF size
+    16, // fmt size
+    (uint32_t) (floatSamples ? 3 : 1) | (2 << 16), // format and channels
+    (uint32_t) rate,
+    (uint32_t) rate * 2 * sampleBytes, // bytes per second
+    (uint32_t) (2 * sampleBytes) | ((8 * sampleBytes) << 16), // alignment and bits
+    dataBytes
+  };
+
+  unsigned char header[44];
+  memcpy(header, "RIFF....WAVEfmt ....................data....", 44);
+  int offsets[] = { 4, 16, 20, 24, 28, 32, 40 };
+
+  for (int i = 0; i < 7; i += 1)
+    for (int b = 0; b < 4; b += 1)
+      header[offsets[i] + b] = (fields[i] >> (8 * b)) & 0xff;
+
+  return fwrite(header, 1, 44, file) == 44;
+}
@@ -0,0 +1,100 @@
+/**
+ * File: renderer.h
+ * ----------------
+ * Offline rendering of songs through
+ * a non-live Synthesizer, straight to
+ * a WAV file as fast as FluidSynth
+ * can go.
+ */
+
+#pragma once
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "song.h"
+#include "synthesizer.h"
+#include "MIDI/MidiFile.h"
+using namespace std;
+
+/**
+ * Type: Timeline
+ * --------------
+ * Synth commands with the sample frame
+ * each is due at and the track each
+ * came from. Commands are kept in one
+ * array so those sharing a frame can
+ * be submitted together.
+ */
+struct Timeline {
+  vector<int64_t> frames;
+  vector<SynthCommand> commands;
+  vector<int> tracks;
+
+  void add(int64_t frame, const SynthCommand& command, int track = 0);
+  void sort(); // stable, by frame
+  int64_t lastFrame() const { return frames.empty() ? 0 : frames.back(); }
+};
+
+/**
+ * Type: WavWriter
+ * ---------------
+ * Streams interleaved stereo floats to
+ * a 16 bit or float WAV file through
+ * a large buffer. Sizes in the header
+ * are patched on close.
+ */
+class WavWriter {
+  public:
+    WavWriter();
+    ~WavWriter();
+
+    bool open(const string& fileName, int rate, bool floatSamples = false);
+    bool write(const float* samples, int frames);
+    bool close();
+
+    int64_t getFrames() const { return frameCount; }
+
+  private:
+    FILE* file;
+    vector<char> buffer; // stdio buffer
+    vector<int16_t> converted;
+    bool floatSamples;
+    int rate;
+    int64_t frameCount;
+    bool failed;
+
+    bool writeHeader(uint32_t dataBytes);
+
+    // owns the file handle
+    WavWriter(const WavWriter& other);
+    WavWriter& operator=(const WavWriter& other);
+};
+
+// timelines from MIDI files and compiled songs
+void collectMidi(MidiFile& midi, int rate, Timeline& timeline);
+void collectSong(const Song& song, int rate, int channel, Timeline& timeline);
+
+// how notes are dealt out to synthesizers
+enum StemSplit {
+  STEM_BY_CHANNEL,
+  STEM_BY_TRACK
+};
+
+// splitting into stems or balanced parts
+int getStemKey(const Timeline& timeline, int index, StemSplit split);
+int assignParts(const Timeline& timeline, StemSplit split, int parts, vector<int>& partOf);
+void splitTimeline(const Timeline& timeline, StemSplit split,
+  const vector<int>& partOf, int parts, vector<Timeline>& out);
+
+// renders frames [from, to) into out, moving next along
+void renderSpan(Synthesizer& synth, const Timeline& timeline, size_t& next,
+  int64_t from, int64_t to, int blockFrames, float* out);
+
+// returns frames written, or -1 on a write error
+int64_t renderTimeline(Synthesizer& synth, const Timeline& timeline,
+  int64_t endFrame, int blockFrames, WavWriter& output);
+int64_t renderMixed(const vector<Synthesizer*>& synths, const vector<Timeline>& parts,
+  int64_t endFrame, int blockFrames, WavWriter& output);